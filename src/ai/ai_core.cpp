@@ -16,6 +16,7 @@
 #include "../company_func.h"
 #include "../network/network.h"
 #include "../window_func.h"
+#include "../tick_profiler.h"
 #include "ai_scanner.hpp"
 #include "ai_instance.hpp"
 #include "ai_config.hpp"
@@ -80,7 +81,10 @@
 	FOR_ALL_COMPANIES(c) {
 		if (c->is_ai) {
 			cur_company.Change(c->index);
+			uint64 start = GetProfilerTime();
+			uint32 ops = c->ai_instance->GetExecutedOps();
 			c->ai_instance->GameLoop();
+			TickProfilerAddScript(c->index, GetProfilerTime() - start, c->ai_instance->GetExecutedOps() - ops);
 		}
 	}
 	cur_company.Restore();
@@ -0,0 +1,879 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file benchmark.cpp Running a number of game ticks as fast as possible and reporting the speed. */
+
+#include "stdafx.h"
+#include "benchmark.h"
+#include "tick_profiler.h"
+#include "openttd.h"
+#include "gfx_func.h"
+#include "progress.h"
+#include "debug.h"
+#include "map_func.h"
+#include "saveload/saveload.h"
+#include "core/alloc_func.hpp"
+#include "core/sort_func.hpp"
+#include "misc/indexed_heap.hpp"
+#include "misc/hashtable.hpp"
+#include "string_func.h"
+#include "fileio_func.h"
+#include "pathfinder/pf_record.h"
+#include "viewport_sprite_sorter.h"
+#include "spritecache.h"
+#include "sprite.h"
+#include "blitter/factory.hpp"
+#include "video/video_driver.hpp"
+#include "console_func.h"
+#include "console_internal.h"
+#include "table/sprites.h"
+
+#if defined(UNIX) && !defined(__MORPHOS__) && !defined(__AMIGA__)
+#	include <sys/resource.h>
+#endif
+
+#include <set>
+#include <vector>
+
+#include "safeguards.h"
+
+extern void StateGameLoop();
+
+/**
+ * Get the highest amount of memory the process used so far.
+ * @return The peak resident set size in KiB, or 0 when the OS does not tell.
+ */
+static uint64 GetPeakResidentSetSize()
+{
+#if defined(UNIX) && !defined(__MORPHOS__) && !defined(__AMIGA__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#	if defined(__APPLE__)
+	/* OSX reports bytes instead of KiB. */
+	return (uint64)usage.ru_maxrss / 1024;
+#	else
+	return (uint64)usage.ru_maxrss;
+#	endif
+#else
+	return 0;
+#endif
+}
+
+/** Compare two tick times for sorting. */
+static int CDECL TickTimeSorter(const uint32 *a, const uint32 *b)
+{
+	return (*a > *b) - (*a < *b);
+}
+
+/**
+ * Get a percentile from sorted tick times.
+ * @param times The sorted times.
+ * @param count Number of times.
+ * @param percentile The percentile to get, 0 - 100.
+ * @return The time at that percentile.
+ */
+static uint32 GetPercentile(const uint32 *times, uint count, uint percentile)
+{
+	return times[min<uint>((uint)((uint64)count * percentile / 100), count - 1)];
+}
+
+/**
+ * Print a string as a JSON string literal.
+ * @param str The string to print.
+ */
+static void PrintJSONString(const char *str)
+{
+	putchar('"');
+	for (; *str != '\0'; str++) {
+		if ((byte)*str < 0x20) {
+			/* Control characters are not allowed in a JSON string. */
+			printf("\\u%04x", (byte)*str);
+			continue;
+		}
+		if (*str == '"' || *str == '\\') putchar('\\');
+		putchar(*str);
+	}
+	putchar('"');
+}
+
+/**
+ * Run the measured part of a benchmark a number of times.
+ * @param runs Number of runs.
+ * @param body Functor doing one run; it gets the index of the run.
+ * @return Time in microseconds of all runs together.
+ */
+template <class Tbody>
+static uint64 TimeBenchmarkRuns(uint runs, Tbody &body)
+{
+	uint64 start = GetProfilerTime();
+	for (uint run = 0; run < runs; run++) body(run);
+	return GetProfilerTime() - start;
+}
+
+/**
+ * Get the numeric arguments of a benchmark console command. They are all
+ * optional and positive, and come after the required arguments.
+ * @param argc Number of arguments, including the command itself.
+ * @param argv The arguments.
+ * @param required Number of arguments before the numeric ones, including the command itself.
+ * @param[in,out] values The defaults of the numeric arguments; the given ones replace them.
+ * @param count Number of numeric arguments.
+ * @return Whether the arguments are valid.
+ */
+bool GetBenchmarkArguments(byte argc, char *argv[], uint required, uint32 *values, uint count)
+{
+	if (argc < required || argc > required + count) return false;
+
+	for (uint i = required; i < argc; i++) {
+		if (!GetArgumentInteger(&values[i - required], argv[i]) || values[i - required] == 0) return false;
+	}
+	return true;
+}
+
+/**
+ * Print a line with a time of a benchmark to the console.
+ * @param label What was measured.
+ * @param time Time in microseconds.
+ */
+void PrintBenchmarkTime(const char *label, uint64 time)
+{
+	IConsolePrintF(CC_DEFAULT, "  %-21s " OTTD_PRINTF64 " us", label, (int64)time);
+}
+
+/**
+ * Load the game given on the command line and run the game loop for a number
+ * of ticks without waiting in between, then print a report of the timings to
+ * stdout in JSON format.
+ * @param ticks Number of ticks to run.
+ */
+void RunBenchmark(uint ticks)
+{
+	/* Let the game loop do the NewGRF scan and load the savegame. */
+	while (_switch_mode != SM_NONE || HasModalProgress()) GameLoop();
+
+	if (_game_mode != GM_NORMAL) usererror("Benchmarking needs a savegame; pass one with -g.");
+	if (ticks == 0) usererror("Benchmarking needs at least one tick.");
+
+	if (_pause_mode != PM_UNPAUSED) {
+		DEBUG(misc, 0, "Benchmark: the savegame is paused, unpausing it");
+		_pause_mode = PM_UNPAUSED;
+	}
+
+	uint32 *tick_times = MallocT<uint32>(ticks);
+	uint64 phase_times[TP_END] = { 0 };
+
+	uint64 start = GetProfilerTime();
+	for (uint i = 0; i < ticks; i++) {
+		/* Like StateGameLoop, which returns before it measures the tick in these cases. */
+		bool measured = _pause_mode == PM_UNPAUSED && !HasModalProgress();
+
+		uint64 tick_start = GetProfilerTime();
+		StateGameLoop();
+		tick_times[i] = (uint32)min<uint64>(GetProfilerTime() - tick_start, UINT32_MAX);
+		if (!measured) continue;
+
+		TickProfileSummary summary;
+		GetTickProfileSummary(&summary, 1);
+		for (TickPhase p = TP_BEGIN; p < TP_END; p++) phase_times[p] += summary.phase_avg[p];
+	}
+	uint64 total = GetProfilerTime() - start;
+
+	QSortT(tick_times, ticks, &TickTimeSorter);
+
+	printf("{\n");
+	printf("\t\"savegame\": ");
+	PrintJSONString(_file_to_saveload.name);
+	printf(",\n");
+	printf("\t\"ticks\": %u,\n", ticks);
+	printf("\t\"total_time_us\": " OTTD_PRINTF64 ",\n", (int64)total);
+	printf("\t\"ticks_per_second\": %.2f,\n", total == 0 ? 0.0 : ticks * 1000000.0 / total);
+	printf("\t\"tick_time_us\": {\n");
+	printf("\t\t\"mean\": " OTTD_PRINTF64 ",\n", (int64)(total / ticks));
+	printf("\t\t\"min\": %u,\n", tick_times[0]);
+	printf("\t\t\"p50\": %u,\n", GetPercentile(tick_times, ticks, 50));
+	printf("\t\t\"p90\": %u,\n", GetPercentile(tick_times, ticks, 90));
+	printf("\t\t\"p99\": %u,\n", GetPercentile(tick_times, ticks, 99));
+	printf("\t\t\"max\": %u\n", tick_times[ticks - 1]);
+	printf("\t},\n");
+	printf("\t\"peak_rss_kib\": " OTTD_PRINTF64 ",\n", (int64)GetPeakResidentSetSize());
+	printf("\t\"phase_time_us\": {\n");
+	for (TickPhase p = TP_BEGIN; p < TP_END; p++) {
+		/* Make identifiers of the phase names. */
+		char name[32];
+		strecpy(name, GetTickPhaseName(p), lastof(name));
+		for (char *c = name; *c != '\0'; c++) {
+			if (*c == ' ') *c = '_';
+		}
+		printf("\t\t\"%s\": " OTTD_PRINTF64 "%s\n", name, (int64)phase_times[p], p + 1 < TP_END ? "," : "");
+	}
+	printf("\t}\n");
+	printf("}\n");
+	fflush(stdout);
+
+	free(tick_times);
+}
+
+/** A tile with the layout of #Tile when the map is stored as an array of structures. */
+struct ScanTile {
+	byte   type;   ///< Copy of Tile::type.
+	byte   height; ///< Copy of Tile::height.
+	uint16 m2;     ///< Copy of Tile::m2.
+	byte   m1;     ///< Copy of Tile::m1.
+	byte   m3;     ///< Copy of Tile::m3.
+	byte   m4;     ///< Copy of Tile::m4.
+	byte   m5;     ///< Copy of Tile::m5.
+};
+assert_compile(sizeof(ScanTile) == 8);
+
+/** Reads one member of the tiles of an array of #ScanTile. */
+struct StructReader {
+	const ScanTile *tiles;  ///< The tiles.
+	byte ScanTile::*member; ///< The member to read.
+
+	inline byte operator()(uint t) const { return this->tiles[t].*this->member; }
+};
+
+/** Reads from an array with one member of all tiles. */
+struct ArrayReader {
+	const byte *array; ///< The member of all tiles.
+
+	inline byte operator()(uint t) const { return this->array[t]; }
+};
+
+/** Reads one member of the tiles of the actual map. */
+struct MapReader {
+	MapScanField field; ///< The member to read.
+
+	inline byte operator()(uint t) const
+	{
+		switch (this->field) {
+			case MSF_TYPE:   return _m[t].type;
+			case MSF_HEIGHT: return _m[t].height;
+			default:         return _m[t].m1;
+		}
+	}
+};
+
+/**
+ * Scan of the whole map that counts how often each value of a member of the
+ * tiles occurs, like a full map pass that looks at one member of each tile does.
+ */
+template <class Treader>
+struct MapScanPass {
+	Treader reader;  ///< Reads the member of a tile.
+	uint64 checksum; ///< Sum of the counts of all scans, so they can't be optimised away.
+
+	void operator()(uint)
+	{
+		uint size = MapSize();
+		uint counts[256] = { 0 };
+		for (uint t = 0; t < size; t++) counts[this->reader(t)]++;
+		for (uint i = 0; i < lengthof(counts); i++) this->checksum += (uint64)counts[i] * i;
+	}
+};
+
+/**
+ * Measure how long scanning the type, height and owner of all tiles takes,
+ * for the map in both the array of structures and structure of arrays
+ * layouts, and for the map as it is actually stored.
+ * @param passes The number of times to scan the map per measurement.
+ * @param[out] times The time in microseconds the scans took.
+ */
+void RunMapScanBenchmark(uint passes, MapScanTimes &times)
+{
+	uint size = MapSize();
+	ScanTile *tiles = MallocT<ScanTile>(size);
+	byte *arrays[MSF_END];
+	for (MapScanField f = MSF_TYPE; f < MSF_END; f = (MapScanField)(f + 1)) arrays[f] = MallocT<byte>(size);
+
+	for (uint t = 0; t < size; t++) {
+		tiles[t].type   = arrays[MSF_TYPE][t]   = _m[t].type;
+		tiles[t].height = arrays[MSF_HEIGHT][t] = _m[t].height;
+		tiles[t].m1     = arrays[MSF_OWNER][t]  = _m[t].m1;
+		tiles[t].m2     = _m[t].m2;
+		tiles[t].m3     = _m[t].m3;
+		tiles[t].m4     = _m[t].m4;
+		tiles[t].m5     = _m[t].m5;
+	}
+
+	static byte ScanTile::* const members[MSF_END] = { &ScanTile::type, &ScanTile::height, &ScanTile::m1 };
+
+	for (MapScanField f = MSF_TYPE; f < MSF_END; f = (MapScanField)(f + 1)) {
+		MapScanPass<StructReader> structs = { { tiles, members[f] }, 0 };
+		MapScanPass<ArrayReader> array = { { arrays[f] }, 0 };
+		MapScanPass<MapReader> map = { { f }, 0 };
+		times[MSL_STRUCTS][f] = TimeBenchmarkRuns(passes, structs);
+		times[MSL_ARRAYS][f]  = TimeBenchmarkRuns(passes, array);
+		times[MSL_MAP][f]     = TimeBenchmarkRuns(passes, map);
+
+		/* All layouts hold the same data, so they must count the same. */
+		assert(structs.checksum == array.checksum && array.checksum == map.checksum);
+	}
+
+	for (MapScanField f = MSF_TYPE; f < MSF_END; f = (MapScanField)(f + 1)) free(arrays[f]);
+	free(tiles);
+}
+
+/** A link graph like graph for benchmarking Dijkstra. */
+struct SyntheticGraph {
+	/** An edge of the graph. */
+	struct Edge {
+		uint to;       ///< Destination node.
+		uint distance; ///< Length of the edge.
+	};
+
+	std::vector<std::vector<Edge> > edges; ///< Outgoing edges per node.
+
+	/**
+	 * Create a graph with nodes at random places on a map of 1024x1024 tiles
+	 * that have edges to random other nodes. The graph only depends on the
+	 * parameters and does not use the game's random numbers.
+	 * @param nodes Number of nodes.
+	 * @param degree Number of outgoing edges per node.
+	 */
+	SyntheticGraph(uint nodes, uint degree) : edges(nodes)
+	{
+		uint32 seed = 0x9E3779B9;
+		std::vector<uint> x(nodes), y(nodes);
+		for (uint i = 0; i < nodes; i++) {
+			seed = seed * 1664525 + 1013904223;
+			x[i] = GB(seed, 8, 10);
+			y[i] = GB(seed, 20, 10);
+		}
+		for (uint from = 0; from < nodes; from++) {
+			for (uint e = 0; e < degree; e++) {
+				seed = seed * 1664525 + 1013904223;
+				uint to = (uint)((uint64)GB(seed, 8, 24) * nodes >> 24);
+				if (to == from) continue;
+				Edge edge = { to, Delta(x[from], x[to]) + Delta(y[from], y[to]) + 1 };
+				this->edges[from].push_back(edge);
+			}
+		}
+	}
+};
+
+/** Orders nodes by distance and then by ID, like the distance annotation of MCF. */
+struct DistanceComparator {
+	const uint *distance; ///< Distance of each node.
+
+	inline bool operator()(uint x, uint y) const
+	{
+		if (this->distance[x] != this->distance[y]) return this->distance[x] < this->distance[y];
+		return x < y;
+	}
+};
+
+/** Dijkstra with a std::set as priority queue, like MCF did; the run is the first node. */
+struct DijkstraWithSet {
+	const SyntheticGraph *graph; ///< The graph.
+	uint *distance;              ///< Distance of each node.
+	uint64 hash;                 ///< Sum of the hashes of the orders in which the nodes were visited.
+
+	void operator()(uint source)
+	{
+		uint size = (uint)this->graph->edges.size();
+		DistanceComparator comp = { this->distance };
+		std::set<uint, DistanceComparator> queue(comp);
+		for (uint i = 0; i < size; i++) {
+			this->distance[i] = i == source ? 0 : UINT_MAX;
+			queue.insert(i);
+		}
+
+		uint64 hash = 0;
+		while (!queue.empty()) {
+			uint from = *queue.begin();
+			queue.erase(queue.begin());
+			hash = hash * 31 + from;
+			if (this->distance[from] == UINT_MAX) continue;
+			const std::vector<SyntheticGraph::Edge> &edges = this->graph->edges[from];
+			for (std::vector<SyntheticGraph::Edge>::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+				if (this->distance[from] + it->distance >= this->distance[it->to]) continue;
+				queue.erase(it->to);
+				this->distance[it->to] = this->distance[from] + it->distance;
+				queue.insert(it->to);
+			}
+		}
+		this->hash += hash;
+	}
+};
+
+/** Dijkstra with an indexed heap as priority queue, like MCF does; the run is the first node. */
+struct DijkstraWithHeap {
+	const SyntheticGraph *graph; ///< The graph.
+	uint *distance;              ///< Distance of each node.
+	CIndexedHeapT<4> *heap;      ///< The heap to use.
+	uint64 hash;                 ///< Sum of the hashes of the orders in which the nodes were visited.
+
+	void operator()(uint source)
+	{
+		uint size = (uint)this->graph->edges.size();
+		DistanceComparator comp = { this->distance };
+		for (uint i = 0; i < size; i++) this->distance[i] = i == source ? 0 : UINT_MAX;
+		this->heap->Fill(size, comp);
+
+		uint64 hash = 0;
+		while (!this->heap->IsEmpty()) {
+			uint from = this->heap->Pop(comp);
+			hash = hash * 31 + from;
+			if (this->distance[from] == UINT_MAX) continue;
+			const std::vector<SyntheticGraph::Edge> &edges = this->graph->edges[from];
+			for (std::vector<SyntheticGraph::Edge>::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+				if (this->distance[from] + it->distance >= this->distance[it->to]) continue;
+				this->distance[it->to] = this->distance[from] + it->distance;
+				if (this->heap->Contains(it->to)) {
+					this->heap->Update(it->to, comp);
+				} else {
+					this->heap->Push(it->to, comp);
+				}
+			}
+		}
+		this->hash += hash;
+	}
+};
+
+/**
+ * Measure Dijkstra from every node of a synthetic link graph, with the
+ * std::set MCF used to use and with the indexed heap it uses now.
+ * @param nodes Number of nodes of the graph.
+ * @param degree Number of outgoing edges per node.
+ * @param[out] result The times and whether both gave the same result.
+ */
+void RunDijkstraBenchmark(uint nodes, uint degree, DijkstraBenchmarkResult &result)
+{
+	SyntheticGraph graph(nodes, degree);
+	uint *distance = MallocT<uint>(nodes);
+	CIndexedHeapT<4> heap;
+
+	DijkstraWithSet with_set = { &graph, distance, 0 };
+	DijkstraWithHeap with_heap = { &graph, distance, &heap, 0 };
+	result.set_time = TimeBenchmarkRuns(nodes, with_set);
+	result.heap_time = TimeBenchmarkRuns(nodes, with_heap);
+	result.identical = with_set.hash == with_heap.hash;
+	free(distance);
+}
+
+/** Key of the hash table benchmark; like the node keys of YAPF, a tile and a trackdir. */
+struct HashBenchmarkKey {
+	uint32 position; ///< Tile and trackdir, as (tile << 4 | trackdir).
+
+	inline int CalcHash() const
+	{
+		return this->position;
+	}
+
+	inline bool operator==(const HashBenchmarkKey &other) const
+	{
+		return this->position == other.position;
+	}
+};
+
+/** Item of the hash table benchmark; like a node of YAPF, it can be chained by CHashTableT. */
+struct HashBenchmarkItem {
+	typedef HashBenchmarkKey Key;
+
+	Key key;                      ///< The key.
+	HashBenchmarkItem *hash_next; ///< Next item in the chain of CHashTableT.
+
+	inline const Key &GetKey() const
+	{
+		return this->key;
+	}
+
+	inline HashBenchmarkItem *GetHashNext()
+	{
+		return this->hash_next;
+	}
+
+	inline void SetHashNext(HashBenchmarkItem *next)
+	{
+		this->hash_next = next;
+	}
+};
+
+/**
+ * Search that uses a hash table like the node lists of a path finder search:
+ * every position is looked up before it is added, and now and then an earlier
+ * position is removed again, like an open node that is closed.
+ */
+template <class Ttable>
+struct HashTableSearch {
+	HashBenchmarkItem *items; ///< The items, one per visited position; positions repeat.
+	uint count;               ///< Number of items.
+	uint64 checksum;          ///< The number of found and removed items of all searches.
+
+	void operator()(uint)
+	{
+		for (uint i = 0; i < this->count; i++) this->items[i].hash_next = NULL;
+
+		/* Like the node lists, every search has new tables. */
+		Ttable table;
+		for (uint i = 0; i < this->count; i++) {
+			if (table.Find(this->items[i].key) != NULL) {
+				this->checksum++;
+				continue;
+			}
+			table.Push(this->items[i]);
+			if (i % 4 == 3 && table.TryPop(this->items[i / 2].key) != NULL) this->checksum++;
+		}
+	}
+};
+
+/**
+ * Compare the chained hash table YAPF used to use with the open addressing
+ * one it uses now. The positions are those of a random walk over the map,
+ * so like in a path finder search many of them are close to each other and
+ * some are visited more than once.
+ * @param count Number of positions per search.
+ * @param runs Number of searches.
+ * @param[out] result The times and whether both found the same items.
+ */
+void RunHashTableBenchmark(uint count, uint runs, HashTableBenchmarkResult &result)
+{
+	HashBenchmarkItem *items = MallocT<HashBenchmarkItem>(count);
+	uint32 seed = 0x9E3779B9;
+	uint x = 128;
+	uint y = 128;
+	for (uint i = 0; i < count; i++) {
+		seed = seed * 1664525 + 1013904223;
+		switch (GB(seed, 24, 2)) {
+			case 0: x = (x + 1) & 0xFF; break;
+			case 1: x = (x - 1) & 0xFF; break;
+			case 2: y = (y + 1) & 0xFF; break;
+			case 3: y = (y - 1) & 0xFF; break;
+		}
+		items[i].key.position = (y << 8 | x) << 4 | GB(seed, 16, 3);
+	}
+
+	HashTableSearch<CHashTableT<HashBenchmarkItem, 10> > chained = { items, count, 0 };
+	HashTableSearch<COpenHashTableT<HashBenchmarkItem, 10> > open = { items, count, 0 };
+	result.chained_time = TimeBenchmarkRuns(runs, chained);
+	result.open_time = TimeBenchmarkRuns(runs, open);
+	result.identical = chained.checksum == open.checksum;
+	free(items);
+}
+
+/**
+ * Sort all captured lists of parent sprites a number of times with a sorter.
+ * @param captured The captured sprites.
+ * @param sorter The sprite sorter.
+ * @param runs Number of times every list is sorted.
+ * @param[out] order The sprites of all lists after the last run, as index in \a captured.
+ * @return Time in microseconds.
+ */
+static uint64 TimeSpriteSorter(CapturedParentSprites &captured, VpSpriteSorter sorter, uint runs, SmallVector<uint, 64> &order)
+{
+	ParentSpriteToSortVector psdv;
+	uint64 time = 0;
+	for (uint run = 0; run < runs; run++) {
+		order.Clear();
+		ParentSpriteToDraw *first = captured.sprites.Begin();
+		for (const uint *length = captured.lengths.Begin(); length != captured.lengths.End(); length++) {
+			/* Like ViewportDoDraw, the sprites are in the order they were added. */
+			psdv.Clear();
+			for (uint i = 0; i < *length; i++) {
+				first[i].comparison_done = false;
+				*psdv.Append() = &first[i];
+			}
+
+			uint64 start = GetProfilerTime();
+			sorter(&psdv);
+			time += GetProfilerTime() - start;
+
+			for (uint i = 0; i < *length; i++) *order.Append() = psdv[i] - captured.sprites.Begin();
+			first += *length;
+		}
+	}
+	return time;
+}
+
+/**
+ * Sort the parent sprites captured from the viewports with every sprite
+ * sorter, and check that they all sort them in the same order.
+ * @param file The file in the autosave directory with the captured sprites.
+ * @param runs Number of times every list is sorted.
+ * @param[out] result The times and whether the orders are identical.
+ * @return Whether the file could be read.
+ */
+bool RunSpriteSorterBenchmark(const char *file, uint runs, SpriteSorterBenchmarkResult &result)
+{
+	CapturedParentSprites captured;
+	if (!LoadCapturedParentSprites(file, captured)) return false;
+
+	result.lists = captured.lengths.Length();
+	result.sprites = captured.sprites.Length();
+
+	SmallVector<uint, 64> legacy_order;
+	SmallVector<uint, 64> order;
+	result.legacy_time = TimeSpriteSorter(captured, &ViewportSortParentSprites, runs, legacy_order);
+	result.graph_time = TimeSpriteSorter(captured, &ViewportSortParentSpritesGraph, runs, order);
+	result.identical = MemCmpT(order.Begin(), legacy_order.Begin(), order.Length()) == 0;
+
+	result.sse_time = 0;
+	result.sse_available = false;
+#ifdef WITH_SSE
+	if (ViewportSortParentSpritesSSE41Checker()) {
+		result.sse_available = true;
+		result.sse_time = TimeSpriteSorter(captured, &ViewportSortParentSpritesSSE41, runs, order);
+		result.identical &= MemCmpT(order.Begin(), legacy_order.Begin(), order.Length()) == 0;
+	}
+#endif
+	return true;
+}
+
+/**
+ * Replay recorded path finder queries against the current game, with YAPF
+ * and NPF, and with OPF for ships. Queries that do not fit the current game
+ * are skipped. For every replayed query a line with the time, the expanded
+ * nodes and the cache hits is written to a report.
+ * @param queries_file The file in the autosave directory with the queries.
+ * @param report_file The file in the autosave directory to write the report to.
+ * @param[out] results The results per vehicle type and path finder.
+ * @param[out] skipped Number of queries that could not be replayed.
+ * @return Whether the files could be read and written.
+ */
+bool RunPathfinderBenchmark(const char *queries_file, const char *report_file, PathfinderBenchmarkResults &results, uint &skipped)
+{
+	memset(results, 0, sizeof(results));
+	skipped = 0;
+
+	PathfinderQueries queries;
+	if (!LoadPathfinderQueries(queries_file, queries)) return false;
+
+	FILE *report = FioFOpenFile(report_file, "w", AUTOSAVE_DIR);
+	if (report == NULL) return false;
+	fputs("query,type,vehicle,pathfinder,time_us,nodes,cache_hits,path_found,result,recorded_pathfinder,recorded_result\n", report);
+
+	static const char * const type_names[] = { "train", "road", "ship" };
+	static const char * const pathfinder_names[] = { "opf", "npf", "yapf" };
+	assert_compile(lengthof(type_names) == VEH_SHIP + 1);
+	assert_compile(lengthof(pathfinder_names) == VPF_YAPF + 1);
+
+	for (uint i = 0; i < queries.Length(); i++) {
+		const PathfinderQuery &q = queries[i];
+		bool replayed = false;
+
+		for (uint pf = VPF_OPF; pf <= VPF_YAPF; pf++) {
+			if (pf == VPF_OPF && q.type != VEH_SHIP) continue;
+
+			PathfinderStats before = _pathfinder_stats;
+			uint64 start = GetProfilerTime();
+			uint result;
+			bool path_found;
+			if (!ReplayPathfinderQuery(q, (VehiclePathFinders)pf, result, path_found)) break;
+			uint64 time = GetProfilerTime() - start;
+			uint64 nodes = _pathfinder_stats.nodes - before.nodes;
+			uint64 cache_hits = _pathfinder_stats.cache_hits - before.cache_hits;
+			replayed = true;
+
+			PathfinderBenchmarkResult &r = results[q.type][pf];
+			r.queries++;
+			r.time += time;
+			r.nodes += nodes;
+			r.cache_hits += cache_hits;
+			if (q.pathfinder == pf) {
+				r.compared++;
+				if (q.result == result && q.path_found == path_found) r.same++;
+			}
+
+			fprintf(report, "%u,%s,%u,%s," OTTD_PRINTF64 "," OTTD_PRINTF64 "," OTTD_PRINTF64 ",%u,%u,%s,%u\n",
+					i, type_names[q.type], q.vehicle, pathfinder_names[pf], (int64)time, (int64)nodes, (int64)cache_hits,
+					path_found, result, pathfinder_names[q.pathfinder], q.result);
+		}
+
+		if (!replayed) skipped++;
+	}
+
+	FioFCloseFile(report);
+	return true;
+}
+
+/** A sprite of the blitter benchmark, encoded for one blitter. */
+struct BenchmarkSprite {
+	Sprite *sprite; ///< The encoded sprite.
+	int x;          ///< Position of the left edge on the canvas.
+	int y;          ///< Position of the top edge on the canvas.
+};
+
+/** Sprite allocator for the blitter benchmark; the sprites are not put in the sprite cache. */
+static void *BlitterBenchmarkAlloc(size_t size)
+{
+	return MallocT<byte>(size);
+}
+
+/** Drawing of all sprites on the canvas in #_screen. */
+struct BlitterDraw {
+	Blitter *blitter;                                ///< The blitter the sprites are encoded for.
+	const SmallVector<BenchmarkSprite, 64> *sprites; ///< The sprites.
+	BlitterMode mode;                                ///< The blitter mode to draw with.
+	const byte *remap;                               ///< The remap table for the blitter mode.
+
+	void operator()(uint)
+	{
+		for (const BenchmarkSprite *bs = this->sprites->Begin(); bs != this->sprites->End(); bs++) {
+			/* Like GfxBlitter, for a sprite that is not clipped. */
+			Blitter::BlitterParams bp;
+			bp.sprite = bs->sprite->data;
+			bp.remap = this->remap;
+			bp.skip_left = 0;
+			bp.skip_top = 0;
+			bp.width = bs->sprite->width;
+			bp.height = bs->sprite->height;
+			bp.sprite_width = bs->sprite->width;
+			bp.sprite_height = bs->sprite->height;
+			bp.left = bs->x;
+			bp.top = bs->y;
+			bp.dst = _screen.dst_ptr;
+			bp.pitch = _screen.pitch;
+			this->blitter->Draw(&bp, this->mode, ZOOM_LVL_NORMAL);
+		}
+	}
+};
+
+/** Drawing of transparent and greyscale colour mapping rectangles over all sprites on a canvas. */
+struct BlitterColourMapping {
+	Blitter *blitter;                                ///< The blitter.
+	const SmallVector<BenchmarkSprite, 64> *sprites; ///< The sprites.
+	void *canvas;                                    ///< The canvas.
+
+	void operator()(uint)
+	{
+		for (uint i = 0; i < this->sprites->Length(); i++) {
+			const BenchmarkSprite &bs = (*this->sprites)[i];
+			this->blitter->DrawColourMappingRect(this->blitter->MoveTo(this->canvas, bs.x, bs.y), bs.sprite->width, bs.sprite->height, i % 2 == 0 ? PALETTE_TO_TRANSPARENT : PALETTE_NEWSPAPER);
+		}
+	}
+};
+
+/** Palette animation of a blitter that does it itself. */
+struct BlitterPaletteAnimation {
+	Blitter *blitter; ///< The blitter.
+	Palette palette;  ///< The palette to animate to.
+
+	void operator()(uint)
+	{
+		this->blitter->PaletteAnimate(this->palette);
+	}
+};
+
+/**
+ * Get a checksum of the colours on a canvas.
+ * @param canvas The pixels.
+ * @param pixels Number of pixels.
+ * @param depth Screen depth of the canvas.
+ * @return The checksum.
+ */
+static uint32 GetCanvasChecksum(const void *canvas, uint pixels, uint depth)
+{
+	uint32 checksum = 2166136261U;
+	for (uint i = 0; i < pixels; i++) {
+		/* The alpha of the screen is never shown, and not every blitter keeps it. */
+		uint32 colour = depth == 32 ? ((const uint32 *)canvas)[i] & 0x00FFFFFF : ((const uint8 *)canvas)[i];
+		checksum = (checksum ^ colour) * 16777619U;
+	}
+	return checksum;
+}
+
+/**
+ * Draw the same sprites with every usable blitter: normally, with a colour
+ * remap and transparently, followed by colour mapping rectangles and palette
+ * animation. Every blitter draws on its own canvas of the size of the screen.
+ * @param count Number of sprites to draw, evenly spread over the loaded normal sprites.
+ * @param runs Number of times every sprite is drawn.
+ * @param[out] results The times and checksums per blitter.
+ * @return Number of sprites in the corpus.
+ */
+uint RunBlitterBenchmark(uint count, uint runs, BlitterBenchmarkResults &results)
+{
+	SmallVector<SpriteID, 64> normal_sprites;
+	for (SpriteID i = 0; i < GetMaxSpriteID(); i++) {
+		if (SpriteExists(i) && GetSpriteType(i) == ST_NORMAL) *normal_sprites.Append() = i;
+	}
+	count = min<uint>(count, normal_sprites.Length());
+	SmallVector<SpriteID, 64> corpus;
+	for (uint i = 0; i < count; i++) *corpus.Append() = normal_sprites[(uint64)i * normal_sprites.Length() / count];
+
+	/* Copy the recolour sprites, as other threads might remove them from the sprite cache. */
+	byte colour_remap[256];
+	byte transparent_remap[256];
+	MemCpyT(colour_remap, GetNonSprite(GENERAL_SPRITE_COLOUR(COLOUR_RED), ST_RECOLOUR) + 1, lengthof(colour_remap));
+	MemCpyT(transparent_remap, GetNonSprite(PALETTE_TO_TRANSPARENT, ST_RECOLOUR) + 1, lengthof(transparent_remap));
+
+	Palette palette = _cur_palette;
+	palette.first_dirty = PALETTE_ANIM_START;
+	palette.count_dirty = PALETTE_ANIM_SIZE;
+
+	SmallVector<BlitterFactory *, 16> factories;
+	BlitterFactory::GetBlitterFactories(factories);
+
+	VideoDriver::GetInstance()->AcquireBlitterLock();
+	const DrawPixelInfo old_screen = _screen;
+	const bool old_screen_disable_anim = _screen_disable_anim;
+	const int width = old_screen.width;
+	const int height = old_screen.height;
+	_screen_disable_anim = false;
+
+	for (BlitterFactory **factory = factories.Begin(); factory != factories.End(); factory++) {
+		Blitter *blitter = (*factory)->CreateInstance();
+		uint depth = blitter->GetScreenDepth();
+		if (depth == 0 || width == 0 || height == 0) {
+			delete blitter;
+			continue;
+		}
+
+		SmallVector<BenchmarkSprite, 64> sprites;
+		for (uint i = 0; i < corpus.Length(); i++) {
+			Sprite *sprite = (Sprite *)GetRawSpriteForBlitter(corpus[i], blitter, &BlitterBenchmarkAlloc);
+			if (sprite->width == 0 || sprite->height == 0 || sprite->width > width || sprite->height > height) {
+				free(sprite);
+				continue;
+			}
+			BenchmarkSprite *bs = sprites.Append();
+			bs->sprite = sprite;
+			bs->x = (i * 97) % (width - sprite->width + 1);
+			bs->y = (i * 61) % (height - sprite->height + 1);
+		}
+
+		void *canvas = CallocT<byte>((size_t)width * height * depth / 8);
+		_screen.dst_ptr = canvas;
+		_screen.pitch = width;
+		blitter->PostResize();
+		blitter->DrawRect(canvas, width, height, PC_DARK_GREY);
+
+		BlitterBenchmarkResult *result = results.Append();
+		result->name = (*factory)->GetName();
+		result->depth = depth;
+		BlitterDraw normal = { blitter, &sprites, BM_NORMAL, colour_remap };
+		BlitterDraw remap = { blitter, &sprites, BM_COLOUR_REMAP, colour_remap };
+		BlitterDraw transparent = { blitter, &sprites, BM_TRANSPARENT, transparent_remap };
+		BlitterColourMapping mapping = { blitter, &sprites, canvas };
+		result->normal_time = TimeBenchmarkRuns(runs, normal);
+		result->remap_time = TimeBenchmarkRuns(runs, remap);
+		result->transparent_time = TimeBenchmarkRuns(runs, transparent);
+		result->mapping_time = TimeBenchmarkRuns(runs, mapping);
+
+		/* Palette animation changes the colours of the blitters that do it, so it has to come after the checksum. */
+		result->checksum = GetCanvasChecksum(canvas, width * height, depth);
+
+		result->palette_animation = blitter->UsePaletteAnimation() == Blitter::PALETTE_ANIMATION_BLITTER;
+		result->palette_time = 0;
+		if (result->palette_animation) {
+			BlitterPaletteAnimation animation = { blitter, palette };
+			result->palette_time = TimeBenchmarkRuns(runs, animation);
+		}
+
+		_screen = old_screen;
+		free(canvas);
+		for (BenchmarkSprite *bs = sprites.Begin(); bs != sprites.End(); bs++) free(bs->sprite);
+		delete blitter;
+	}
+
+	_screen_disable_anim = old_screen_disable_anim;
+	VideoDriver::GetInstance()->ReleaseBlitterLock();
+	return count;
+}
@@ -0,0 +1,102 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file benchmark.h Running a number of game ticks as fast as possible and reporting the speed. */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "vehicle_type.h"
+#include "core/smallvec_type.hpp"
+
+/** Parts of the tiles that are read by the map scan benchmark. */
+enum MapScanField {
+	MSF_TYPE,   ///< The tile type, i.e. Tile::type.
+	MSF_HEIGHT, ///< The tile height, i.e. Tile::height.
+	MSF_OWNER,  ///< The owner, i.e. Tile::m1.
+	MSF_END,    ///< End marker.
+};
+
+/** Map layouts that are compared by the map scan benchmark. */
+enum MapScanLayout {
+	MSL_STRUCTS, ///< An array of 8 byte tiles, like the default map layout.
+	MSL_ARRAYS,  ///< One array per member of the tiles, like the structure of arrays map layout.
+	MSL_MAP,     ///< The actual map, through _m.
+	MSL_END,     ///< End marker.
+};
+
+/** Time in microseconds of scanning the whole map, per layout and field. */
+typedef uint64 MapScanTimes[MSL_END][MSF_END];
+
+/** Result of the Dijkstra benchmark. */
+struct DijkstraBenchmarkResult {
+	uint64 set_time;  ///< Time in microseconds with a std::set as priority queue.
+	uint64 heap_time; ///< Time in microseconds with an indexed heap as priority queue.
+	bool identical;   ///< Whether both visited the nodes in the same order.
+};
+
+/** Result of the hash table benchmark. */
+struct HashTableBenchmarkResult {
+	uint64 chained_time; ///< Time in microseconds with the chained CHashTableT.
+	uint64 open_time;    ///< Time in microseconds with the open addressing COpenHashTableT.
+	bool identical;      ///< Whether both found the same items.
+};
+
+/** Result of the sprite sorter benchmark. */
+struct SpriteSorterBenchmarkResult {
+	uint lists;          ///< Number of sorted lists of sprites.
+	uint sprites;        ///< Total number of sorted sprites.
+	uint64 legacy_time;  ///< Time in microseconds with the sorter that compares every sprite with every other sprite.
+	uint64 sse_time;     ///< Time in microseconds with the SSE 4.1 version of that sorter, if the CPU supports it.
+	uint64 graph_time;   ///< Time in microseconds with the sorter that only compares sprites that are close to each other.
+	bool sse_available;  ///< Whether the SSE 4.1 sorter was run.
+	bool identical;      ///< Whether all sorters sorted the sprites in the same order.
+};
+
+/** Result of replaying path finder queries of one vehicle type with one path finder. */
+struct PathfinderBenchmarkResult {
+	uint queries;      ///< Number of replayed queries.
+	uint compared;     ///< Number of replayed queries that were recorded with the same path finder.
+	uint same;         ///< Number of those queries that got the same answer as when they were recorded.
+	uint64 time;       ///< Total time in microseconds.
+	uint64 nodes;      ///< Total number of expanded nodes.
+	uint64 cache_hits; ///< Total number of cache hits.
+};
+
+/** Results of the path finder benchmark, per vehicle type and path finder. */
+typedef PathfinderBenchmarkResult PathfinderBenchmarkResults[VEH_SHIP + 1][VPF_YAPF + 1];
+
+/** Result of drawing the sprite corpus with one blitter. */
+struct BlitterBenchmarkResult {
+	const char *name;        ///< Name of the blitter.
+	uint depth;              ///< Screen depth of the blitter.
+	uint64 normal_time;      ///< Time in microseconds of drawing the sprites normally.
+	uint64 remap_time;       ///< Time in microseconds of drawing the sprites with a colour remap.
+	uint64 transparent_time; ///< Time in microseconds of drawing the sprites transparently.
+	uint64 mapping_time;     ///< Time in microseconds of drawing transparent and greyscale colour mapping rectangles.
+	uint64 palette_time;     ///< Time in microseconds of palette animation, if the blitter does it.
+	bool palette_animation;  ///< Whether the blitter does the palette animation itself.
+	uint32 checksum;         ///< Checksum of the colours on the canvas after drawing; blitters with the same depth should agree.
+};
+
+/** Results of the blitter benchmark, per usable blitter. */
+typedef SmallVector<BlitterBenchmarkResult, 16> BlitterBenchmarkResults;
+
+void RunBenchmark(uint ticks);
+void RunMapScanBenchmark(uint passes, MapScanTimes &times);
+void RunDijkstraBenchmark(uint nodes, uint degree, DijkstraBenchmarkResult &result);
+void RunHashTableBenchmark(uint count, uint runs, HashTableBenchmarkResult &result);
+bool RunSpriteSorterBenchmark(const char *file, uint runs, SpriteSorterBenchmarkResult &result);
+bool RunPathfinderBenchmark(const char *queries_file, const char *report_file, PathfinderBenchmarkResults &results, uint &skipped);
+uint RunBlitterBenchmark(uint count, uint runs, BlitterBenchmarkResults &results);
+
+bool GetBenchmarkArguments(byte argc, char *argv[], uint required, uint32 *values, uint count);
+void PrintBenchmarkTime(const char *label, uint64 time);
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,48 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file 32bpp_avx2.cpp Implementation of the AVX2 32 bpp blitter. */
+
+#ifdef WITH_AVX2
+
+#include "../stdafx.h"
+#include "../zoom_func.h"
+#include "../settings_type.h"
+#include "../table/sprites.h"
+#include "32bpp_avx2.hpp"
+#include "32bpp_sse_func.hpp"
+
+#include "../safeguards.h"
+
+/** Instantiation of the AVX2 32bpp blitter factory. */
+static FBlitter_32bppAVX2 iFBlitter_32bppAVX2;
+
+void Blitter_32bppAVX2::DrawColourMappingRect(void *dst, int width, int height, PaletteID pal)
+{
+	Colour *udst = (Colour *)dst;
+
+	if (pal == PALETTE_TO_TRANSPARENT) {
+		do {
+			MakeTransparentLine(udst, width);
+			udst += _screen.pitch;
+		} while (--height);
+		return;
+	}
+	if (pal == PALETTE_NEWSPAPER) {
+		do {
+			MakeGreyLine(udst, width);
+			udst += _screen.pitch;
+		} while (--height);
+		return;
+	}
+
+	DEBUG(misc, 0, "32bpp blitter doesn't know how to draw this colour table ('%d')", pal);
+}
+
+#endif /* WITH_AVX2 */
@@ -100,6 +100,95 @@ static inline __m128i DarkenTwoPixels(__m128i src, __m128i dst, const __m128i &d
 	return _mm_packus_epi16(dstAB, dstAB);
 }
 
+#if (SSE_VERSION >= 5)
+/* Alpha blend the pixels of one half of 8 pixels, expanded to uint16 like AlphaBlendTwoPixels() does. */
+static inline __m256i AlphaBlendHalfOfEightPixels(__m256i srcAB, __m256i dstAB, const __m256i &distribution_mask)
+{
+	__m256i alphaAB = _mm256_cmpgt_epi16(srcAB, _mm256_setzero_si256()); // if (alpha > 0) a++;
+	alphaAB = _mm256_srli_epi16(alphaAB, 15);
+	alphaAB = _mm256_add_epi16(alphaAB, srcAB);
+	alphaAB = _mm256_shuffle_epi8(alphaAB, distribution_mask);
+
+	srcAB = _mm256_sub_epi16(srcAB, dstAB);     //    (r - Cr)
+	srcAB = _mm256_mullo_epi16(srcAB, alphaAB); //  a*(r - Cr)
+	srcAB = _mm256_srli_epi16(srcAB, 8);        //  a*(r - Cr)/256
+	return _mm256_add_epi16(srcAB, dstAB);      //  a*(r - Cr)/256 + Cr
+}
+
+/* Alpha blend 8 pixels, with the same result as AlphaBlendTwoPixels() for each pair of them.
+ * The unpacks work within each lane, so the low half holds pixels 0, 1, 4 and 5 and the high half pixels 2, 3, 6 and 7.
+ */
+static inline __m256i AlphaBlendEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask, const __m256i &pack_low_mask, const __m256i &pack_high_mask)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i srcAB = AlphaBlendHalfOfEightPixels(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero), distribution_mask);
+	__m256i srcCD = AlphaBlendHalfOfEightPixels(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero), distribution_mask);
+	return _mm256_or_si256(_mm256_shuffle_epi8(srcAB, pack_low_mask), _mm256_shuffle_epi8(srcCD, pack_high_mask));
+}
+
+/* Darken 8 pixels, like DarkenTwoPixels(). */
+static inline __m256i DarkenEightPixels(__m256i src, __m256i dst, const __m256i &distribution_mask, const __m256i &tr_nom_base)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i alphaAB = _mm256_srli_epi16(_mm256_shuffle_epi8(_mm256_unpacklo_epi8(src, zero), distribution_mask), 2);
+	__m256i alphaCD = _mm256_srli_epi16(_mm256_shuffle_epi8(_mm256_unpackhi_epi8(src, zero), distribution_mask), 2);
+	__m256i dstAB = _mm256_mullo_epi16(_mm256_unpacklo_epi8(dst, zero), _mm256_sub_epi16(tr_nom_base, alphaAB));
+	__m256i dstCD = _mm256_mullo_epi16(_mm256_unpackhi_epi8(dst, zero), _mm256_sub_epi16(tr_nom_base, alphaCD));
+	return _mm256_packus_epi16(_mm256_srli_epi16(dstAB, 8), _mm256_srli_epi16(dstCD, 8));
+}
+
+/**
+ * Make a line of pixels transparent, like Blitter_32bppBase::MakeTransparent() with a nominator of 154.
+ * @param dst The first pixel.
+ * @param width The number of pixels.
+ */
+static inline void MakeTransparentLine(Colour *dst, int width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i nom = _mm256_set1_epi16(154);
+	const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+	for (; width >= 8; width -= 8) {
+		__m256i colours = _mm256_loadu_si256((const __m256i *) dst);
+		__m256i colAB = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(colours, zero), nom), 8);
+		__m256i colCD = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(colours, zero), nom), 8);
+		_mm256_storeu_si256((__m256i *) dst, _mm256_or_si256(_mm256_packus_epi16(colAB, colCD), alpha));
+		dst += 8;
+	}
+	for (; width > 0; width--) {
+		*dst = Blitter_32bppBase::MakeTransparent(*dst, 154);
+		dst++;
+	}
+}
+
+/**
+ * Make a line of pixels grey, like Blitter_32bppBase::MakeGrey().
+ * @param dst The first pixel.
+ * @param width The number of pixels.
+ */
+static inline void MakeGreyLine(Colour *dst, int width)
+{
+	const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+	const __m256i r_nom = _mm256_set1_epi32(19595);
+	const __m256i g_nom = _mm256_set1_epi32(38470);
+	const __m256i b_nom = _mm256_set1_epi32(7471);
+	const __m256i grey_cm = GREY_CONTROL_MASK_256;
+	const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+	for (; width >= 8; width -= 8) {
+		__m256i colours = _mm256_loadu_si256((const __m256i *) dst);
+		__m256i grey = _mm256_mullo_epi32(_mm256_and_si256(colours, byte_mask), b_nom);
+		grey = _mm256_add_epi32(grey, _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(colours, 8), byte_mask), g_nom));
+		grey = _mm256_add_epi32(grey, _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(colours, 16), byte_mask), r_nom));
+		grey = _mm256_shuffle_epi8(_mm256_srli_epi32(grey, 16), grey_cm);
+		_mm256_storeu_si256((__m256i *) dst, _mm256_or_si256(grey, alpha));
+		dst += 8;
+	}
+	for (; width > 0; width--) {
+		*dst = Blitter_32bppBase::MakeGrey(*dst);
+		dst++;
+	}
+}
+#endif /* SSE_VERSION >= 5 */
+
 IGNORE_UNINITIALIZED_WARNING_START
 static Colour ReallyAdjustBrightness(Colour colour, uint8 brightness)
 {
@@ -200,6 +289,8 @@ inline void Blitter_32bppSSE2::Draw(const Blitter::BlitterParams *bp, ZoomLevel
 inline void Blitter_32bppSSSE3::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
 #elif (SSE_VERSION == 4)
 inline void Blitter_32bppSSE4::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
+#elif (SSE_VERSION == 5)
+inline void Blitter_32bppAVX2::Draw(const Blitter::BlitterParams *bp, ZoomLevel zoom)
 #endif
 {
 	const byte * const remap = bp->remap;
@@ -234,6 +325,14 @@ inline void Blitter_32bppSSE4::Draw(const Blitter::BlitterParams *bp, ZoomLevel
 	#define DARKEN_PARAM_2      tr_nom_base
 #endif
 	const __m128i tr_nom_base = TRANSPARENT_NOM_BASE;
+#if (SSE_VERSION >= 5)
+	const __m256i a_cm_256        = ALPHA_CONTROL_MASK_256;
+	const __m256i pack_low_cm_256  = PACK_LOW_CONTROL_MASK_256;
+	const __m256i pack_high_cm_256 = PACK_HIGH_CONTROL_MASK_256;
+	const __m256i tr_nom_base_256 = TRANSPARENT_NOM_BASE_256;
+	const __m256i alpha_mask_256  = _mm256_set1_epi32((int) 0xFF000000);
+	const __m128i m_mask          = _mm_set1_epi16(0x00FF);
+#endif
 
 	for (int y = bp->height; y != 0; y--) {
 		Colour *dst = dst_line;
@@ -256,7 +355,20 @@ inline void Blitter_32bppSSE4::Draw(const Blitter::BlitterParams *bp, ZoomLevel
 		switch (mode) {
 			default:
 				if (!translucent) {
+#if (SSE_VERSION >= 5)
+					for (uint x = (uint) effective_width / 8; x > 0; x--) {
+						/* Keep the destination where the source is fully transparent. */
+						__m256i srcABCD = _mm256_loadu_si256((const __m256i*) src);
+						__m256i dstABCD = _mm256_loadu_si256((__m256i*) dst);
+						__m256i transparent = _mm256_cmpeq_epi32(_mm256_and_si256(srcABCD, alpha_mask_256), _mm256_setzero_si256());
+						_mm256_storeu_si256((__m256i*) dst, _mm256_blendv_epi8(srcABCD, dstABCD, transparent));
+						src += 8;
+						dst += 8;
+					}
+					for (uint x = (uint) effective_width & 7; x > 0; x--) {
+#else
 					for (uint x = (uint) effective_width; x > 0; x--) {
+#endif
 						if (src->a) *dst = *src;
 						src++;
 						dst++;
@@ -264,7 +376,19 @@ inline void Blitter_32bppSSE4::Draw(const Blitter::BlitterParams *bp, ZoomLevel
 					break;
 				}
 
+#if (SSE_VERSION >= 5)
+				for (uint x = (uint) effective_width / 8; x > 0; x--) {
+					__m256i srcABCD = _mm256_loadu_si256((const __m256i*) src);
+					__m256i dstABCD = _mm256_loadu_si256((__m256i*) dst);
+					_mm256_storeu_si256((__m256i*) dst, AlphaBlendEightPixels(srcABCD, dstABCD, a_cm_256, pack_low_cm_256, pack_high_cm_256));
+					src += 8;
+					dst += 8;
+				}
+
+				for (uint x = ((uint) effective_width & 7) / 2; x > 0; x--) {
+#else
 				for (uint x = (uint) effective_width / 2; x > 0; x--) {
+#endif
 					__m128i srcABCD = _mm_loadl_epi64((const __m128i*) src);
 					__m128i dstABCD = _mm_loadl_epi64((__m128i*) dst);
 					_mm_storel_epi64((__m128i*) dst, AlphaBlendTwoPixels(srcABCD, dstABCD, ALPHA_BLEND_PARAM_1, ALPHA_BLEND_PARAM_2));
@@ -282,6 +406,19 @@ inline void Blitter_32bppSSE4::Draw(const Blitter::BlitterParams *bp, ZoomLevel
 			case BM_COLOUR_REMAP:
 #if (SSE_VERSION >= 3)
 				for (uint x = (uint) effective_width / 2; x > 0; x--) {
+#if (SSE_VERSION >= 5)
+					/* Blend 8 pixels at once when none of them is remapped. */
+					if (x >= 4 && _mm_testz_si128(_mm_loadu_si128((const __m128i*) src_mv), m_mask)) {
+						__m256i srcABCD = _mm256_loadu_si256((const __m256i*) src);
+						__m256i dstABCD = _mm256_loadu_si256((__m256i*) dst);
+						_mm256_storeu_si256((__m256i*) dst, AlphaBlendEightPixels(srcABCD, dstABCD, a_cm_256, pack_low_cm_256, pack_high_cm_256));
+						dst += 8;
+						src += 8;
+						src_mv += 8;
+						x -= 3;
+						continue;
+					}
+#endif
 					__m128i srcABCD = _mm_loadl_epi64((const __m128i*) src);
 					__m128i dstABCD = _mm_loadl_epi64((__m128i*) dst);
 					uint32 mvX2 = *((uint32 *) const_cast<MapValue *>(src_mv));
@@ -363,7 +500,19 @@ bmcr_alpha_blend_single:
 
 			case BM_TRANSPARENT:
 				/* Make the current colour a bit more black, so it looks like this image is transparent. */
+#if (SSE_VERSION >= 5)
+				for (uint x = (uint) bp->width / 8; x > 0; x--) {
+					__m256i srcABCD = _mm256_loadu_si256((const __m256i*) src);
+					__m256i dstABCD = _mm256_loadu_si256((__m256i*) dst);
+					_mm256_storeu_si256((__m256i *) dst, DarkenEightPixels(srcABCD, dstABCD, a_cm_256, tr_nom_base_256));
+					src += 8;
+					dst += 8;
+				}
+
+				for (uint x = ((uint) bp->width & 7) / 2; x > 0; x--) {
+#else
 				for (uint x = (uint) bp->width / 2; x > 0; x--) {
+#endif
 					__m128i srcABCD = _mm_loadl_epi64((const __m128i*) src);
 					__m128i dstABCD = _mm_loadl_epi64((__m128i*) dst);
 					_mm_storel_epi64((__m128i *) dst, DarkenTwoPixels(srcABCD, dstABCD, DARKEN_PARAM_1, DARKEN_PARAM_2));
@@ -428,6 +577,8 @@ void Blitter_32bppSSE2::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomL
 void Blitter_32bppSSSE3::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
 #elif (SSE_VERSION == 4)
 void Blitter_32bppSSE4::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
+#elif (SSE_VERSION == 5)
+void Blitter_32bppAVX2::Draw(Blitter::BlitterParams *bp, BlitterMode mode, ZoomLevel zoom)
 #endif
 {
 	switch (mode) {
@@ -21,6 +21,8 @@
 #include <tmmintrin.h>
 #elif (SSE_VERSION == 4)
 #include <smmintrin.h>
+#elif (SSE_VERSION == 5)
+#include <immintrin.h>
 #endif
 
 #define META_LENGTH 2 ///< Number of uint32 inserted before each line of pixels in a sprite.
@@ -52,5 +54,12 @@ typedef union ALIGN(16) um128i {
 #define OVERBRIGHT_CONTROL_MASK     _mm_setr_epi8( 0,  1,  0,  1,  0,  1,  7,  7,  2,  3,  2,  3,  2,  3,  7,  7)
 #define TRANSPARENT_NOM_BASE        _mm_setr_epi16(256, 256, 256, 256, 256, 256, 256, 256)
 
+/* The AVX2 shuffles work within each 128 bits lane, so the masks are the same for both lanes. */
+#define ALPHA_CONTROL_MASK_256      _mm256_setr_epi8( 6,  7,  6,  7,  6,  7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1,  6,  7,  6,  7,  6,  7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1)
+#define PACK_LOW_CONTROL_MASK_256   _mm256_setr_epi8( 0,  2,  4, -1,  8, 10, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  2,  4, -1,  8, 10, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1)
+#define PACK_HIGH_CONTROL_MASK_256  _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,  0,  2,  4, -1,  8, 10, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  2,  4, -1,  8, 10, 12, -1)
+#define GREY_CONTROL_MASK_256       _mm256_setr_epi8( 0,  0,  0, -1,  4,  4,  4, -1,  8,  8,  8, -1, 12, 12, 12, -1,  0,  0,  0, -1,  4,  4,  4, -1,  8,  8,  8, -1, 12, 12, 12, -1)
+#define TRANSPARENT_NOM_BASE_256    _mm256_set1_epi16(256)
+
 #endif /* WITH_SSE */
 #endif /* BLITTER_32BPP_SSE_TYPE_HPP */
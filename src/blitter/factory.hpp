@@ -16,6 +16,7 @@
 #include "../debug.h"
 #include "../string_func.h"
 #include "../core/string_compare_type.hpp"
+#include "../core/smallvec_type.hpp"
 #include <map>
 
 #if defined(WITH_COCOA)
@@ -168,6 +169,18 @@ public:
 		return p;
 	}
 
+	/**
+	 * Get the factories of all usable blitters.
+	 * @param[out] factories The factories, ordered by the names of their blitters.
+	 */
+	static void GetBlitterFactories(SmallVector<BlitterFactory *, 16> &factories)
+	{
+		Blitters::iterator it = GetBlitters().begin();
+		for (; it != GetBlitters().end(); it++) {
+			*factories.Append() = (*it).second;
+		}
+	}
+
 	/**
 	 * Get the long, human readable, name for the Blitter-class.
 	 */
@@ -45,6 +45,15 @@ struct CompanyInfrastructure {
 	}
 };
 
+/** Aggregates of the vehicles and stations of a company that are used for its performance rating. */
+struct CompanyRatingCache {
+	uint32 profitable_vehicles; ///< Number of primary vehicles that made a profit last year.
+	uint32 profit_vehicles;     ///< Number of primary vehicles that are old enough to count for the minimum profit.
+	Money min_profit;           ///< Lowest profit last year of the vehicles counted in #profit_vehicles.
+	bool min_profit_valid;      ///< Whether #min_profit is up to date; it is recomputed when the vehicle with the lowest profit went away.
+	uint32 serviced_facilities; ///< Number of facilities of the stations that were serviced recently.
+};
+
 typedef Pool<Company, CompanyID, 1, MAX_COMPANIES> CompanyPool;
 extern CompanyPool _company_pool;
 
@@ -123,6 +132,7 @@ struct Company : CompanyPool::PoolItem<&_company_pool>, CompanyProperties {
 	GroupStatistics group_default[VEH_COMPANY_END];  ///< NOSAVE: Statistics for the DEFAULT_GROUP group.
 
 	CompanyInfrastructure infrastructure; ///< NOSAVE: Counts of company owned infrastructure.
+	CompanyRatingCache rating_cache;      ///< NOSAVE: Aggregates for the performance rating.
 
 	/**
 	 * Is this company a valid company, controlled by the computer (a NoAI program)?
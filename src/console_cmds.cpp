@@ -38,6 +38,11 @@
 #include "console_func.h"
 #include "engine_base.h"
 #include "game/game.hpp"
+#include "tick_profiler.h"
+#include "benchmark.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "pathfinder/pf_record.h"
+#include "viewport_sprite_sorter.h"
 #include "table/strings.h"
 
 #include "safeguards.h"
@@ -1314,6 +1319,297 @@ DEF_CONSOLE_CMD(ConGetSeed)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConPerformance)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show how much time the parts of the game loop took. Usage: 'perf [<ticks>]'");
+		IConsoleHelp("Times are in microseconds, over the last <ticks> ticks (by default all ticks that are kept).");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	uint32 ticks = TICK_PROFILE_LENGTH;
+	if (argc == 2 && (!GetArgumentInteger(&ticks, argv[1]) || ticks == 0)) return false;
+
+	TickProfileSummary summary;
+	GetTickProfileSummary(&summary, ticks);
+	if (summary.ticks == 0) {
+		IConsolePrint(CC_WARNING, "No ticks have been measured yet.");
+		return true;
+	}
+
+	IConsolePrintF(CC_DEFAULT, "Game loop over the last %u ticks (average / maximum):", summary.ticks);
+	for (TickPhase p = TP_BEGIN; p < TP_END; p++) {
+		IConsolePrintF(CC_DEFAULT, "  %-15s %8u / %8u", GetTickPhaseName(p), summary.phase_avg[p], summary.phase_max[p]);
+	}
+	IConsolePrintF(CC_DEFAULT, "  %-15s %8u / %8u", "total", summary.total_avg, summary.total_max);
+
+	for (uint s = 0; s < TICK_PROFILE_SCRIPTS; s++) {
+		if (!summary.script_active[s]) continue;
+		if (s == TICK_PROFILE_GAMESCRIPT) {
+			IConsolePrintF(CC_DEFAULT, "Game script: %u us, %u opcodes per tick", summary.script_time[s], summary.script_ops[s]);
+		} else {
+			IConsolePrintF(CC_DEFAULT, "AI of company %u: %u us, %u opcodes per tick", s + 1, summary.script_time[s], summary.script_ops[s]);
+		}
+	}
+	return true;
+}
+
+/**
+ * Print the counters of a YAPF cache.
+ * @param name Name of the cache.
+ * @param what What the cache holds.
+ * @param stats The counters.
+ */
+static void PrintYapfCacheStats(const char *name, const char *what, const YapfCacheStats &stats)
+{
+	uint64 lookups = stats.hits + stats.misses;
+	IConsolePrintF(CC_DEFAULT, "%s %s cached: %u", name, what, stats.segments);
+	IConsolePrintF(CC_DEFAULT, "  Hits:      " OTTD_PRINTF64, (int64)stats.hits);
+	IConsolePrintF(CC_DEFAULT, "  Misses:    " OTTD_PRINTF64, (int64)stats.misses);
+	IConsolePrintF(CC_DEFAULT, "  Hit rate:  %u%%", lookups == 0 ? 0 : (uint)(stats.hits * 100 / lookups));
+	IConsolePrintF(CC_DEFAULT, "  Evictions: " OTTD_PRINTF64, (int64)stats.evictions);
+	IConsolePrintF(CC_DEFAULT, "  Flushes:   " OTTD_PRINTF64, (int64)stats.flushes);
+}
+
+DEF_CONSOLE_CMD(ConYapfCache)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show how well the segment cost caches, the road vehicle route cache and the rail station distance cache of the YAPF path finders work. Usage: 'yapf_cache [reset]'");
+		IConsoleHelp("With 'reset' the counters are set to zero. Route cache evictions are routes that could not be used as a road stop was occupied differently.");
+		IConsoleHelp("Station distances are only searched when pf.yapf.rail_search_from_destination is set.");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset") != 0) return false;
+		YapfResetCacheStats();
+		YapfResetRoadRouteCacheStats();
+		YapfResetRailStationDistancesStats();
+		IConsolePrint(CC_DEFAULT, "YAPF cache counters reset.");
+		return true;
+	}
+
+	static const TransportType types[] = { TRANSPORT_RAIL, TRANSPORT_ROAD };
+	static const char * const names[] = { "Rail", "Road" };
+	assert_compile(lengthof(types) == lengthof(names));
+
+	for (uint i = 0; i < lengthof(types); i++) {
+		YapfCacheStats stats;
+		YapfGetCacheStats(types[i], &stats);
+		PrintYapfCacheStats(names[i], "segments", stats);
+	}
+
+	YapfCacheStats stats;
+	YapfGetRoadRouteCacheStats(&stats);
+	PrintYapfCacheStats("Road", "routes", stats);
+	YapfGetRailStationDistancesStats(&stats);
+	PrintYapfCacheStats("Rail", "station distances", stats);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkMap)
+{
+	if (argc == 0) {
+		IConsoleHelp("Measure how fast the whole map can be scanned with different map layouts. Usage: 'benchmark_map [<passes>]'");
+		IConsoleHelp("Shows million tiles per second when reading one member of each tile, averaged over <passes> scans (default 10).");
+		return true;
+	}
+
+	uint32 passes = 10;
+	if (!GetBenchmarkArguments(argc, argv, 1, &passes, 1)) return false;
+
+	MapScanTimes times;
+	RunMapScanBenchmark(passes, times);
+
+	static const char * const layouts[MSL_END] = { "array of structs", "struct of arrays", "map" };
+	uint64 tiles = (uint64)MapSize() * passes;
+	IConsolePrintF(CC_DEFAULT, "Scanning %u tiles %u times, million tiles per second (type / height / owner):", MapSize(), passes);
+	for (MapScanLayout l = MSL_STRUCTS; l < MSL_END; l = (MapScanLayout)(l + 1)) {
+		IConsolePrintF(CC_DEFAULT, "  %-17s %8.1f / %8.1f / %8.1f", layouts[l],
+				(double)tiles / max<uint64>(times[l][MSF_TYPE], 1),
+				(double)tiles / max<uint64>(times[l][MSF_HEIGHT], 1),
+				(double)tiles / max<uint64>(times[l][MSF_OWNER], 1));
+	}
+#if defined(WITH_SOA_MAP)
+	IConsolePrint(CC_DEFAULT, "The map is stored as struct of arrays.");
+#else
+	IConsolePrint(CC_DEFAULT, "The map is stored as array of structs.");
+#endif
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkDijkstra)
+{
+	if (argc == 0) {
+		IConsoleHelp("Compare the priority queues for Dijkstra of the cargo distribution on a synthetic graph. Usage: 'benchmark_dijkstra [<nodes> [<degree>]]'");
+		IConsoleHelp("Runs Dijkstra from every node of a graph with <nodes> nodes (default 1000) with <degree> edges each (default 6).");
+		return true;
+	}
+
+	uint32 args[] = { 1000, 6 }; // nodes, degree
+	if (!GetBenchmarkArguments(argc, argv, 1, args, lengthof(args))) return false;
+
+	DijkstraBenchmarkResult result;
+	RunDijkstraBenchmark(args[0], args[1], result);
+
+	IConsolePrintF(CC_DEFAULT, "Dijkstra from all %u nodes with %u edges each:", args[0], args[1]);
+	PrintBenchmarkTime("std::set:", result.set_time);
+	PrintBenchmarkTime("indexed heap:", result.heap_time);
+	if (!result.identical) IConsolePrint(CC_ERROR, "The nodes were visited in a different order!");
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkHashTable)
+{
+	if (argc == 0) {
+		IConsoleHelp("Compare the hash tables of the YAPF node lists on a synthetic search. Usage: 'benchmark_hash [<nodes> [<runs>]]'");
+		IConsoleHelp("Runs <runs> searches (default 100) that each visit <nodes> positions (default 10000).");
+		return true;
+	}
+
+	uint32 args[] = { 10000, 100 }; // nodes, runs
+	if (!GetBenchmarkArguments(argc, argv, 1, args, lengthof(args))) return false;
+
+	HashTableBenchmarkResult result;
+	RunHashTableBenchmark(args[0], args[1], result);
+
+	IConsolePrintF(CC_DEFAULT, "%u searches of %u positions:", args[1], args[0]);
+	PrintBenchmarkTime("chained:", result.chained_time);
+	PrintBenchmarkTime("open addressing:", result.open_time);
+	if (!result.identical) IConsolePrint(CC_ERROR, "The hash tables found different items!");
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConCaptureSprites)
+{
+	if (argc == 0) {
+		IConsoleHelp("Capture the parent sprites of the next drawn viewport areas to a file in the autosave directory. Usage: 'capture_sprites <file> [<areas>]'");
+		IConsoleHelp("Captures <areas> areas (default 100); scroll around or zoom out to capture large ones. 'benchmark_sprite_sort' sorts them again.");
+		return true;
+	}
+
+	if (argc < 2 || argc > 3) return false;
+
+	uint32 lists = 100;
+	if (argc == 3 && (!GetArgumentInteger(&lists, argv[2]) || lists == 0)) return false;
+
+	if (!StartCapturingParentSprites(argv[1], lists)) {
+		IConsolePrintF(CC_ERROR, "Cannot write to '%s'.", argv[1]);
+		return true;
+	}
+	IConsolePrintF(CC_DEFAULT, "Capturing the parent sprites of %u drawn areas to '%s'.", lists, argv[1]);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkSpriteSort)
+{
+	if (argc == 0) {
+		IConsoleHelp("Sort parent sprites captured with 'capture_sprites' with every sprite sorter. Usage: 'benchmark_sprite_sort <file> [<runs>]'");
+		IConsoleHelp("Sorts every captured list <runs> times (default 10).");
+		return true;
+	}
+
+	uint32 runs = 10;
+	if (!GetBenchmarkArguments(argc, argv, 2, &runs, 1)) return false;
+
+	SpriteSorterBenchmarkResult result;
+	if (!RunSpriteSorterBenchmark(argv[1], runs, result)) {
+		IConsolePrintF(CC_ERROR, "Cannot read '%s'.", argv[1]);
+		return true;
+	}
+
+	IConsolePrintF(CC_DEFAULT, "%u lists with %u sprites, sorted %u times:", result.lists, result.sprites, runs);
+	PrintBenchmarkTime("compare all:", result.legacy_time);
+	if (result.sse_available) PrintBenchmarkTime("compare all, SSE 4.1:", result.sse_time);
+	PrintBenchmarkTime("compare nearby:", result.graph_time);
+	if (!result.identical) IConsolePrint(CC_ERROR, "The sprites were sorted in a different order!");
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkBlitters)
+{
+	if (argc == 0) {
+		IConsoleHelp("Draw the same sprites with every usable blitter and compare the times. Usage: 'benchmark_blitters [<sprites> [<runs>]]'");
+		IConsoleHelp("Draws <sprites> sprites (default 2000) <runs> times (default 10) in every blitter mode, followed by colour mapping and palette animation.");
+		return true;
+	}
+
+	uint32 args[] = { 2000, 10 }; // sprites, runs
+	if (!GetBenchmarkArguments(argc, argv, 1, args, lengthof(args))) return false;
+
+	BlitterBenchmarkResults results;
+	uint count = RunBlitterBenchmark(args[0], args[1], results);
+
+	IConsolePrintF(CC_DEFAULT, "%u sprites drawn %u times on a %dx%d canvas:", count, args[1], _screen.width, _screen.height);
+	for (const BlitterBenchmarkResult *r = results.Begin(); r != results.End(); r++) {
+		IConsolePrintF(CC_DEFAULT, "  %-16s normal: " OTTD_PRINTF64 " us, remap: " OTTD_PRINTF64 " us, transparent: " OTTD_PRINTF64 " us, mapping: " OTTD_PRINTF64 " us, checksum: %08X",
+				r->name, (int64)r->normal_time, (int64)r->remap_time, (int64)r->transparent_time, (int64)r->mapping_time, r->checksum);
+		if (r->palette_animation) IConsolePrintF(CC_DEFAULT, "  %-16s palette animation: " OTTD_PRINTF64 " us", "", (int64)r->palette_time);
+	}
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConPathfinderRecord)
+{
+	if (argc == 0) {
+		IConsoleHelp("Record all path finder queries of vehicles to a file in the autosave directory. Usage: 'pf_record <file> | stop'");
+		IConsoleHelp("Save the game when starting to record, so 'benchmark_pf' can replay the queries against it.");
+		return true;
+	}
+
+	if (argc != 2) return false;
+
+	if (strcmp(argv[1], "stop") == 0) {
+		StopRecordingPathfinderQueries();
+		IConsolePrint(CC_DEFAULT, "Stopped recording path finder queries.");
+		return true;
+	}
+
+	if (!StartRecordingPathfinderQueries(argv[1])) {
+		IConsolePrintF(CC_ERROR, "Cannot write to '%s'.", argv[1]);
+		return true;
+	}
+	IConsolePrintF(CC_DEFAULT, "Recording path finder queries to '%s'.", argv[1]);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkPathfinder)
+{
+	if (argc == 0) {
+		IConsoleHelp("Replay path finder queries recorded with 'pf_record' against the current game with every path finder. Usage: 'benchmark_pf <file> [<report>]'");
+		IConsoleHelp("Writes the time, expanded nodes and cache hits of every query to <report> (default 'pf_benchmark.csv') in the autosave directory.");
+		return true;
+	}
+
+	if (argc < 2 || argc > 3) return false;
+
+	const char *report = argc == 3 ? argv[2] : "pf_benchmark.csv";
+	PathfinderBenchmarkResults results;
+	uint skipped;
+	if (!RunPathfinderBenchmark(argv[1], report, results, skipped)) {
+		IConsolePrintF(CC_ERROR, "Cannot read '%s' or write '%s'.", argv[1], report);
+		return true;
+	}
+
+	static const char * const types[] = { "Trains", "Road vehicles", "Ships" };
+	static const char * const pathfinders[] = { "OPF", "NPF", "YAPF" };
+	for (uint type = VEH_TRAIN; type <= VEH_SHIP; type++) {
+		for (uint pf = VPF_OPF; pf <= VPF_YAPF; pf++) {
+			const PathfinderBenchmarkResult &r = results[type][pf];
+			if (r.queries == 0) continue;
+			IConsolePrintF(CC_DEFAULT, "%s, %s: %u queries, " OTTD_PRINTF64 " us (" OTTD_PRINTF64 " us per query), " OTTD_PRINTF64 " nodes, " OTTD_PRINTF64 " cache hits",
+					types[type], pathfinders[pf], r.queries, (int64)r.time, (int64)(r.time / r.queries), (int64)r.nodes, (int64)r.cache_hits);
+			if (r.compared != 0) IConsolePrintF(CC_DEFAULT, "  %u of %u queries answered as recorded", r.same, r.compared);
+		}
+	}
+	if (skipped != 0) IConsolePrintF(CC_WARNING, "%u queries do not fit this game and were skipped.", skipped);
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConGetDate)
 {
 	if (argc == 0) {
@@ -1915,6 +2211,16 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("restart",      ConRestart);
 	IConsoleCmdRegister("getseed",      ConGetSeed);
 	IConsoleCmdRegister("getdate",      ConGetDate);
+	IConsoleCmdRegister("perf",         ConPerformance);
+	IConsoleCmdRegister("yapf_cache",   ConYapfCache);
+	IConsoleCmdRegister("benchmark_map", ConBenchmarkMap);
+	IConsoleCmdRegister("benchmark_dijkstra", ConBenchmarkDijkstra);
+	IConsoleCmdRegister("benchmark_hash", ConBenchmarkHashTable);
+	IConsoleCmdRegister("benchmark_pf", ConBenchmarkPathfinder);
+	IConsoleCmdRegister("pf_record",    ConPathfinderRecord);
+	IConsoleCmdRegister("benchmark_sprite_sort", ConBenchmarkSpriteSort);
+	IConsoleCmdRegister("benchmark_blitters", ConBenchmarkBlitters);
+	IConsoleCmdRegister("capture_sprites", ConCaptureSprites);
 	IConsoleCmdRegister("quit",         ConExit);
 	IConsoleCmdRegister("resetengines", ConResetEngines, ConHookNoNetwork);
 	IConsoleCmdRegister("reset_enginepool", ConResetEnginePool, ConHookNoNetwork);
@@ -93,7 +93,25 @@ uint64 ottd_rdtsc() {return 0;}
 #if defined(_MSC_VER)
 void ottd_cpuid(int info[4], int type)
 {
+#if _MSC_FULL_VER >= 150030729 // VS 2008 SP1
+	__cpuidex(info, type, 0);
+#else
 	__cpuid(info, type);
+#endif
+}
+
+/**
+ * Get the features of the processor state that the operating system saves
+ * when switching tasks, i.e. the extended control register XCR0.
+ * @return The enabled state components.
+ */
+static uint64 ottd_xgetbv()
+{
+#if _MSC_FULL_VER >= 160040219 // VS 2010 SP1
+	return _xgetbv(0);
+#else
+	return 0;
+#endif
 }
 #elif defined(__x86_64__) || defined(__i386)
 void ottd_cpuid(int info[4], int type)
@@ -113,21 +131,39 @@ void ottd_cpuid(int info[4], int type)
 			/* It is safe to write "=r" for (info[1]) as in case that PIC is enabled for i386,
 			 * the compiler will not choose EBX as target register (but something else).
 			 */
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #else
 	__asm__ __volatile__ (
 			"cpuid           \n\t"
 			: "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3])
-			: "a" (type)
+			: "a" (type), "c" (0)
 	);
 #endif /* i386 PIC */
 }
+
+/**
+ * Get the features of the processor state that the operating system saves
+ * when switching tasks, i.e. the extended control register XCR0.
+ * @return The enabled state components.
+ */
+static uint64 ottd_xgetbv()
+{
+	uint32 high, low;
+	/* The opcode of xgetbv, as older assemblers do not know the instruction. */
+	__asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (low), "=d" (high) : "c" (0));
+	return ((uint64)high << 32) | low;
+}
 #else
 void ottd_cpuid(int info[4], int type)
 {
 	info[0] = info[1] = info[2] = info[3] = 0;
 }
+
+static uint64 ottd_xgetbv()
+{
+	return 0;
+}
 #endif
 
 bool HasCPUIDFlag(uint type, uint index, uint bit)
@@ -140,3 +176,16 @@ bool HasCPUIDFlag(uint type, uint index, uint bit)
 	ottd_cpuid(cpu_info, type);
 	return HasBit(cpu_info[index], bit);
 }
+
+/**
+ * Check whether AVX2 instructions can be used, i.e. whether the CPU has them
+ * and the operating system saves the 256 bits registers they use.
+ * @return True iff AVX2 is supported.
+ */
+bool HasCPUAVX2Support()
+{
+	/* The operating system has to enable XSAVE (OSXSAVE) for the AVX (YMM) state. */
+	if (!HasCPUIDFlag(1, 2, 27) || !HasCPUIDFlag(1, 2, 28)) return false;
+	if ((ottd_xgetbv() & 0x6) != 0x6) return false;
+	return HasCPUIDFlag(7, 1, 5);
+}
@@ -50,6 +50,8 @@
 #include "goal_base.h"
 #include "story_base.h"
 #include "linkgraph/refresh.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "signal_func.h"
 
 #include "table/strings.h"
 #include "table/pricebase.h"
@@ -142,6 +144,130 @@ Money CalculateCompanyValue(const Company *c, bool including_loan)
 	return max(value, (Money)1);
 }
 
+/**
+ * Is a vehicle counted for the performance rating?
+ * @param v The vehicle.
+ * @return True if the vehicle is a primary vehicle of a company.
+ */
+static inline bool IsRatedVehicle(const Vehicle *v)
+{
+	return IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle();
+}
+
+/**
+ * Is a station counted for the performance rating?
+ * @param st The station.
+ * @return True if the station is owned by a company and was serviced recently.
+ */
+static inline bool IsRatedStation(const Station *st)
+{
+	return Company::IsValidID(st->owner) && (st->time_since_load <= 20 || st->time_since_unload <= 20);
+}
+
+/**
+ * Add a vehicle to the minimum profit of the performance rating of its owner.
+ * @param v The vehicle; it must be at least #VEHICLE_PROFIT_MIN_AGE days old.
+ */
+static void AddMinProfitVehicle(const Vehicle *v)
+{
+	CompanyRatingCache &rc = Company::Get(v->owner)->rating_cache;
+	if (rc.min_profit_valid && (rc.profit_vehicles == 0 || v->profit_last_year < rc.min_profit)) rc.min_profit = v->profit_last_year;
+	rc.profit_vehicles++;
+}
+
+/**
+ * Add or remove a vehicle from the performance rating caches of its owner.
+ * @param v The vehicle.
+ * @param delta +1 to add, -1 to remove.
+ */
+void CountVehicleForRating(const Vehicle *v, int delta)
+{
+	assert(delta == 1 || delta == -1);
+	if (!IsRatedVehicle(v)) return;
+
+	CompanyRatingCache &rc = Company::Get(v->owner)->rating_cache;
+	if (v->profit_last_year > 0) rc.profitable_vehicles += delta;
+	if (v->age <= VEHICLE_PROFIT_MIN_AGE) return;
+
+	if (delta > 0) {
+		AddMinProfitVehicle(v);
+	} else {
+		rc.profit_vehicles--;
+		/* The lowest profit might have gone; find it again when it is needed. */
+		if (v->profit_last_year <= rc.min_profit) rc.min_profit_valid = false;
+	}
+}
+
+/**
+ * Update the performance rating caches when a vehicle becomes old enough for the minimum profit.
+ * @param v The vehicle.
+ */
+void VehicleReachedRatingAge(const Vehicle *v)
+{
+	if (IsRatedVehicle(v)) AddMinProfitVehicle(v);
+}
+
+/**
+ * Add or remove a station from the performance rating caches of its owner.
+ * Call this with -1 before and with +1 after changing the owner, the
+ * facilities or the service times of the station.
+ * @param bst The station; waypoints are ignored.
+ * @param delta +1 to add, -1 to remove.
+ */
+void CountStationForRating(const BaseStation *bst, int delta)
+{
+	assert(delta == 1 || delta == -1);
+	if (!Station::IsExpected(bst)) return;
+
+	const Station *st = Station::From(bst);
+	if (!IsRatedStation(st)) return;
+
+	Company::Get(st->owner)->rating_cache.serviced_facilities += delta * CountBits((byte)st->facilities);
+}
+
+/**
+ * Recompute the minimum profit of all companies of which it is not valid.
+ * This goes over all vehicles once, no matter how many companies need it.
+ */
+static void UpdateCompanyRatingMinProfits()
+{
+	Company *c;
+	FOR_ALL_COMPANIES(c) {
+		if (c->rating_cache.min_profit_valid) continue;
+		c->rating_cache.min_profit = 0;
+		c->rating_cache.profit_vehicles = 0;
+	}
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (!IsRatedVehicle(v) || v->age <= VEHICLE_PROFIT_MIN_AGE) continue;
+		CompanyRatingCache &rc = Company::Get(v->owner)->rating_cache;
+		if (rc.min_profit_valid) continue;
+		if (rc.profit_vehicles == 0 || v->profit_last_year < rc.min_profit) rc.min_profit = v->profit_last_year;
+		rc.profit_vehicles++;
+	}
+
+	FOR_ALL_COMPANIES(c) c->rating_cache.min_profit_valid = true;
+}
+
+/**
+ * Recompute the performance rating caches of all companies from scratch.
+ */
+void RebuildCompanyRatingCaches()
+{
+	Company *c;
+	FOR_ALL_COMPANIES(c) {
+		c->rating_cache = CompanyRatingCache();
+		c->rating_cache.min_profit_valid = true;
+	}
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) CountVehicleForRating(v, 1);
+
+	const Station *st;
+	FOR_ALL_STATIONS(st) CountStationForRating(st, 1);
+}
+
 /**
  * if update is set to true, the economy is updated with this score
  *  (also the house is updated, should only be true in the on-tick event)
@@ -159,44 +285,19 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 
 	/* Count vehicles */
 	{
-		Vehicle *v;
-		Money min_profit = 0;
-		bool min_profit_first = true;
-		uint num = 0;
+		const CompanyRatingCache &rc = c->rating_cache;
+		if (!rc.min_profit_valid) UpdateCompanyRatingMinProfits();
 
-		FOR_ALL_VEHICLES(v) {
-			if (v->owner != owner) continue;
-			if (IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle()) {
-				if (v->profit_last_year > 0) num++; // For the vehicle score only count profitable vehicles
-				if (v->age > 730) {
-					/* Find the vehicle with the lowest amount of profit */
-					if (min_profit_first || min_profit > v->profit_last_year) {
-						min_profit = v->profit_last_year;
-						min_profit_first = false;
-					}
-				}
-			}
-		}
-
-		min_profit >>= 8; // remove the fract part
-
-		_score_part[owner][SCORE_VEHICLES] = num;
-		/* Don't allow negative min_profit to show */
-		if (min_profit > 0) {
-			_score_part[owner][SCORE_MIN_PROFIT] = ClampToI32(min_profit);
+		_score_part[owner][SCORE_VEHICLES] = rc.profitable_vehicles;
+		/* Don't allow negative min_profit to show; remove the fract part */
+		if (rc.profit_vehicles > 0 && (rc.min_profit >> 8) > 0) {
+			_score_part[owner][SCORE_MIN_PROFIT] = ClampToI32(rc.min_profit >> 8);
 		}
 	}
 
-	/* Count stations */
+	/* Count stations that are actually serviced */
 	{
-		uint num = 0;
-		const Station *st;
-
-		FOR_ALL_STATIONS(st) {
-			/* Only count stations that are actually serviced */
-			if (st->owner == owner && (st->time_since_load <= 20 || st->time_since_unload <= 20)) num += CountBits((byte)st->facilities);
-		}
-		_score_part[owner][SCORE_STATIONS] = num;
+		_score_part[owner][SCORE_STATIONS] = c->rating_cache.serviced_facilities;
 	}
 
 	/* Generate statistics depending on recent income statistics */
@@ -492,6 +593,12 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
 
+		/* Trains only follow the track of their owner, and signals only propagate over it.
+		 * Road vehicles only use the depots of their owner. */
+		YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+		YapfNotifyRoadLayoutChange(INVALID_TILE);
+		InvalidateSignalBlocks(INVALID_TILE);
+
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
 			 * and signals were not propagated
@@ -525,7 +632,9 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 		if (st->owner == old_owner) {
 			/* if a company goes bankrupt, set owner to OWNER_NONE so the sign doesn't disappear immediately
 			 * also, drawing station window would cause reading invalid company's colour */
+			CountStationForRating(st, -1);
 			st->owner = new_owner == INVALID_OWNER ? OWNER_NONE : new_owner;
+			CountStationForRating(st, 1);
 		}
 	}
 
@@ -1697,7 +1806,9 @@ static void LoadUnloadVehicle(Vehicle *front)
 				new_load_unload_ticks += amount_unloaded;
 
 				/* Deliver goods to the station */
+				CountStationForRating(st, -1);
 				st->time_since_unload = 0;
+				CountStationForRating(st, 1);
 			}
 
 			if (_settings_game.order.gradual_loading && remaining) {
@@ -1779,7 +1890,9 @@ static void LoadUnloadVehicle(Vehicle *front)
 				completely_emptied = false;
 				anything_loaded = true;
 
+				CountStationForRating(st, -1);
 				st->time_since_load = 0;
+				CountStationForRating(st, 1);
 				st->last_vehicle_type = v->type;
 
 				if (ge->cargo.TotalCount() == 0) {
@@ -28,6 +28,10 @@ extern Economy _economy;
 extern Prices _price;
 
 int UpdateCompanyRatingAndValue(Company *c, bool update);
+void CountVehicleForRating(const Vehicle *v, int delta);
+void VehicleReachedRatingAge(const Vehicle *v);
+void CountStationForRating(const BaseStation *st, int delta);
+void RebuildCompanyRatingCaches();
 void StartupIndustryDailyChanges(bool init_counter);
 
 Money GetTransportedGoodsIncome(uint num_pieces, uint dist, byte transit_days, CargoID cargo_type);
@@ -15,6 +15,7 @@
 #include "fios.h"
 #include "string_func.h"
 #include "tar_type.h"
+#include "thread/thread.h"
 #ifdef WIN32
 #include <windows.h>
 # define access _taccess
@@ -28,6 +29,12 @@
 #include <sys/stat.h>
 #include <algorithm>
 
+#if defined(UNIX) && !defined(__MORPHOS__) && !defined(__AMIGA__) && !defined(__OS2__)
+#include <sys/mman.h>
+/** Slotted files are memory mapped instead of read via the #Fio buffer. */
+#define WITH_FIO_MMAP
+#endif
+
 #ifdef WITH_XDG_BASEDIR
 #include "basedir.h"
 #endif
@@ -39,11 +46,15 @@
 
 /** Structure for keeping several open files with just one data buffer. */
 struct Fio {
-	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
+	const byte *buffer, *buffer_end;       ///< position pointer in local buffer (or mapping) and last valid byte of buffer (or mapping)
 	size_t pos;                            ///< current (system) position in file
 	FILE *cur_fh;                          ///< current file handle
 	const char *filename;                  ///< current filename
+	const byte *cur_map;                   ///< memory mapping of the current file, or \c NULL when it is read via the buffer
+	size_t cur_map_size;                   ///< size of the memory mapping of the current file
 	FILE *handles[MAX_FILE_SLOTS];         ///< array of file handles we can have open
+	const byte *maps[MAX_FILE_SLOTS];      ///< memory mappings of the whole files, or \c NULL when a file is not mapped
+	size_t map_sizes[MAX_FILE_SLOTS];      ///< sizes of the memory mappings
 	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
@@ -54,6 +65,7 @@ struct Fio {
 };
 
 static Fio _fio; ///< #Fio instance.
+static ThreadMutex *_fio_mutex = NULL; ///< Mutex for using #_fio from several threads, see #FioEnableLocking.
 
 /** Whether the working directory should be scanned. */
 static bool _do_scan_working_directory = true;
@@ -88,6 +100,13 @@ const char *FioGetFilename(uint8 slot)
 void FioSeekTo(size_t pos, int mode)
 {
 	if (mode == SEEK_CUR) pos += FioGetPos();
+	if (_fio.cur_map != NULL) {
+		/* The buffer is the whole file; the system position is its end. */
+		_fio.buffer = _fio.cur_map + min(pos, _fio.cur_map_size);
+		_fio.buffer_end = _fio.cur_map + _fio.cur_map_size;
+		_fio.pos = _fio.cur_map_size;
+		return;
+	}
 	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
 	_fio.pos = pos;
 	if (fseek(_fio.cur_fh, _fio.pos, SEEK_SET) < 0) {
@@ -123,6 +142,8 @@ void FioSeekToFile(uint8 slot, size_t pos)
 	assert(f != NULL);
 	_fio.cur_fh = f;
 	_fio.filename = _fio.filenames[slot];
+	_fio.cur_map = _fio.maps[slot];
+	_fio.cur_map_size = _fio.map_sizes[slot];
 	FioSeekTo(pos, SEEK_SET);
 }
 
@@ -133,8 +154,11 @@ void FioSeekToFile(uint8 slot, size_t pos)
 byte FioReadByte()
 {
 	if (_fio.buffer == _fio.buffer_end) {
+		/* A mapped file has no more data after the mapping. */
+		if (_fio.cur_map != NULL) return 0;
+
 		_fio.buffer = _fio.buffer_start;
-		size_t size = fread(_fio.buffer, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
+		size_t size = fread(_fio.buffer_start, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
 		_fio.pos += size;
 		_fio.buffer_end = _fio.buffer_start + size;
 
@@ -153,7 +177,7 @@ void FioSkipBytes(int n)
 		int m = min(_fio.buffer_end - _fio.buffer, n);
 		_fio.buffer += m;
 		n -= m;
-		if (n == 0) break;
+		if (n == 0 || _fio.cur_map != NULL) break;
 		FioReadByte();
 		n--;
 	}
@@ -186,10 +210,30 @@ uint32 FioReadDword()
  */
 void FioReadBlock(void *ptr, size_t size)
 {
+	if (_fio.cur_map != NULL) {
+		size = min<size_t>(size, _fio.buffer_end - _fio.buffer);
+		memcpy(ptr, _fio.buffer, size);
+		_fio.buffer += size;
+		return;
+	}
+
 	FioSeekTo(FioGetPos(), SEEK_SET);
 	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
 }
 
+/**
+ * Get the data at the current position in the file without copying it.
+ * Skip the data that is used with #FioSkipBytes afterwards.
+ * @param[out] size Number of bytes that can be accessed, i.e. up to the end of the file.
+ * @return The data, or \c NULL when the current file is not memory mapped.
+ */
+const byte *FioGetMappedData(size_t *size)
+{
+	if (_fio.cur_map == NULL) return NULL;
+	*size = _fio.buffer_end - _fio.buffer;
+	return _fio.buffer;
+}
+
 /**
  * Close the file at the given slot number.
  * @param slot File index to close.
@@ -199,6 +243,12 @@ static inline void FioCloseFile(int slot)
 	if (_fio.handles[slot] != NULL) {
 		fclose(_fio.handles[slot]);
 
+#if defined(WITH_FIO_MMAP)
+		if (_fio.maps[slot] != NULL) munmap(const_cast<byte *>(_fio.maps[slot]), _fio.map_sizes[slot]);
+#endif /* WITH_FIO_MMAP */
+		_fio.maps[slot] = NULL;
+		_fio.map_sizes[slot] = 0;
+
 		free(_fio.shortnames[slot]);
 		_fio.shortnames[slot] = NULL;
 
@@ -217,6 +267,31 @@ void FioCloseAll()
 	}
 }
 
+/**
+ * Start guarding the file state with a mutex, because other threads than the
+ * main thread read files too from now on. Must be called by the main thread
+ * before it starts such a thread, and not between #FioLock and #FioUnlock.
+ */
+void FioEnableLocking()
+{
+	if (_fio_mutex == NULL) _fio_mutex = ThreadMutex::New();
+}
+
+/**
+ * Get exclusive access to the file state, i.e. the current file and the
+ * position in it, until #FioUnlock is called. This may be nested.
+ */
+void FioLock()
+{
+	if (_fio_mutex != NULL) _fio_mutex->BeginCritical(true);
+}
+
+/** Release the access to the file state gotten by #FioLock. */
+void FioUnlock()
+{
+	if (_fio_mutex != NULL) _fio_mutex->EndCritical(true);
+}
+
 #if defined(LIMITED_FDS)
 static void FioFreeHandle()
 {
@@ -241,6 +316,35 @@ static void FioFreeHandle()
 }
 #endif /* LIMITED_FDS */
 
+/**
+ * Map a slotted file read-only into memory, so it is read without seeking
+ * and copying it into the buffer. The file stays readable via its handle
+ * when mapping is not possible.
+ * Reading from the mapping of a file that got truncated after it was mapped
+ * raises SIGBUS, while reading via the handle just comes up short. Files that
+ * can be written to, e.g. by the content download replacing a tar, are
+ * therefore not mapped; only read-only ones, like installed base sets, are.
+ * @param slot Index of the file.
+ */
+static void FioMapFile(int slot)
+{
+#if defined(WITH_FIO_MMAP)
+	int fd = fileno(_fio.handles[slot]);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) return;
+	if ((st.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) != 0) return;
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		DEBUG(misc, 1, "Mapping '%s' into memory failed, reading it instead", _fio.filenames[slot]);
+		return;
+	}
+
+	_fio.maps[slot] = (const byte *)map;
+	_fio.map_sizes[slot] = st.st_size;
+#endif /* WITH_FIO_MMAP */
+}
+
 /**
  * Open a slotted file.
  * @param slot Index to assign.
@@ -262,6 +366,7 @@ void FioOpenFile(int slot, const char *filename, Subdirectory subdir)
 	FioCloseFile(slot); // if file was opened before, close it
 	_fio.handles[slot] = f;
 	_fio.filenames[slot] = filename;
+	FioMapFile(slot);
 
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
@@ -25,7 +25,11 @@ uint32 FioReadDword();
 void FioCloseAll();
 void FioOpenFile(int slot, const char *filename, Subdirectory subdir);
 void FioReadBlock(void *ptr, size_t size);
+const byte *FioGetMappedData(size_t *size);
 void FioSkipBytes(int n);
+void FioEnableLocking();
+void FioLock();
+void FioUnlock();
 
 /**
  * The search paths OpenTTD could search through.
@@ -19,6 +19,7 @@
 #include "zoom_type.h"
 #include "gfx_layout.h"
 #include "zoom_func.h"
+#include "fileio_func.h"
 
 #include "table/sprites.h"
 #include "table/control_codes.h"
@@ -515,7 +516,10 @@ const Sprite *FreeTypeFontCache::GetGlyph(GlyphID key)
 				builtin_questionmark_data
 			};
 
+			/* The blitter may encode sprites that are read in the background too, with the files locked. */
+			FioLock();
 			Sprite *spr = BlitterFactory::GetCurrentBlitter()->Encode(&builtin_questionmark, AllocateFont);
+			FioUnlock();
 			assert(spr != NULL);
 			new_glyph.sprite = spr;
 			new_glyph.width  = spr->width + (this->fs != FS_NORMAL);
@@ -572,7 +576,10 @@ const Sprite *FreeTypeFontCache::GetGlyph(GlyphID key)
 		}
 	}
 
+	/* The blitter may encode sprites that are read in the background too, with the files locked. */
+	FioLock();
 	new_glyph.sprite = BlitterFactory::GetCurrentBlitter()->Encode(&sprite, AllocateFont);
+	FioUnlock();
 	new_glyph.width  = slot->advance.x >> 6;
 
 	this->SetGlyphPtr(key, &new_glyph);
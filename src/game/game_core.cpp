@@ -15,6 +15,7 @@
 #include "../company_func.h"
 #include "../network/network.h"
 #include "../window_func.h"
+#include "../tick_profiler.h"
 #include "game.hpp"
 #include "game_scanner.hpp"
 #include "game_config.hpp"
@@ -38,7 +39,10 @@
 
 	Backup<CompanyByte> cur_company(_current_company, FILE_LINE);
 	cur_company.Change(OWNER_DEITY);
+	uint64 start = GetProfilerTime();
+	uint32 ops = Game::instance->GetExecutedOps();
 	Game::instance->GameLoop();
+	TickProfilerAddScript(TICK_PROFILE_GAMESCRIPT, GetProfilerTime() - start, Game::instance->GetExecutedOps() - ops);
 	cur_company.Restore();
 
 	/* Occasionally collect garbage */
@@ -49,7 +49,7 @@ PauseModeByte _pause_mode;
 Palette _cur_palette;
 
 static byte _stringwidth_table[FS_END][224]; ///< Cache containing width of often used characters. @see GetCharacterWidth()
-DrawPixelInfo *_cur_dpi;
+THREAD_LOCAL DrawPixelInfo *_cur_dpi; ///< The area that is drawn to; every thread that draws has its own.
 byte _colour_gradient[COLOUR_END][8];
 
 static void GfxMainBlitterViewport(const Sprite *sprite, int x, int y, BlitterMode mode, const SubSprite *sub = NULL, SpriteID sprite_id = SPR_CURSOR_MOUSE);
@@ -67,8 +67,8 @@ ZoomLevelByte _gui_zoom; ///< GUI Zoom level
  * @ingroup dirty
  */
 static Rect _invalid_rect;
-static const byte *_colour_remap_ptr;
-static byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
+static THREAD_LOCAL const byte *_colour_remap_ptr;
+static THREAD_LOCAL byte _string_colourremap[3]; ///< Recoloursprite for stringdrawing. The grf loader ensures that #ST_FONT sprites only use colours 0 to 2.
 
 static const uint DIRTY_BLOCK_HEIGHT   = 8;
 static const uint DIRTY_BLOCK_WIDTH    = 64;
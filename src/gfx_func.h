@@ -185,7 +185,7 @@ int GetCharacterHeight(FontSize size);
 /** Height of characters in the large (#FS_MONO) font. @note Some characters may be oversized. */
 #define FONT_HEIGHT_MONO  (GetCharacterHeight(FS_MONO))
 
-extern DrawPixelInfo *_cur_dpi;
+extern THREAD_LOCAL DrawPixelInfo *_cur_dpi;
 
 TextColour GetContrastColour(uint8 background);
 
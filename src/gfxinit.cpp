@@ -276,6 +276,10 @@ static bool SwitchNewGRFBlitter()
 		uint animation; ///< 0: no support, 1: do support, 2: both
 		uint min_base_depth, max_base_depth, min_grf_depth, max_grf_depth;
 	} replacement_blitters[] = {
+#ifdef WITH_AVX2
+		{ "32bpp-avx2",      0, 32, 32,  8, 32 },
+		{ "32bpp-avx2-anim", 1, 32, 32,  8, 32 },
+#endif
 #ifdef WITH_SSE
 		{ "32bpp-sse4",      0, 32, 32,  8, 32 },
 		{ "32bpp-ssse3",     0, 32, 32,  8, 32 },
@@ -290,6 +294,8 @@ static bool SwitchNewGRFBlitter()
 	const bool animation_wanted = HasBit(_display_opt, DO_FULL_ANIMATION);
 	const char *cur_blitter = BlitterFactory::GetCurrentBlitter()->GetName();
 
+	/* Sprites may be read in the background, with the current blitter. */
+	FioLock();
 	VideoDriver::GetInstance()->AcquireBlitterLock();
 
 	for (uint i = 0; i < lengthof(replacement_blitters); i++) {
@@ -302,6 +308,7 @@ static bool SwitchNewGRFBlitter()
 
 		if (strcmp(repl_blitter, cur_blitter) == 0) {
 			VideoDriver::GetInstance()->ReleaseBlitterLock();
+			FioUnlock();
 			return false;
 		}
 		if (BlitterFactory::GetBlitterFactory(repl_blitter) == NULL) continue;
@@ -319,6 +326,7 @@ static bool SwitchNewGRFBlitter()
 	}
 
 	VideoDriver::GetInstance()->ReleaseBlitterLock();
+	FioUnlock();
 
 	return true;
 }
@@ -338,11 +346,14 @@ void GfxLoadSprites()
 {
 	DEBUG(sprite, 2, "Loading sprite set %d", _settings_game.game_creation.landscape);
 
+	/* Sprites may be read in the background from the files that are reopened. */
+	FioLock();
 	SwitchNewGRFBlitter();
 	ClearFontCache();
 	GfxInitSpriteMem();
 	LoadSpriteTables();
 	GfxInitPalettes();
+	FioUnlock();
 
 	UpdateCursorSize();
 }
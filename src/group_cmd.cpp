@@ -19,6 +19,7 @@
 #include "autoreplace_func.h"
 #include "string_func.h"
 #include "company_func.h"
+#include "economy_func.h"
 #include "core/pool_func.hpp"
 #include "order_backup.h"
 
@@ -145,6 +146,8 @@ void GroupStatistics::Clear()
 	stats_all.num_vehicle += delta;
 	stats.num_vehicle += delta;
 
+	CountVehicleForRating(v, delta);
+
 	if (v->age > VEHICLE_PROFIT_MIN_AGE) {
 		stats_all.num_profit_vehicle += delta;
 		stats_all.profit_last_year += v->GetDisplayProfitLastYear() * delta;
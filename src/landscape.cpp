@@ -31,6 +31,7 @@
 #include "object_base.h"
 #include "company_func.h"
 #include "pathfinder/npf/aystar.h"
+#include "pathfinder/water_regions.h"
 #include "saveload/saveload.h"
 #include <list>
 #include <set>
@@ -494,6 +495,7 @@ void DoClearSquare(TileIndex tile)
 
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
 	MarkTileDirtyByTile(tile);
+	InvalidateWaterRegion(tile);
 }
 
 /**
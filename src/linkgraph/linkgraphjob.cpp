@@ -39,7 +39,7 @@ LinkGraphJob::LinkGraphJob(const LinkGraph &orig) :
 		 * This is on purpose. */
 		link_graph(orig),
 		settings(_settings_game.linkgraph),
-		thread(NULL),
+		job_set(NULL),
 		join_date(_date + _settings_game.linkgraph.recalc_time)
 {
 }
@@ -56,13 +56,13 @@ void LinkGraphJob::EraseFlows(NodeID from)
 }
 
 /**
- * Spawn a thread if possible and run the link graph job in the thread. If
- * that's not possible run the job right now in the current thread.
+ * Queue the link graph job on the worker pool. If the pool has no worker
+ * threads run the job right now in the current thread.
  */
 void LinkGraphJob::SpawnThread()
 {
-	if (!ThreadObject::New(&(LinkGraphSchedule::Run), this, &this->thread, "ottd:linkgraph")) {
-		this->thread = NULL;
+	WorkerPool *pool = WorkerPool::Get();
+	if (pool->GetWorkerCount() == 0) {
 		/* Of course this will hang a bit.
 		 * On the other hand, if you want to play games which make this hang noticably
 		 * on a platform without threads then you'll probably get other problems first.
@@ -71,18 +71,23 @@ void LinkGraphJob::SpawnThread()
 		 * smaller grained "Step" method for all handlers and add some more ticks where
 		 * "Step" is called. No problem in principle. */
 		LinkGraphSchedule::Run(this);
+		return;
 	}
+
+	this->job_set = new WorkerJobSet();
+	pool->Enqueue(&(LinkGraphSchedule::Run), this, this->job_set);
 }
 
 /**
- * Join the calling thread with this job's thread if threading is enabled.
+ * Wait for the job to finish if it was queued on the worker pool. If it
+ * didn't start yet it is run in the calling thread.
  */
 void LinkGraphJob::JoinThread()
 {
-	if (this->thread != NULL) {
-		this->thread->Join();
-		delete this->thread;
-		this->thread = NULL;
+	if (this->job_set != NULL) {
+		WorkerPool::Get()->Wait(this->job_set);
+		delete this->job_set;
+		this->job_set = NULL;
 	}
 }
 
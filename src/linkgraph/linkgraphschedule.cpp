@@ -59,7 +59,7 @@ void LinkGraphSchedule::JoinNext()
 	if (!next->IsFinished()) return;
 	this->running.pop_front();
 	LinkGraphID id = next->LinkGraphIndex();
-	delete next; // implicitly joins the thread
+	delete next; // implicitly waits for the job
 	if (LinkGraph::IsValidID(id)) {
 		LinkGraph *lg = LinkGraph::Get(id);
 		this->Unqueue(lg); // Unqueue to avoid double-queueing recycled IDs.
@@ -69,7 +69,7 @@ void LinkGraphSchedule::JoinNext()
 
 /**
  * Run all handlers for the given Job. This method is tailored to
- * ThreadObject::New.
+ * WorkerPool::Enqueue.
  * @param j Pointer to a link graph job.
  */
 /* static */ void LinkGraphSchedule::Run(void *j)
@@ -81,8 +81,8 @@ void LinkGraphSchedule::JoinNext()
 }
 
 /**
- * Start all threads in the running list. This is only useful for save/load.
- * Usually threads are started when the job is created.
+ * Queue all jobs in the running list on the worker pool. This is only useful
+ * for save/load. Usually jobs are queued when they are created.
  */
 void LinkGraphSchedule::SpawnAll()
 {
@@ -2,8 +2,8 @@
 
 #include "../stdafx.h"
 #include "../core/math_func.hpp"
+#include "../thread/worker_pool.h"
 #include "mcf.h"
-#include <set>
 
 #include "../safeguards.h"
 
@@ -246,6 +246,36 @@ bool CapacityAnnotation::IsBetter(const CapacityAnnotation *base, uint cap,
 	}
 }
 
+/**
+ * Comparator for the node heap of Dijkstra that orders the nodes like the
+ * comparator of their annotations does.
+ * @tparam Tannotation Annotation to be used.
+ */
+template<class Tannotation>
+class AnnotationComparator {
+private:
+	const PathVector &paths; ///< The annotations of the nodes.
+
+public:
+	/**
+	 * Create a comparator.
+	 * @param paths The annotations of the nodes.
+	 */
+	AnnotationComparator(const PathVector &paths) : paths(paths) {}
+
+	/**
+	 * Compare two nodes.
+	 * @param x First node.
+	 * @param y Second node.
+	 * @return If x is to be visited before y.
+	 */
+	inline bool operator()(uint x, uint y) const
+	{
+		return typename Tannotation::Comparator()(static_cast<const Tannotation *>(this->paths[x]),
+				static_cast<const Tannotation *>(this->paths[y]));
+	}
+};
+
 /**
  * A slightly modified Dijkstra algorithm. Grades the paths not necessarily by
  * distance, but by the value Tannotation computes. It uses the max_saturation
@@ -254,26 +284,24 @@ bool CapacityAnnotation::IsBetter(const CapacityAnnotation *base, uint cap,
  * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
  * @param source_node Node where the algorithm starts.
  * @param paths Container for the paths to be calculated.
+ * @param heap Heap for the nodes still to be visited; only kept to save allocations.
  */
 template<class Tannotation, class Tedge_iterator>
-void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
+void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths, NodeHeap &heap)
 {
-	typedef std::set<Tannotation *, typename Tannotation::Comparator> AnnoSet;
 	Tedge_iterator iter(this->job);
 	uint size = this->job.Size();
-	AnnoSet annos;
 	paths.resize(size, NULL);
 	for (NodeID node = 0; node < size; ++node) {
 		Tannotation *anno = new Tannotation(node, node == source_node);
 		anno->UpdateAnnotation();
-		annos.insert(anno);
 		paths[node] = anno;
 	}
-	while (!annos.empty()) {
-		typename AnnoSet::iterator i = annos.begin();
-		Tannotation *source = *i;
-		annos.erase(i);
-		NodeID from = source->GetNode();
+	AnnotationComparator<Tannotation> comp(paths);
+	heap.Fill(size, comp);
+	while (!heap.IsEmpty()) {
+		NodeID from = heap.Pop(comp);
+		Tannotation *source = static_cast<Tannotation *>(paths[from]);
 		iter.SetNode(source_node, from);
 		for (NodeID to = iter.Next(); to != INVALID_NODE; to = iter.Next()) {
 			if (to == from) continue; // Not a real edge but a consumption sign.
@@ -288,15 +316,54 @@ void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 			uint distance = DistanceMaxPlusManhattan(this->job[from].XY(), this->job[to].XY()) + 1;
 			Tannotation *dest = static_cast<Tannotation *>(paths[to]);
 			if (dest->IsBetter(source, capacity, capacity - edge.Flow(), distance)) {
-				annos.erase(dest);
 				dest->Fork(source, capacity, capacity - edge.Flow(), distance);
 				dest->UpdateAnnotation();
-				annos.insert(dest);
+				/* Nodes that have already been visited are visited again. */
+				if (heap.Contains(to)) {
+					heap.Update(to, comp);
+				} else {
+					heap.Push(to, comp);
+				}
 			}
 		}
 	}
 }
 
+/**
+ * Run Dijkstra for a range of sources of a batch. This method is tailored to
+ * WorkerPool::RunRange.
+ * @tparam Tannotation Annotation to be used.
+ * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * @param param The DijkstraBatchParam of the batch.
+ * @param first Index in the batch of the first source to calculate.
+ * @param last Index in the batch after the last source to calculate.
+ */
+template<class Tannotation, class Tedge_iterator>
+/* static */ void MultiCommodityFlow::DijkstraRange(void *param, uint first, uint last)
+{
+	DijkstraBatchParam *batch = (DijkstraBatchParam *)param;
+	for (uint i = first; i < last; ++i) {
+		batch->mcf->Dijkstra<Tannotation, Tedge_iterator>(batch->first + i, batch->paths[i], batch->mcf->heaps[i]);
+	}
+}
+
+/**
+ * Calculate the paths for a batch of sources. The searches only read the
+ * link graph job, so they are spread over the worker pool. Flow may only be
+ * pushed after the whole batch has been calculated.
+ * @tparam Tannotation Annotation to be used.
+ * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * @param first First source of the batch.
+ * @param count Number of sources in the batch.
+ * @param paths Containers for the paths to be calculated, one per source.
+ */
+template<class Tannotation, class Tedge_iterator>
+void MultiCommodityFlow::DijkstraBatch(NodeID first, uint count, PathVector *paths)
+{
+	DijkstraBatchParam param = { this, first, paths };
+	WorkerPool::Get()->RunRange(&DijkstraRange<Tannotation, Tedge_iterator>, &param, count, 1);
+}
+
 /**
  * Clean up paths that lead nowhere and the root path.
  * @param source_id ID of the root node.
@@ -490,37 +557,42 @@ bool MCF1stPass::EliminateCycles()
  */
 MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
-	PathVector paths;
+	PathVector paths[DIJKSTRA_BATCH_SIZE];
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
+	uint batch_size = job.Settings().parallel_mcf ? DIJKSTRA_BATCH_SIZE : 1;
 	bool more_loops;
 
 	do {
 		more_loops = false;
-		for (NodeID source = 0; source < size; ++source) {
+		for (NodeID batch = 0; batch < size; batch += batch_size) {
 			/* First saturate the shortest paths. */
-			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths);
-
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = job[source][dest];
-				if (edge.UnsatisfiedDemand() > 0) {
-					Path *path = paths[dest];
-					assert(path != NULL);
-					/* Generally only allow paths that don't exceed the
-					 * available capacity. But if no demand has been assigned
-					 * yet, make an exception and allow any valid path *once*. */
-					if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
-							accuracy, this->max_saturation) > 0) {
-						/* If a path has been found there is a chance we can
-						 * find more. */
-						more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
-					} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
-							path->GetFreeCapacity() > INT_MIN) {
-						this->PushFlow(edge, path, accuracy, UINT_MAX);
+			uint count = min<uint>(batch_size, size - batch);
+			this->DijkstraBatch<DistanceAnnotation, GraphEdgeIterator>(batch, count, paths);
+
+			for (uint i = 0; i < count; ++i) {
+				NodeID source = batch + i;
+				for (NodeID dest = 0; dest < size; ++dest) {
+					Edge edge = job[source][dest];
+					if (edge.UnsatisfiedDemand() > 0) {
+						Path *path = paths[i][dest];
+						assert(path != NULL);
+						/* Generally only allow paths that don't exceed the
+						 * available capacity. But if no demand has been assigned
+						 * yet, make an exception and allow any valid path *once*. */
+						if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
+								accuracy, this->max_saturation) > 0) {
+							/* If a path has been found there is a chance we can
+							 * find more. */
+							more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
+						} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
+								path->GetFreeCapacity() > INT_MIN) {
+							this->PushFlow(edge, path, accuracy, UINT_MAX);
+						}
 					}
 				}
+				this->CleanupPaths(source, paths[i]);
 			}
-			this->CleanupPaths(source, paths);
 		}
 	} while (more_loops || this->EliminateCycles());
 }
@@ -533,23 +605,29 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 MCF2ndPass::MCF2ndPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
 	this->max_saturation = UINT_MAX; // disable artificial cap on saturation
-	PathVector paths;
+	PathVector paths[DIJKSTRA_BATCH_SIZE];
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
+	uint batch_size = job.Settings().parallel_mcf ? DIJKSTRA_BATCH_SIZE : 1;
 	bool demand_left = true;
 	while (demand_left) {
 		demand_left = false;
-		for (NodeID source = 0; source < size; ++source) {
-			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths);
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = this->job[source][dest];
-				Path *path = paths[dest];
-				if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
-					this->PushFlow(edge, path, accuracy, UINT_MAX);
-					if (edge.UnsatisfiedDemand() > 0) demand_left = true;
+		for (NodeID batch = 0; batch < size; batch += batch_size) {
+			uint count = min<uint>(batch_size, size - batch);
+			this->DijkstraBatch<CapacityAnnotation, FlowEdgeIterator>(batch, count, paths);
+
+			for (uint i = 0; i < count; ++i) {
+				NodeID source = batch + i;
+				for (NodeID dest = 0; dest < size; ++dest) {
+					Edge edge = this->job[source][dest];
+					Path *path = paths[i][dest];
+					if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
+						this->PushFlow(edge, path, accuracy, UINT_MAX);
+						if (edge.UnsatisfiedDemand() > 0) demand_left = true;
+					}
 				}
+				this->CleanupPaths(source, paths[i]);
 			}
-			this->CleanupPaths(source, paths);
 		}
 	}
 }
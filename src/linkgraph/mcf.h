@@ -4,15 +4,36 @@
 #define MCF_H
 
 #include "linkgraphjob_base.h"
+#include "../misc/indexed_heap.hpp"
 #include <vector>
 
 typedef std::vector<Path *> PathVector;
 
+/** Heap of the nodes that Dijkstra still has to visit. */
+typedef CIndexedHeapT<4> NodeHeap;
+
 /**
  * Multi-commodity flow calculating base class.
  */
 class MultiCommodityFlow {
 protected:
+	/**
+	 * Number of sources whose paths are calculated together, possibly in
+	 * parallel, before flow is pushed along them, when the parallel_mcf
+	 * setting is on. The later sources of a batch do not see the flow of the
+	 * earlier ones, so the flows differ from those of calculating one source
+	 * at a time. This must not depend on the number of worker threads so
+	 * that all clients get the same result.
+	 */
+	static const uint DIJKSTRA_BATCH_SIZE = 16;
+
+	/** Parameters for calculating the paths of a batch of sources on the worker pool. */
+	struct DijkstraBatchParam {
+		MultiCommodityFlow *mcf; ///< The flow calculation.
+		NodeID first;            ///< First source of the batch.
+		PathVector *paths;       ///< Containers for the paths, one per source of the batch.
+	};
+
 	/**
 	 * Constructor.
 	 * @param job Link graph job being executed.
@@ -22,7 +43,13 @@ protected:
 	{}
 
 	template<class Tannotation, class Tedge_iterator>
-	void Dijkstra(NodeID from, PathVector &paths);
+	void Dijkstra(NodeID from, PathVector &paths, NodeHeap &heap);
+
+	template<class Tannotation, class Tedge_iterator>
+	static void DijkstraRange(void *param, uint first, uint last);
+
+	template<class Tannotation, class Tedge_iterator>
+	void DijkstraBatch(NodeID first, uint count, PathVector *paths);
 
 	uint PushFlow(Edge &edge, Path *path, uint accuracy, uint max_saturation);
 
@@ -30,6 +57,7 @@ protected:
 
 	LinkGraphJob &job;   ///< Job we're working with.
 	uint max_saturation; ///< Maximum saturation for edges.
+	NodeHeap heaps[DIJKSTRA_BATCH_SIZE]; ///< Heaps for Dijkstra, one per source of a batch so they can be used concurrently.
 };
 
 /**
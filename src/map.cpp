@@ -12,6 +12,7 @@
 #include "stdafx.h"
 #include "debug.h"
 #include "core/alloc_func.hpp"
+#include "core/mem_func.hpp"
 #include "water_map.h"
 #include "string_func.h"
 
@@ -29,8 +30,13 @@ uint _map_size_y;    ///< Size of the map along the Y
 uint _map_size;      ///< The number of tiles on the map
 uint _map_tile_mask; ///< _map_size - 1 (to mask the mapsize)
 
+#if defined(WITH_SOA_MAP)
+TileArrays _m;            ///< Tiles of the map
+TileExtendedArrays _me;   ///< Extended Tiles of the map
+#else
 Tile *_m = NULL;          ///< Tiles of the map
 TileExtended *_me = NULL; ///< Extended Tiles of the map
+#endif
 
 
 /**
@@ -58,11 +64,60 @@ void AllocateMap(uint size_x, uint size_y)
 	_map_size = size_x * size_y;
 	_map_tile_mask = _map_size - 1;
 
+#if defined(WITH_SOA_MAP)
+	free(_m.type);
+	free(_m.height);
+	free(_m.m2);
+	free(_m.m1);
+	free(_m.m3);
+	free(_m.m4);
+	free(_m.m5);
+	free(_me.m6);
+	free(_me.m7);
+
+	_m.type   = CallocT<byte>(_map_size);
+	_m.height = CallocT<byte>(_map_size);
+	_m.m2     = CallocT<uint16>(_map_size);
+	_m.m1     = CallocT<byte>(_map_size);
+	_m.m3     = CallocT<byte>(_map_size);
+	_m.m4     = CallocT<byte>(_map_size);
+	_m.m5     = CallocT<byte>(_map_size);
+	_me.m6    = CallocT<byte>(_map_size);
+	_me.m7    = CallocT<byte>(_map_size);
+#else
 	free(_m);
 	free(_me);
 
 	_m = CallocT<Tile>(_map_size);
 	_me = CallocT<TileExtended>(_map_size);
+#endif /* WITH_SOA_MAP */
+}
+
+/**
+ * Reset all data of a range of tiles to zero.
+ * @param first The first tile to clear.
+ * @param count The number of tiles to clear.
+ * @param extended Whether to clear the extended tile data too.
+ */
+void ClearMapTiles(TileIndex first, uint count, bool extended)
+{
+	assert(first + count <= MapSize());
+
+#if defined(WITH_SOA_MAP)
+	MemSetT(_m.type   + first, 0, count);
+	MemSetT(_m.height + first, 0, count);
+	MemSetT(_m.m2     + first, 0, count);
+	MemSetT(_m.m1     + first, 0, count);
+	MemSetT(_m.m3     + first, 0, count);
+	MemSetT(_m.m4     + first, 0, count);
+	MemSetT(_m.m5     + first, 0, count);
+	if (!extended) return;
+	MemSetT(_me.m6    + first, 0, count);
+	MemSetT(_me.m7    + first, 0, count);
+#else
+	MemSetT(_m + first, 0, count);
+	if (extended) MemSetT(_me + first, 0, count);
+#endif /* WITH_SOA_MAP */
 }
 
 
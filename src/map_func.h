@@ -27,6 +27,22 @@ extern uint _map_tile_mask;
 
 #define TILE_MASK(x) ((x) & _map_tile_mask)
 
+#if defined(WITH_SOA_MAP)
+/**
+ * The tile-arrays.
+ *
+ * This variable holds the arrays which contain the tiles of the map.
+ */
+extern TileArrays _m;
+
+/**
+ * The extended tile-arrays.
+ *
+ * This variable holds the arrays which contain the extended tiles of
+ * the map.
+ */
+extern TileExtendedArrays _me;
+#else
 /**
  * Pointer to the tile-array.
  *
@@ -42,8 +58,23 @@ extern Tile *_m;
  * of the map.
  */
 extern TileExtended *_me;
+#endif /* WITH_SOA_MAP */
 
 void AllocateMap(uint size_x, uint size_y);
+void ClearMapTiles(TileIndex first, uint count, bool extended);
+
+/**
+ * Check whether the map has been allocated.
+ * @return True iff the tile-arrays exist.
+ */
+static inline bool IsMapAllocated()
+{
+#if defined(WITH_SOA_MAP)
+	return _m.type != NULL;
+#else
+	return _m != NULL;
+#endif
+}
 
 /**
  * Logarithm of the map size along the X side.
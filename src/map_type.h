@@ -12,6 +12,79 @@
 #ifndef MAP_TYPE_H
 #define MAP_TYPE_H
 
+#if defined(WITH_SOA_MAP)
+
+/**
+ * Data that is stored per tile. Also used TileExtended for this.
+ * Look at docs/landscape.html for the exact meaning of the members.
+ * With the structure of arrays map layout each member lives in its own
+ * array, see #TileArrays; this only refers to the members of one tile.
+ */
+struct Tile {
+	byte   &type;       ///< The type (bits 4..7), bridges (2..3), rainforest/desert (0..1)
+	byte   &height;     ///< The height of the northern corner.
+	uint16 &m2;         ///< Primarily used for indices to towns, industries and stations
+	byte   &m1;         ///< Primarily used for ownership information
+	byte   &m3;         ///< General purpose
+	byte   &m4;         ///< General purpose
+	byte   &m5;         ///< General purpose
+};
+
+/**
+ * Data that is stored per tile. Also used Tile for this.
+ * With the structure of arrays map layout each member lives in its own
+ * array, see #TileExtendedArrays; this only refers to the members of one tile.
+ */
+struct TileExtended {
+	byte &m6; ///< General purpose
+	byte &m7; ///< Primarily used for newgrf support
+};
+
+/**
+ * The tiles of the map, stored with one contiguous array per member of
+ * #Tile. Loops over the whole map that look at only one or two members,
+ * e.g. the tile type or the owner, then do not need to load the others.
+ */
+struct TileArrays {
+	byte   *type;   ///< The type of all tiles.
+	byte   *height; ///< The height of all tiles.
+	uint16 *m2;     ///< The m2 of all tiles.
+	byte   *m1;     ///< The m1 (owner) of all tiles.
+	byte   *m3;     ///< The m3 of all tiles.
+	byte   *m4;     ///< The m4 of all tiles.
+	byte   *m5;     ///< The m5 of all tiles.
+
+	/**
+	 * Get the members of a tile.
+	 * @param t The index of the tile.
+	 * @return References to the members of the tile.
+	 */
+	inline Tile operator[](size_t t) const
+	{
+		Tile tile = { this->type[t], this->height[t], this->m2[t], this->m1[t], this->m3[t], this->m4[t], this->m5[t] };
+		return tile;
+	}
+};
+
+/** The extended tiles of the map, stored with one contiguous array per member of #TileExtended. */
+struct TileExtendedArrays {
+	byte *m6; ///< The m6 of all tiles.
+	byte *m7; ///< The m7 of all tiles.
+
+	/**
+	 * Get the members of a tile.
+	 * @param t The index of the tile.
+	 * @return References to the members of the tile.
+	 */
+	inline TileExtended operator[](size_t t) const
+	{
+		TileExtended tile = { this->m6[t], this->m7[t] };
+		return tile;
+	}
+};
+
+#else /* WITH_SOA_MAP */
+
 /**
  * Data that is stored per tile. Also used TileExtended for this.
  * Look at docs/landscape.html for the exact meaning of the members.
@@ -37,6 +110,8 @@ struct TileExtended {
 	byte m7; ///< Primarily used for newgrf support
 };
 
+#endif /* WITH_SOA_MAP */
+
 /**
  * An offset value between to tiles.
  *
@@ -28,6 +28,9 @@
 #include "core/pool_type.hpp"
 #include "game/game.hpp"
 #include "linkgraph/linkgraphschedule.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "signal_func.h"
+#include "pathfinder/water_regions.h"
 
 #include "safeguards.h"
 
@@ -74,6 +77,13 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	LinkGraphSchedule::Clear();
 	PoolBase::Clean(PT_NORMAL);
 
+	/* Segments of the old map must not be used on the new one, even if it has the same size. */
+	YapfFlushSegmentCaches();
+	YapfFlushRoadRouteCache();
+	YapfFlushRailStationDistances();
+	InvalidateSignalBlocks(INVALID_TILE);
+	InitializeWaterRegions();
+
 	ResetPersistentNewGRFData();
 
 	InitializeSound();
@@ -13,6 +13,14 @@
 #define HASHTABLE_HPP
 
 #include "../core/math_func.hpp"
+#include "../core/bitmath_func.hpp"
+#include "../core/alloc_func.hpp"
+#include "../core/mem_func.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define HASHTABLE_SSE2
+#endif
 
 template <class Titem_>
 struct CHashTableSlotT
@@ -258,4 +266,268 @@ public:
 	}
 };
 
+/**
+ * class COpenHashTableT<Titem, Tinitial_bits> - hash table of pointers
+ *  allocated elsewhere, with open addressing.
+ *
+ *  It has the same interface and requirements as CHashTableT, but doesn't
+ *  chain the items through Titem::GetHashNext(); the pointers are stored in
+ *  the table itself. Next to every pointer there is a control byte with
+ *  7 bits of the hash of the item, or a marker for an empty or a deleted
+ *  slot. The slots are probed in groups of 16, and the control bytes of a
+ *  group are compared at once (with SSE2 when available), so most lookups
+ *  touch one line of control bytes and the item that is looked for.
+ *
+ *  The table starts with 2^Tinitial_bits slots, allocated on the first
+ *  Push(). When 7/8 of the slots hold items or are deleted it is rebuilt,
+ *  twice as large if more than 7/16 hold items. It never shrinks; Clear()
+ *  keeps the slots for the next use. Choose the initial size from the usual
+ *  number of items, e.g. the nodes of a typical path finder run, so most
+ *  runs never grow the table.
+ */
+template <class Titem_, int Tinitial_bits_>
+class COpenHashTableT {
+public:
+	typedef Titem_ Titem;                         // make Titem_ visible from outside of class
+	typedef typename Titem_::Key Tkey;            // make Titem_::Key a property of HashTable
+	static const uint GROUP_SIZE = 16;            ///< number of slots whose control bytes are compared at once
+	static const uint INITIAL_CAPACITY = (1 << Tinitial_bits_) > (int)GROUP_SIZE ? (1 << Tinitial_bits_) : GROUP_SIZE; ///< number of slots of a new table
+
+protected:
+	static const uint8 CTRL_EMPTY   = 0x80;       ///< control byte of a slot that was never used since the last clear
+	static const uint8 CTRL_DELETED = 0xFE;       ///< control byte of a slot whose item was removed; probing continues past it
+
+	uint8   *m_ctrl;        ///< control byte per slot: the low 7 bits of the hash of its item, #CTRL_EMPTY or #CTRL_DELETED
+	Titem_ **m_items;       ///< item per slot
+	uint     m_capacity;    ///< number of slots, a power of 2; 0 before the first Push()
+	int      m_num_items;   ///< item counter
+	uint     m_num_deleted; ///< number of slots marked as deleted
+
+public:
+	/* default constructor */
+	inline COpenHashTableT() : m_ctrl(NULL), m_items(NULL), m_capacity(0), m_num_items(0), m_num_deleted(0)
+	{
+	}
+
+	~COpenHashTableT()
+	{
+		free(m_ctrl);
+		free(m_items);
+	}
+
+protected:
+	/** static helper - return the mixed hash of the given key */
+	inline static uint32 CalcHash(const Tkey &key)
+	{
+		/* Keys like (tile << 4 | trackdir) leave many bits unused; spread them over the whole word. */
+		uint32 hash = (uint32)key.CalcHash() * 0x9E3779B1U;
+		return hash ^ (hash >> 16);
+	}
+
+	/** static helper - bit mask of the slots in a group with the given control byte */
+	inline static uint MatchGroup(const uint8 *group, uint8 ctrl)
+	{
+#ifdef HASHTABLE_SSE2
+		__m128i bytes = _mm_loadu_si128((const __m128i *)group);
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)ctrl)));
+#else
+		uint mask = 0;
+		for (uint i = 0; i < GROUP_SIZE; i++) {
+			if (group[i] == ctrl) mask |= 1 << i;
+		}
+		return mask;
+#endif
+	}
+
+	/** static helper - bit mask of the slots in a group that are empty or deleted */
+	inline static uint MatchFree(const uint8 *group)
+	{
+#ifdef HASHTABLE_SSE2
+		return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+		uint mask = 0;
+		for (uint i = 0; i < GROUP_SIZE; i++) {
+			if (HasBit(group[i], 7)) mask |= 1 << i;
+		}
+		return mask;
+#endif
+	}
+
+	/** static helper - index of the first slot in a non-empty bit mask of slots */
+	inline static uint FirstSlot(uint mask)
+	{
+#if defined(__GNUC__)
+		return __builtin_ctz(mask);
+#else
+		return FindFirstBit(mask);
+#endif
+	}
+
+	/** find the slot of the item with the given key, or -1 */
+	int FindSlot(const Tkey &key) const
+	{
+		if (m_num_items == 0) return -1;
+
+		uint32 hash = CalcHash(key);
+		uint8 h2 = hash & 0x7F;
+		uint group_mask = m_capacity / GROUP_SIZE - 1;
+		uint group = (hash >> 7) & group_mask;
+		/* Triangular steps visit every group, and there is always an empty slot somewhere. */
+		for (uint step = 1;; step++) {
+			const uint8 *ctrl = m_ctrl + group * GROUP_SIZE;
+			for (uint match = MatchGroup(ctrl, h2); match != 0; match &= match - 1) {
+				uint slot = group * GROUP_SIZE + FirstSlot(match);
+				if (m_items[slot]->GetKey() == key) return slot;
+			}
+			if (MatchGroup(ctrl, CTRL_EMPTY) != 0) return -1;
+			group = (group + step) & group_mask;
+		}
+	}
+
+	/** put an item in the first free slot of its probe sequence; there must be one */
+	void Insert(uint32 hash, Titem_ *item)
+	{
+		uint group_mask = m_capacity / GROUP_SIZE - 1;
+		uint group = (hash >> 7) & group_mask;
+		for (uint step = 1;; step++) {
+			uint match = MatchFree(m_ctrl + group * GROUP_SIZE);
+			if (match != 0) {
+				uint slot = group * GROUP_SIZE + FirstSlot(match);
+				if (m_ctrl[slot] == CTRL_DELETED) m_num_deleted--;
+				m_ctrl[slot] = hash & 0x7F;
+				m_items[slot] = item;
+				return;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	/** remove the item in a slot */
+	void Erase(uint slot)
+	{
+		/* Lookups stop at a group with an empty slot, so there the slot can be empty again. */
+		if (MatchGroup(m_ctrl + (slot & ~(GROUP_SIZE - 1)), CTRL_EMPTY) != 0) {
+			m_ctrl[slot] = CTRL_EMPTY;
+		} else {
+			m_ctrl[slot] = CTRL_DELETED;
+			m_num_deleted++;
+		}
+		m_num_items--;
+	}
+
+	/** rebuild the table without deleted slots, twice as large when it is getting full */
+	void Rehash()
+	{
+		uint old_capacity = m_capacity;
+		uint8 *old_ctrl = m_ctrl;
+		Titem_ **old_items = m_items;
+
+		if (m_capacity == 0) {
+			m_capacity = INITIAL_CAPACITY;
+		} else if ((uint)m_num_items + 1 > m_capacity / 16 * 7) {
+			m_capacity *= 2;
+		}
+		m_ctrl = MallocT<uint8>(m_capacity);
+		m_items = MallocT<Titem_ *>(m_capacity);
+		MemSetT(m_ctrl, CTRL_EMPTY, m_capacity);
+		m_num_deleted = 0;
+
+		for (uint i = 0; i < old_capacity; i++) {
+			if (!HasBit(old_ctrl[i], 7)) Insert(CalcHash(old_items[i]->GetKey()), old_items[i]);
+		}
+		free(old_ctrl);
+		free(old_items);
+	}
+
+public:
+	/** item count */
+	inline int Count() const
+	{
+		return m_num_items;
+	}
+
+	/** simple clear - forget all items, but keep the slots */
+	inline void Clear()
+	{
+		if (m_ctrl != NULL) MemSetT(m_ctrl, CTRL_EMPTY, m_capacity);
+		m_num_items = 0;
+		m_num_deleted = 0;
+	}
+
+	/** forget all items and free the slots */
+	inline void Free()
+	{
+		free(m_ctrl);
+		free(m_items);
+		m_ctrl = NULL;
+		m_items = NULL;
+		m_capacity = 0;
+		m_num_items = 0;
+		m_num_deleted = 0;
+	}
+
+	/** const item search */
+	const Titem_ *Find(const Tkey &key) const
+	{
+		int slot = FindSlot(key);
+		return slot < 0 ? NULL : m_items[slot];
+	}
+
+	/** non-const item search */
+	Titem_ *Find(const Tkey &key)
+	{
+		int slot = FindSlot(key);
+		return slot < 0 ? NULL : m_items[slot];
+	}
+
+	/** non-const item search & optional removal (if found) */
+	Titem_ *TryPop(const Tkey &key)
+	{
+		int slot = FindSlot(key);
+		if (slot < 0) return NULL;
+		Titem_ *item = m_items[slot];
+		Erase(slot);
+		return item;
+	}
+
+	/** non-const item search & removal */
+	Titem_& Pop(const Tkey &key)
+	{
+		Titem_ *item = TryPop(key);
+		assert(item != NULL);
+		return *item;
+	}
+
+	/** non-const item search & optional removal (if found) */
+	bool TryPop(Titem_ &item)
+	{
+		int slot = FindSlot(item.GetKey());
+		if (slot < 0 || m_items[slot] != &item) return false;
+		Erase(slot);
+		return true;
+	}
+
+	/** non-const item search & removal */
+	void Pop(Titem_ &item)
+	{
+		bool ret = TryPop(item);
+		assert(ret);
+	}
+
+	/** add one item */
+	void Push(Titem_ &new_item)
+	{
+		assert(Find(new_item.GetKey()) == NULL);
+		/* Keep at least 1/8 of the slots empty, so lookups of missing keys end quickly. */
+		if (m_capacity == 0 || (uint)m_num_items + m_num_deleted + 1 > m_capacity - m_capacity / 8) Rehash();
+		Insert(CalcHash(new_item.GetKey()), &new_item);
+		m_num_items++;
+	}
+
+private:
+	/* The table owns its slots; it can't be copied. */
+	COpenHashTableT(const COpenHashTableT &);
+	COpenHashTableT &operator=(const COpenHashTableT &);
+};
+
 #endif /* HASHTABLE_HPP */
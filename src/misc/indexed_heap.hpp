@@ -0,0 +1,227 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file indexed_heap.hpp Indexed d-ary heap implementation. */
+
+#ifndef INDEXED_HEAP_HPP
+#define INDEXED_HEAP_HPP
+
+#include "../core/alloc_func.hpp"
+#include "../core/math_func.hpp"
+
+/**
+ * Indexed d-ary heap as C++ template.
+ *  A priority queue of the integers [0, size), e.g. node IDs, that keeps the
+ *  smallest item according to a comparator at the first position. As it
+ *  knows where each item is, the key of an item that is in the heap can be
+ *  changed in either direction without searching for it.
+ *
+ * @par Usage information:
+ * The items are compared by a functor with a 'bool operator()(uint a, uint b)'
+ * that returns whether item a has to come before item b. It must define a
+ * strict total order, i.e. only return false both ways if a == b; then the
+ * order in which items are popped does not depend on the heap layout.
+ * The comparator is passed to every method that moves items, as the keys
+ * are stored elsewhere; the keys of an item in the heap may only change when
+ * #Update is called for the item right after.
+ *
+ * @par
+ * The heap only stores the indices of the items in two arrays that are kept
+ * when the heap is emptied, so it can be reused without allocating.
+ *
+ * @tparam Tarity The number of children of a node in the heap.
+ */
+template <uint Tarity = 4>
+class CIndexedHeapT {
+private:
+	static const uint NOT_IN_HEAP = UINT_MAX; ///< Position of items that are not in the heap.
+
+	uint items;    ///< Number of items in the heap
+	uint size;     ///< Number of possible items, i.e. items are in [0, size)
+	uint capacity; ///< Number of items the arrays can hold
+	uint *heap;    ///< The items, in heap order
+	uint *pos;     ///< The position of each item in the heap, or NOT_IN_HEAP
+
+	/**
+	 * Place an item at a position in the heap.
+	 * @param item The item.
+	 * @param p The position.
+	 */
+	inline void Place(uint item, uint p)
+	{
+		this->heap[p] = item;
+		this->pos[item] = p;
+	}
+
+	/**
+	 * Move an item up until its parent comes before it.
+	 * @param p Position of the item.
+	 * @param comp The comparator.
+	 * @return Whether the item moved.
+	 */
+	template <class Tcomparator>
+	bool SiftUp(uint p, const Tcomparator &comp)
+	{
+		uint item = this->heap[p];
+		uint start = p;
+		while (p > 0) {
+			uint parent = (p - 1) / Tarity;
+			if (!comp(item, this->heap[parent])) break;
+			this->Place(this->heap[parent], p);
+			p = parent;
+		}
+		this->Place(item, p);
+		return p != start;
+	}
+
+	/**
+	 * Move an item down until it comes before all its children.
+	 * @param p Position of the item.
+	 * @param comp The comparator.
+	 */
+	template <class Tcomparator>
+	void SiftDown(uint p, const Tcomparator &comp)
+	{
+		uint item = this->heap[p];
+		for (;;) {
+			uint first = p * Tarity + 1;
+			if (first >= this->items) break;
+
+			uint last = min(first + Tarity, this->items);
+			uint best = first;
+			for (uint c = first + 1; c < last; c++) {
+				if (comp(this->heap[c], this->heap[best])) best = c;
+			}
+			if (!comp(this->heap[best], item)) break;
+
+			this->Place(this->heap[best], p);
+			p = best;
+		}
+		this->Place(item, p);
+	}
+
+public:
+	/** Create an empty heap. */
+	CIndexedHeapT() : items(0), size(0), capacity(0), heap(NULL), pos(NULL) {}
+
+	~CIndexedHeapT()
+	{
+		free(this->heap);
+		free(this->pos);
+	}
+
+	/**
+	 * Empty the heap and set the range of items it can hold.
+	 * @param size Items are in [0, size).
+	 */
+	void Reset(uint size)
+	{
+		if (size > this->capacity) {
+			this->capacity = max(size, this->capacity * 2);
+			this->heap = ReallocT(this->heap, this->capacity);
+			this->pos = ReallocT(this->pos, this->capacity);
+		}
+		this->size = size;
+		this->items = 0;
+		for (uint i = 0; i < size; i++) this->pos[i] = NOT_IN_HEAP;
+	}
+
+	/**
+	 * Empty the heap, set the range of items it can hold and put all of
+	 * them in the heap. This is faster than pushing them one by one.
+	 * @param size Items are in [0, size).
+	 * @param comp The comparator.
+	 */
+	template <class Tcomparator>
+	void Fill(uint size, const Tcomparator &comp)
+	{
+		this->Reset(size);
+		for (uint i = 0; i < size; i++) this->Place(i, i);
+		this->items = size;
+		if (size < 2) return;
+		for (uint p = (size - 2) / Tarity + 1; p-- > 0;) this->SiftDown(p, comp);
+	}
+
+	/**
+	 * Get the number of items in the heap.
+	 * @return Number of items.
+	 */
+	inline uint Length() const { return this->items; }
+
+	/**
+	 * Test if the heap is empty.
+	 * @return True if empty.
+	 */
+	inline bool IsEmpty() const { return this->items == 0; }
+
+	/**
+	 * Test if an item is in the heap.
+	 * @param item The item.
+	 * @return True if the item is in the heap.
+	 */
+	inline bool Contains(uint item) const
+	{
+		assert(item < this->size);
+		return this->pos[item] != NOT_IN_HEAP;
+	}
+
+	/**
+	 * Get the first item, i.e. the one that comes before all others.
+	 * @return The first item.
+	 */
+	inline uint Begin() const
+	{
+		assert(!this->IsEmpty());
+		return this->heap[0];
+	}
+
+	/**
+	 * Add an item that is not in the heap.
+	 * @param item The item.
+	 * @param comp The comparator.
+	 */
+	template <class Tcomparator>
+	void Push(uint item, const Tcomparator &comp)
+	{
+		assert(!this->Contains(item));
+		this->Place(item, this->items++);
+		this->SiftUp(this->items - 1, comp);
+	}
+
+	/**
+	 * Remove the first item from the heap.
+	 * @param comp The comparator.
+	 * @return The removed item.
+	 */
+	template <class Tcomparator>
+	uint Pop(const Tcomparator &comp)
+	{
+		uint first = this->Begin();
+		this->pos[first] = NOT_IN_HEAP;
+		if (--this->items > 0) {
+			this->Place(this->heap[this->items], 0);
+			this->SiftDown(0, comp);
+		}
+		return first;
+	}
+
+	/**
+	 * Restore the heap order after the key of an item in the heap changed.
+	 * @param item The item.
+	 * @param comp The comparator.
+	 */
+	template <class Tcomparator>
+	void Update(uint item, const Tcomparator &comp)
+	{
+		assert(this->Contains(item));
+		if (!this->SiftUp(this->pos[item], comp)) this->SiftDown(this->pos[item], comp);
+	}
+};
+
+#endif /* INDEXED_HEAP_HPP */
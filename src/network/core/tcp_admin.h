@@ -63,6 +63,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_PERFORMANCE,     ///< The server gives the admin the timings of the game loop.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -86,6 +87,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_PERFORMANCE,     ///< The admin would like to have the timings of the game loop.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -481,6 +483,25 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_RCON_END(Packet *p);
 
+	/**
+	 * Send the timings of the game loop, in microseconds:
+	 * uint16  Number of ticks the timings are averaged over.
+	 * uint8   Number of phases of the game loop that follow.
+	 * For each phase:
+	 *   uint32  Average time.
+	 *   uint32  Maximum time.
+	 * uint32  Average time of the whole game loop.
+	 * uint32  Maximum time of the whole game loop.
+	 * For each script that ran:
+	 *   bool    Data follows; false marks the end of the list.
+	 *   uint8   ID of the company of the AI, or OWNER_DEITY for the game script.
+	 *   uint32  Average time per tick.
+	 *   uint32  Average number of opcodes executed per tick.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_PERFORMANCE(Packet *p);
+
 	NetworkRecvStatus HandlePacket(Packet *p);
 public:
 	NetworkRecvStatus CloseConnection(bool error = true);
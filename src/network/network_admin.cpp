@@ -24,6 +24,7 @@
 #include "../map_func.h"
 #include "../rev.h"
 #include "../game/game.hpp"
+#include "../tick_profiler.h"
 
 #include "../safeguards.h"
 
@@ -56,6 +57,7 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_DAILY | ADMIN_FREQUENCY_WEEKLY | ADMIN_FREQUENCY_MONTHLY,                                                       ///< ADMIN_UPDATE_PERFORMANCE
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -640,6 +642,37 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdNames()
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/** Send the timings of the game loop over the last ticks. */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendPerformance()
+{
+	TickProfileSummary summary;
+	GetTickProfileSummary(&summary, TICK_PROFILE_LENGTH);
+
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_PERFORMANCE);
+
+	p->Send_uint16(summary.ticks);
+	p->Send_uint8(TP_END);
+	for (TickPhase i = TP_BEGIN; i < TP_END; i++) {
+		p->Send_uint32(summary.phase_avg[i]);
+		p->Send_uint32(summary.phase_max[i]);
+	}
+	p->Send_uint32(summary.total_avg);
+	p->Send_uint32(summary.total_max);
+
+	for (uint i = 0; i < TICK_PROFILE_SCRIPTS; i++) {
+		if (!summary.script_active[i]) continue;
+		p->Send_bool(true);
+		p->Send_uint8(i == TICK_PROFILE_GAMESCRIPT ? (uint8)OWNER_DEITY : i);
+		p->Send_uint32(summary.script_time[i]);
+		p->Send_uint32(summary.script_ops[i]);
+	}
+	p->Send_bool(false);
+
+	this->SendPacket(p);
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /**
  * Send a command for logging purposes.
  * @param client_id The client executing the command.
@@ -778,6 +811,11 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_PERFORMANCE:
+			/* The admin is requesting the game loop timings. */
+			this->SendPerformance();
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
@@ -1039,6 +1077,10 @@ void NetworkAdminUpdate(AdminUpdateFrequency freq)
 						as->SendCompanyStats();
 						break;
 
+					case ADMIN_UPDATE_PERFORMANCE:
+						as->SendPerformance();
+						break;
+
 					default: NOT_REACHED();
 				}
 			}
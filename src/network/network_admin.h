@@ -71,6 +71,7 @@ public:
 	NetworkRecvStatus SendGameScript(const char *json);
 	NetworkRecvStatus SendCmdNames();
 	NetworkRecvStatus SendCmdLogging(ClientID client_id, const CommandPacket *cp);
+	NetworkRecvStatus SendPerformance();
 	NetworkRecvStatus SendRconEnd(const char *command);
 
 	static void Send();
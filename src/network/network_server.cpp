@@ -54,126 +54,195 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
-struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
+/**
+ * A savegame of the game at the moment a group of clients started joining,
+ * split into packets. The game is saved only once, and the packets are sent
+ * to all clients that were waiting for the map at that moment. Every client
+ * keeps a reference to the snapshot until it has taken all packets, as does
+ * the #PacketWriter that fills it while the game is being saved; the last one
+ * to let go deletes it. A packet is freed as soon as every client took it.
+ */
+struct NetworkMapSnapshot {
 	ThreadMutex *mutex;                 ///< Mutex for making threaded saving safe.
+	SmallVector<Packet *, 256> packets; ///< The packets of the savegame, including the PACKET_SERVER_MAP_DONE packet; \c NULL when all clients took it.
+	SmallVector<uint, 256> unsent;      ///< Number of clients that did not take the packet with the same index yet.
+	size_t total_size;                  ///< Total size of the compressed savegame.
+	bool finished;                      ///< Whether the savegame has been written completely.
+	bool saving;                        ///< Whether the savegame is still being written.
+	uint clients;                       ///< Number of clients this snapshot is sent to.
 
-	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
-	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(NULL), cs(cs), current(NULL), total_size(0), packets(NULL)
+	/** Create an empty snapshot that is being saved. */
+	NetworkMapSnapshot() : mutex(ThreadMutex::New()), total_size(0), finished(false), saving(true), clients(0)
 	{
-		this->mutex = ThreadMutex::New();
 	}
 
-	/** Make sure everything is cleaned up. */
-	~PacketWriter()
+	/** Free the packets. */
+	~NetworkMapSnapshot()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		if (this->cs != NULL && this->mutex != NULL) {
-			this->mutex->WaitForSignal();
-		}
+		for (Packet **p = this->packets.Begin(); p != this->packets.End(); p++) delete *p;
+		delete this->mutex;
+	}
 
-		/* This must all wait until the Destroy function is called. */
+	/** Register a client the snapshot is sent to. */
+	void AddClient()
+	{
+		ThreadMutexLocker lock(this->mutex);
+		this->clients++;
+	}
 
-		while (this->packets != NULL) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
+	/**
+	 * Unregister a client the snapshot is sent to, and free the packets only
+	 * it did not take yet. When it is the last client the saving is
+	 * cancelled; we wait for that as the next client might just be
+	 * requesting a map.
+	 * @param pos Index of the first packet the client did not take.
+	 */
+	void RemoveClient(uint pos)
+	{
+		this->mutex->BeginCritical();
+		assert(this->clients > 0);
+		for (uint i = pos; i < this->packets.Length(); i++) this->ReleasePacket(i);
+		bool last = --this->clients == 0;
+		bool saving = this->saving;
+		this->mutex->EndCritical();
+
+		if (!last) return;
+		if (!saving) {
+			delete this;
+			return;
 		}
 
-		delete this->current;
+		/* The writer fails its next write and deletes the snapshot. */
+		WaitTillSaved();
+		ProcessAsyncSaveFinish();
+	}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+	/** Mark that the writer does not refer to the snapshot anymore. */
+	void StopSaving()
+	{
+		this->mutex->BeginCritical();
+		this->saving = false;
+		bool unused = this->clients == 0;
+		this->mutex->EndCritical();
 
-		delete this->mutex;
-		this->mutex = NULL;
+		if (unused) delete this;
 	}
 
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to NULL, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * Check whether any client still wants the snapshot.
+	 * @return True if there are clients.
 	 */
-	void Destroy()
+	bool HasClients()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		this->cs = NULL;
-
-		if (this->mutex != NULL) this->mutex->SendSignal();
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
-		/* Make sure the saving is completely cancelled. Yes,
-		 * we need to handle the save finish as well as the
-		 * next connection might just be requesting a map. */
-		WaitTillSaved();
-		ProcessAsyncSaveFinish();
+		ThreadMutexLocker lock(this->mutex);
+		return this->clients > 0;
 	}
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Add a packet to the end of the snapshot.
+	 * @param p The packet.
 	 */
-	bool HasPackets()
+	void Append(Packet *p)
 	{
-		return this->packets != NULL;
+		ThreadMutexLocker lock(this->mutex);
+		*this->packets.Append() = p;
+		*this->unsent.Append() = this->clients;
 	}
 
 	/**
-	 * Pop a single created packet from the queue with packets.
+	 * Mark the snapshot as complete.
+	 * @param done The PACKET_SERVER_MAP_DONE packet.
+	 * @param total_size The size of the savegame.
 	 */
-	Packet *PopPacket()
+	void Finish(Packet *done, size_t total_size)
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		ThreadMutexLocker lock(this->mutex);
+		*this->packets.Append() = done;
+		*this->unsent.Append() = this->clients;
+		this->total_size = total_size;
+		this->finished = true;
+	}
 
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = NULL;
+	/**
+	 * Check whether the snapshot is complete.
+	 * @param[out] total_size The size of the savegame, when complete.
+	 * @return True if the snapshot is complete.
+	 */
+	bool IsFinished(size_t *total_size)
+	{
+		ThreadMutexLocker lock(this->mutex);
+		*total_size = this->total_size;
+		return this->finished;
+	}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+	/**
+	 * Take a packet of the snapshot, to send to a client. Every client takes
+	 * each packet once; the last one gets the packet itself, the others a copy.
+	 * @param index Index of the packet.
+	 * @return The packet, or \c NULL if it has not been written yet.
+	 */
+	Packet *TakePacket(uint index)
+	{
+		ThreadMutexLocker lock(this->mutex);
+		if (index >= this->packets.Length()) return NULL;
+
+		Packet *src = this->packets[index];
+		assert(src != NULL && this->unsent[index] > 0);
+		if (--this->unsent[index] == 0) {
+			this->packets[index] = NULL;
+			return src;
+		}
 
+		Packet *p = new Packet(PACKET_SERVER_MAP_DATA);
+		memcpy(p->buffer, src->buffer, src->size);
+		p->size = src->size;
 		return p;
 	}
 
-	/** Append the current packet to the queue. */
-	void AppendQueue()
+private:
+	/**
+	 * Mark that a client won't take a packet, and free it when no client will.
+	 * @param index Index of the packet.
+	 * @pre The mutex is locked.
+	 */
+	void ReleasePacket(uint index)
 	{
-		if (this->current == NULL) return;
+		assert(this->unsent[index] > 0);
+		if (--this->unsent[index] != 0) return;
 
-		Packet **p = &this->packets;
-		while (*p != NULL) {
-			p = &(*p)->next;
-		}
-		*p = this->current;
+		delete this->packets[index];
+		this->packets[index] = NULL;
+	}
+};
 
-		this->current = NULL;
+/** Writing a savegame directly to a number of packets. */
+struct PacketWriter : SaveFilter {
+	NetworkMapSnapshot *snapshot; ///< Snapshot we are writing to.
+	Packet *current;              ///< The packet we're currently writing to.
+	size_t total_size;            ///< Total size of the compressed savegame.
+
+	/**
+	 * Create the packet writer.
+	 * @param snapshot The snapshot we're making the packets for.
+	 */
+	PacketWriter(NetworkMapSnapshot *snapshot) : SaveFilter(NULL), snapshot(snapshot), current(NULL), total_size(0)
+	{
+	}
+
+	/** Make sure everything is cleaned up. */
+	~PacketWriter()
+	{
+		delete this->current;
+		this->snapshot->StopSaving();
 	}
 
 	/* virtual */ void Write(byte *buf, size_t size)
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		/* We want to abort the saving when all sockets are closed. */
+		if (!this->snapshot->HasClients()) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
 		if (this->current == NULL) this->current = new Packet(PACKET_SERVER_MAP_DATA);
 
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
 		byte *bufe = buf + size;
 		while (buf != bufe) {
 			size_t to_write = min(SEND_MTU - this->current->size, bufe - buf);
@@ -182,36 +251,25 @@ struct PacketWriter : SaveFilter {
 			buf += to_write;
 
 			if (this->current->size == SEND_MTU) {
-				this->AppendQueue();
-				if (buf != bufe) this->current = new Packet(PACKET_SERVER_MAP_DATA);
+				this->snapshot->Append(this->current);
+				this->current = buf != bufe ? new Packet(PACKET_SERVER_MAP_DATA) : NULL;
 			}
 		}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
 		this->total_size += size;
 	}
 
 	/* virtual */ void Finish()
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		/* We want to abort the saving when all sockets are closed. */
+		if (!this->snapshot->HasClients()) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
 		/* Make sure the last packet is flushed. */
-		this->AppendQueue();
+		if (this->current != NULL) this->snapshot->Append(this->current);
+		this->current = NULL;
 
 		/* Add a packet stating that this is the end to the queue. */
-		this->current = new Packet(PACKET_SERVER_MAP_DONE);
-		this->AppendQueue();
-
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
+		this->snapshot->Finish(new Packet(PACKET_SERVER_MAP_DONE), this->total_size);
 	}
 };
 
@@ -241,7 +299,7 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 	OrderBackup::ResetUser(this->client_id);
 
 	if (this->savegame != NULL) {
-		this->savegame->Destroy();
+		this->savegame->RemoveClient(this->savegame_pos);
 		this->savegame = NULL;
 	}
 }
@@ -572,42 +630,71 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Start sending a snapshot of the map to this client.
+ * @param snapshot The snapshot of the map at the current frame.
+ */
+void ServerNetworkGameSocketHandler::StartMapTransfer(NetworkMapSnapshot *snapshot)
+{
+	this->savegame = snapshot;
+	this->savegame->AddClient();
+	this->savegame_pos = 0;
+	this->savegame_size_sent = false;
+	this->savegame_packets = 4; // We start with trying 4 packets
+
+	/* Now send the _frame_counter and how many packets are coming */
+	Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
+	p->Send_uint32(_frame_counter);
+	this->SendPacket(p);
+
+	NetworkSyncCommandQueue(this);
+	this->status = STATUS_MAP;
+	/* Mark the start of download */
+	this->last_frame = _frame_counter;
+	this->last_frame_server = _frame_counter;
+}
+
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
+		NetworkMapSnapshot *snapshot = new NetworkMapSnapshot();
 
-		/* Now send the _frame_counter and how many packets are coming */
-		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
-		p->Send_uint32(_frame_counter);
-		this->SendPacket(p);
-
-		NetworkSyncCommandQueue(this);
-		this->status = STATUS_MAP;
-		/* Mark the start of download */
-		this->last_frame = _frame_counter;
-		this->last_frame_server = _frame_counter;
-
-		sent_packets = 4; // We start with trying 4 packets
+		/* Everyone who is waiting for the map gets the same snapshot. */
+		this->StartMapTransfer(snapshot);
+		NetworkClientSocket *new_cs;
+		FOR_ALL_CLIENT_SOCKETS(new_cs) {
+			if (new_cs->status == STATUS_MAP_WAIT) new_cs->StartMapTransfer(snapshot);
+		}
 
 		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		if (SaveWithFilter(new PacketWriter(snapshot), true) != SL_OK) usererror("network savedump failed");
 	}
 
 	if (this->status == STATUS_MAP) {
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
+		/* Fast-track the size to the client. */
+		size_t total_size;
+		if (!this->savegame_size_sent && this->savegame->IsFinished(&total_size)) {
+			Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+			p->Send_uint32((uint32)total_size);
+			this->SendPacket(p);
+			this->savegame_size_sent = true;
+		}
+
+		for (uint i = 0; i < this->savegame_packets; i++) {
+			Packet *p = this->savegame->TakePacket(this->savegame_pos);
+			has_packets = p != NULL;
+			if (!has_packets) break;
+
+			this->savegame_pos++;
 			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
 
 			this->SendPacket(p);
@@ -619,18 +706,22 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 		}
 
 		if (last_packet) {
-			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
+			/* Done reading; the snapshot goes when the last client is done with it. */
+			this->savegame->RemoveClient(this->savegame_pos);
 			this->savegame = NULL;
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
 			this->status = STATUS_DONE_MAP;
 
-			/* Find the best candidate for joining, i.e. the first joiner. */
+			/* Find the best candidate for joining, i.e. the first joiner, once nobody is downloading anymore. */
 			NetworkClientSocket *new_cs;
 			NetworkClientSocket *best = NULL;
 			FOR_ALL_CLIENT_SOCKETS(new_cs) {
+				if (new_cs->status == STATUS_MAP) {
+					best = NULL;
+					break;
+				}
 				if (new_cs->status == STATUS_MAP_WAIT) {
 					if (best == NULL || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
 						best = new_cs;
@@ -638,16 +729,15 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				}
 			}
 
-			/* Is there someone else to join? */
+			/* Is there someone else to join? Then all waiting clients start joining. */
 			if (best != NULL) {
-				/* Let the first start joining. */
 				best->status = STATUS_AUTHORIZED;
 				best->SendMap();
+			}
 
-				/* And update the rest. */
-				FOR_ALL_CLIENT_SOCKETS(new_cs) {
-					if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
-				}
+			/* And update the ones that still have to wait. */
+			FOR_ALL_CLIENT_SOCKETS(new_cs) {
+				if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
 			}
 		}
 
@@ -656,8 +746,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				return NETWORK_RECV_STATUS_CONN_LOST;
 
 			case SPS_ALL_SENT:
-				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				/* All are sent, increase the number of packets to send at once */
+				if (has_packets) this->savegame_packets *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -665,8 +755,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				break;
 
 			case SPS_NONE_SENT:
-				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				/* Not everything is sent, decrease the number of packets to send at once */
+				if (this->savegame_packets > 1) this->savegame_packets /= 2;
 				break;
 		}
 	}
@@ -52,6 +52,8 @@ protected:
 	NetworkRecvStatus SendNeedGamePassword();
 	NetworkRecvStatus SendNeedCompanyPassword();
 
+	void StartMapTransfer(struct NetworkMapSnapshot *snapshot);
+
 public:
 	/** Status of a client */
 	enum ClientStatus {
@@ -75,7 +77,10 @@ public:
 	CommandQueue outgoing_queue; ///< The command-queue awaiting delivery
 	int receive_limit;           ///< Amount of bytes that we can receive at this moment
 
-	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	struct NetworkMapSnapshot *savegame; ///< Snapshot of the map that is being sent to the client.
+	uint savegame_pos;                   ///< Index of the next packet of the snapshot to send.
+	uint savegame_packets;               ///< Number of packets of the snapshot to try to send at once.
+	bool savegame_size_sent;             ///< Whether the size of the snapshot has been sent.
 	NetworkAddress client_address; ///< IP-address of the client (so he can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
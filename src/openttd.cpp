@@ -61,10 +61,17 @@
 #include "game/game_config.hpp"
 #include "town.h"
 #include "subsidy_func.h"
+#include "economy_func.h"
 #include "gfx_layout.h"
 #include "viewport_sprite_sorter.h"
+#include "spritecache.h"
+#include "signal_func.h"
+#include "tick_profiler.h"
 
 #include "linkgraph/linkgraphschedule.h"
+#include "thread/worker_pool.h"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/pf_budget.h"
 
 #include <stdarg.h>
 
@@ -177,6 +184,8 @@ static void ShowHelp()
 		"  -c config_file      = Use 'config_file' instead of 'openttd.cfg'\n"
 		"  -x                  = Do not automatically save to config file on exit\n"
 		"  -q savegame         = Write some information about the savegame and exit\n"
+		"  -B ticks            = Run the savegame given by -g for some ticks without\n"
+		"                        graphics or sound and print the timings as JSON\n"
 		"\n",
 		lastof(buf)
 	);
@@ -302,6 +311,9 @@ static void ShutdownGame()
 #endif
 
 	LinkGraphSchedule::Clear();
+	FreeSignalBlocks();
+	WorkerPool::Uninitialize();
+	StopSpritePrefetching();
 	PoolBase::Clean(PT_ALL);
 
 	/* No NewGRFs were loaded when it was still bootstrapping. */
@@ -521,6 +533,7 @@ static const OptionData _options[] = {
 	 GETOPT_SHORT_VALUE('c'),
 	 GETOPT_SHORT_NOVAL('x'),
 	 GETOPT_SHORT_VALUE('q'),
+	 GETOPT_SHORT_VALUE('B'),
 	 GETOPT_SHORT_NOVAL('h'),
 	GETOPT_END()
 };
@@ -669,6 +682,21 @@ int openttd_main(int argc, char *argv[])
 		case 'G': scanner->generation_seed = atoi(mgo.opt); break;
 		case 'c': free(_config_file); _config_file = stredup(mgo.opt); break;
 		case 'x': scanner->save_config = false; break;
+		case 'B': {
+			/* Benchmark the game loop; nothing is drawn, played or saved. */
+			char driver[64];
+			seprintf(driver, lastof(driver), "null:ticks=%d,benchmark", max(atoi(mgo.opt), 1));
+			free(musicdriver);
+			free(sounddriver);
+			free(videodriver);
+			free(blitter);
+			musicdriver = stredup("null");
+			sounddriver = stredup("null");
+			videodriver = stredup(driver);
+			blitter = stredup("null");
+			scanner->save_config = false;
+			break;
+		}
 		case 'h':
 			i = -2; // Force printing of help.
 			break;
@@ -1229,6 +1257,27 @@ static void CheckCaches()
 		i++;
 	}
 
+	/* Check company rating cache. */
+	CompanyRatingCache old_rating_cache[MAX_COMPANIES];
+	FOR_ALL_COMPANIES(c) old_rating_cache[c->index] = c->rating_cache;
+
+	RebuildCompanyRatingCaches();
+
+	FOR_ALL_COMPANIES(c) {
+		const CompanyRatingCache *old = &old_rating_cache[c->index];
+		const CompanyRatingCache &rc = c->rating_cache;
+		/* An invalidated minimum profit is recomputed when it is needed, so only compare valid ones. */
+		if (old->profitable_vehicles != rc.profitable_vehicles || old->profit_vehicles != rc.profit_vehicles ||
+				old->serviced_facilities != rc.serviced_facilities ||
+				(old->min_profit_valid && old->profit_vehicles > 0 && old->min_profit != rc.min_profit)) {
+			DEBUG(desync, 2, "rating cache mismatch: company %i", (int)c->index);
+		}
+	}
+
+	/* Check the explored signal blocks. */
+	extern void CheckSignalBlocks();
+	CheckSignalBlocks();
+
 	/* Strict checking of the road stop cache entries */
 	const RoadStop *rs;
 	FOR_ALL_ROADSTOPS(rs) {
@@ -1239,6 +1288,9 @@ static void CheckCaches()
 		rs->GetEntry(DIAGDIR_NW)->CheckIntegrity(rs);
 	}
 
+	/* Check that all changes to water tiles invalidated their water region. */
+	CheckWaterRegions();
+
 	Vehicle *v;
 	FOR_ALL_VEHICLES(v) {
 		extern void FillNewGRFVehicleCache(const Vehicle *v);
@@ -1352,12 +1404,15 @@ void StateGameLoop()
 	if (HasModalProgress()) return;
 
 	Layouter::ReduceLineCache();
+	TickProfilerBeginTick();
 
 	if (_game_mode == GM_EDITOR) {
 		BasePersistentStorageArray::SwitchMode(PSM_ENTER_GAMELOOP);
-		RunTileLoop();
-		CallVehicleTicks();
-		CallLandscapeTick();
+		{ TickPhaseTimer timer(TP_TILE_LOOP); RunTileLoop(); }
+		StartPathfinderBudget();
+		{ TickPhaseTimer timer(TP_VEHICLES); CallVehicleTicks(); }
+		EndPathfinderBudget();
+		{ TickPhaseTimer timer(TP_LANDSCAPE); CallLandscapeTick(); }
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP);
 		UpdateLandscapingLimits();
 
@@ -1378,16 +1433,18 @@ void StateGameLoop()
 		Backup<CompanyByte> cur_company(_current_company, OWNER_NONE, FILE_LINE);
 
 		BasePersistentStorageArray::SwitchMode(PSM_ENTER_GAMELOOP);
-		AnimateAnimatedTiles();
-		IncreaseDate();
-		RunTileLoop();
-		CallVehicleTicks();
-		CallLandscapeTick();
+		{ TickPhaseTimer timer(TP_ANIMATED_TILES); AnimateAnimatedTiles(); }
+		{ TickPhaseTimer timer(TP_DATE); IncreaseDate(); }
+		{ TickPhaseTimer timer(TP_TILE_LOOP); RunTileLoop(); }
+		StartPathfinderBudget();
+		{ TickPhaseTimer timer(TP_VEHICLES); CallVehicleTicks(); }
+		EndPathfinderBudget();
+		{ TickPhaseTimer timer(TP_LANDSCAPE); CallLandscapeTick(); }
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP);
 
 #ifndef DEBUG_DUMP_COMMANDS
-		AI::GameLoop();
-		Game::GameLoop();
+		{ TickPhaseTimer timer(TP_AI); AI::GameLoop(); }
+		{ TickPhaseTimer timer(TP_GAMESCRIPT); Game::GameLoop(); }
 #endif
 		UpdateLandscapingLimits();
 
@@ -1396,6 +1453,7 @@ void StateGameLoop()
 		cur_company.Restore();
 	}
 
+	TickProfilerEndTick();
 	assert(IsLocalCompany());
 }
 
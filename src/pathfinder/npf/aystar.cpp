@@ -21,11 +21,14 @@
  *  And when not free'd, it can cause system-crashes.
  * Also remember that when you stop an algorithm before it is finished, your
  * should call clear() yourself!
+ * All nodes come from arenas that keep their memory when cleared, so a
+ * search does not allocate anything once an earlier one was as large.
  */
 
 #include "../../stdafx.h"
 #include "../../core/alloc_func.hpp"
 #include "aystar.h"
+#include "../pf_record.h"
 
 #include "../../safeguards.h"
 
@@ -47,7 +50,7 @@ PathNode *AyStar::ClosedListIsInList(const AyStarNode *node)
 void AyStar::ClosedListAdd(const PathNode *node)
 {
 	/* Add a node to the ClosedList */
-	PathNode *new_node = MallocT<PathNode>(1);
+	PathNode *new_node = this->closedlist_nodes.Alloc();
 	*new_node = *node;
 	this->closedlist_hash.Set(node->node.tile, node->node.direction, new_node);
 }
@@ -85,7 +88,7 @@ OpenListNode *AyStar::OpenListPop()
 void AyStar::OpenListAdd(PathNode *parent, const AyStarNode *node, int f, int g)
 {
 	/* Add a new Node to the OpenList */
-	OpenListNode *new_node = MallocT<OpenListNode>(1);
+	OpenListNode *new_node = this->openlist_nodes.Alloc();
 	new_node->g = g;
 	new_node->path.parent = parent;
 	new_node->path.node = *node;
@@ -174,12 +177,13 @@ int AyStar::Loop()
 		if (this->FoundEndNode != NULL) {
 			this->FoundEndNode(this, current);
 		}
-		free(current);
 		return AYSTAR_FOUND_END_NODE;
 	}
 
 	/* Add the node to the ClosedList */
 	this->ClosedListAdd(&current->path);
+	_pathfinder_stats.nodes++;
+	_pathfinder_stats.searched_nodes++;
 
 	/* Load the neighbours */
 	this->GetNeighbours(this, current);
@@ -190,9 +194,6 @@ int AyStar::Loop()
 		this->CheckTile(&this->neighbours[i], current);
 	}
 
-	/* Free the node */
-	free(current);
-
 	if (this->max_search_nodes != 0 && this->closedlist_hash.GetSize() >= this->max_search_nodes) {
 		/* We've expanded enough nodes */
 		return AYSTAR_LIMIT_REACHED;
@@ -207,11 +208,11 @@ int AyStar::Loop()
  */
 void AyStar::Free()
 {
-	this->openlist_queue.Free(false);
-	/* 2nd argument above is false, below is true, to free the values only
-	 * once */
-	this->openlist_hash.Delete(true);
-	this->closedlist_hash.Delete(true);
+	this->openlist_queue.Free();
+	this->openlist_hash.Delete();
+	this->closedlist_hash.Delete();
+	this->openlist_nodes.Free();
+	this->closedlist_nodes.Free();
 #ifdef AYSTAR_DEBUG
 	printf("[AyStar] Memory free'd\n");
 #endif
@@ -223,12 +224,13 @@ void AyStar::Free()
  */
 void AyStar::Clear()
 {
-	/* Clean the Queue, but not the elements within. That will be done by
-	 * the hash. */
-	this->openlist_queue.Clear(false);
-	/* Clean the hashes */
-	this->openlist_hash.Clear(true);
-	this->closedlist_hash.Clear(true);
+	/* Clean the Queue and the hashes; they do not own the elements */
+	this->openlist_queue.Clear();
+	this->openlist_hash.Clear();
+	this->closedlist_hash.Clear();
+	/* Make the memory of all nodes available for the next search */
+	this->openlist_nodes.Clear();
+	this->closedlist_nodes.Clear();
 
 #ifdef AYSTAR_DEBUG
 	printf("[AyStar] Cleared AyStar\n");
@@ -297,6 +299,8 @@ void AyStar::Init(Hash_HashProc hash, uint num_buckets)
 	/* Allocated the Hash for the OpenList and ClosedList */
 	this->openlist_hash.Init(hash, num_buckets);
 	this->closedlist_hash.Init(hash, num_buckets);
+	this->openlist_nodes.Init();
+	this->closedlist_nodes.Init();
 
 	/* Set up our sorting queue
 	 *  BinaryHeap allocates a block of 1024 nodes
@@ -160,6 +160,9 @@ protected:
 	BinaryHeap openlist_queue;  ///< The open queue.
 	Hash       openlist_hash;   ///< An extra hash to speed up the process of looking up an element in the open list.
 
+	BlockArena<PathNode>     closedlist_nodes; ///< Memory of the nodes in the closed list.
+	BlockArena<OpenListNode> openlist_nodes;   ///< Memory of the nodes that are or were in the open list.
+
 	void OpenListAdd(PathNode *parent, const AyStarNode *node, int f, int g);
 	OpenListNode *OpenListIsInList(const AyStarNode *node);
 	OpenListNode *OpenListPop();
@@ -17,6 +17,7 @@
 #include "../pathfinder_func.h"
 #include "../pathfinder_type.h"
 #include "../follow_track.hpp"
+#include "../pf_budget.h"
 #include "aystar.h"
 
 #include "../../safeguards.h"
@@ -1008,7 +1009,11 @@ static NPFFoundTargetData NPFRouteInternal(AyStarNode *start1, bool ignore_start
 	_npf_aystar.user_data = user;
 
 	/* GO! */
+	/* Non-critical searches may have to do with fewer nodes */
+	uint max_search_nodes = _npf_aystar.max_search_nodes;
+	_npf_aystar.max_search_nodes = GetPathfinderNodeLimit(max_search_nodes);
 	r = _npf_aystar.Main();
+	_npf_aystar.max_search_nodes = max_search_nodes;
 	assert(r != AYSTAR_STILL_BUSY);
 
 	if (result.best_bird_dist != 0) {
@@ -10,7 +10,7 @@
 /** @file queue.cpp Implementation of the #BinaryHeap/#Hash. */
 
 #include "../../stdafx.h"
-#include "../../core/alloc_func.hpp"
+#include "../../core/mem_func.hpp"
 #include "queue.h"
 
 #include "../../safeguards.h"
@@ -27,51 +27,23 @@ const int BinaryHeap::BINARY_HEAP_BLOCKSIZE_MASK = BinaryHeap::BINARY_HEAP_BLOCK
 
 /**
  * Clears the queue, by removing all values from it. Its state is
- * effectively reset. If free_items is true, each of the items cleared
- * in this way are free()'d.
+ * effectively reset. The items are not owned by the queue, so they are
+ * not free()'d; the allocated blocks of memory are kept for the next use.
  */
-void BinaryHeap::Clear(bool free_values)
+void BinaryHeap::Clear()
 {
-	/* Free all items if needed and free all but the first blocks of memory */
-	uint i;
-	uint j;
-
-	for (i = 0; i < this->blocks; i++) {
-		if (this->elements[i] == NULL) {
-			/* No more allocated blocks */
-			break;
-		}
-		/* For every allocated block */
-		if (free_values) {
-			for (j = 0; j < (1 << BINARY_HEAP_BLOCKSIZE_BITS); j++) {
-				/* For every element in the block */
-				if ((this->size >> BINARY_HEAP_BLOCKSIZE_BITS) == i &&
-						(this->size & BINARY_HEAP_BLOCKSIZE_MASK) == j) {
-					break; // We're past the last element
-				}
-				free(this->elements[i][j].item);
-			}
-		}
-		if (i != 0) {
-			/* Leave the first block of memory alone */
-			free(this->elements[i]);
-			this->elements[i] = NULL;
-		}
-	}
 	this->size = 0;
-	this->blocks = 1;
 }
 
 /**
  * Frees the queue, by reclaiming all memory allocated by it. After
- * this it is no longer usable. If free_items is true, any remaining
- * items are free()'d too.
+ * this it is no longer usable.
  */
-void BinaryHeap::Free(bool free_values)
+void BinaryHeap::Free()
 {
 	uint i;
 
-	this->Clear(free_values);
+	this->Clear();
 	for (i = 0; i < this->blocks; i++) {
 		if (this->elements[i] == NULL) break;
 		free(this->elements[i]);
@@ -233,51 +205,26 @@ void BinaryHeap::Init(uint max_size)
  */
 void Hash::Init(Hash_HashProc *hash, uint num_buckets)
 {
-	/* Allocate space for the Hash, the buckets and the bucket flags */
-	uint i;
-
-	/* Ensure the size won't overflow. */
-	CheckAllocationConstraints(sizeof(*this->buckets) + sizeof(*this->buckets_in_use), num_buckets);
-
 	this->hash = hash;
 	this->size = 0;
 	this->num_buckets = num_buckets;
-	this->buckets = (HashNode*)MallocT<byte>(num_buckets * (sizeof(*this->buckets) + sizeof(*this->buckets_in_use)));
-	this->buckets_in_use = (bool*)(this->buckets + num_buckets);
-	for (i = 0; i < num_buckets; i++) this->buckets_in_use[i] = false;
+	this->buckets = MallocT<HashNode>(num_buckets);
+	/* No bucket is of generation 0, so they are all empty */
+	this->bucket_generations = CallocT<uint32>(num_buckets);
+	this->generation = 1;
+	this->nodes.Init();
+	this->free_nodes = NULL;
 }
 
 /**
- * Deletes the hash and cleans up. Only cleans up memory allocated by new_Hash
- * & friends. If free is true, it will call free() on all the values that
- * are left in the hash.
+ * Deletes the hash and cleans up. Only cleans up memory allocated by the
+ * hash itself; the values are owned by the user of the hash.
  */
-void Hash::Delete(bool free_values)
+void Hash::Delete()
 {
-	uint i;
-
-	/* Iterate all buckets */
-	for (i = 0; i < this->num_buckets; i++) {
-		if (this->buckets_in_use[i]) {
-			HashNode *node;
-
-			/* Free the first value */
-			if (free_values) free(this->buckets[i].value);
-			node = this->buckets[i].next;
-			while (node != NULL) {
-				HashNode *prev = node;
-
-				node = node->next;
-				/* Free the value */
-				if (free_values) free(prev->value);
-				/* Free the node */
-				free(prev);
-			}
-		}
-	}
+	this->nodes.Free();
 	free(this->buckets);
-	/* No need to free buckets_in_use, it is always allocated in one
-	 * malloc with buckets */
+	free(this->bucket_generations);
 }
 
 #ifdef HASH_STATS
@@ -292,7 +239,7 @@ void Hash::PrintStatistics() const
 	for (i = 0; i < lengthof(usage); i++) usage[i] = 0;
 	for (i = 0; i < this->num_buckets; i++) {
 		uint collision = 0;
-		if (this->buckets_in_use[i]) {
+		if (this->IsBucketInUse(i)) {
 			const HashNode *node;
 
 			used_buckets++;
@@ -332,34 +279,22 @@ void Hash::PrintStatistics() const
 #endif
 
 /**
- * Cleans the hash, but keeps the memory allocated
+ * Cleans the hash, but keeps the memory allocated. Instead of visiting all
+ * buckets, a new generation is started in which all buckets are empty.
  */
-void Hash::Clear(bool free_values)
+void Hash::Clear()
 {
-	uint i;
-
 #ifdef HASH_STATS
 	if (this->size > 2000) this->PrintStatistics();
 #endif
 
-	/* Iterate all buckets */
-	for (i = 0; i < this->num_buckets; i++) {
-		if (this->buckets_in_use[i]) {
-			HashNode *node;
-
-			this->buckets_in_use[i] = false;
-			/* Free the first value */
-			if (free_values) free(this->buckets[i].value);
-			node = this->buckets[i].next;
-			while (node != NULL) {
-				HashNode *prev = node;
-
-				node = node->next;
-				if (free_values) free(prev->value);
-				free(prev);
-			}
-		}
+	if (++this->generation == 0) {
+		/* Buckets of the first generation would be in use again after the wrap around */
+		MemSetT(this->bucket_generations, 0, this->num_buckets);
+		this->generation = 1;
 	}
+	this->nodes.Clear();
+	this->free_nodes = NULL;
 	this->size = 0;
 }
 
@@ -377,7 +312,7 @@ HashNode *Hash::FindNode(uint key1, uint key2, HashNode** prev_out) const
 	HashNode *result = NULL;
 
 	/* Check if the bucket is empty */
-	if (!this->buckets_in_use[hash]) {
+	if (!this->IsBucketInUse(hash)) {
 		if (prev_out != NULL) *prev_out = NULL;
 		result = NULL;
 	/* Check the first node specially */
@@ -427,12 +362,13 @@ void *Hash::DeleteValue(uint key1, uint key2)
 			/* Copy the second to the first */
 			*node = *next;
 			/* Free the second */
-			free(next);
+			next->next = this->free_nodes;
+			this->free_nodes = next;
 		} else {
 			/* This was the last in this bucket
 			 * Mark it as empty */
 			uint hash = this->hash(key1, key2);
-			this->buckets_in_use[hash] = false;
+			this->bucket_generations[hash] = 0;
 		}
 	} else {
 		/* It is in another node
@@ -441,7 +377,8 @@ void *Hash::DeleteValue(uint key1, uint key2)
 		/* Link previous and next nodes */
 		prev->next = node->next;
 		/* Free the node */
-		free(node);
+		node->next = this->free_nodes;
+		this->free_nodes = node;
 	}
 	if (result != NULL) this->size--;
 	return result;
@@ -467,11 +404,16 @@ void *Hash::Set(uint key1, uint key2, void *value)
 	if (prev == NULL) {
 		/* The bucket is still empty */
 		uint hash = this->hash(key1, key2);
-		this->buckets_in_use[hash] = true;
+		this->bucket_generations[hash] = this->generation;
 		node = this->buckets + hash;
 	} else {
-		/* Add it after prev */
-		node = MallocT<HashNode>(1);
+		/* Add it after prev, reusing a deleted node if there is one */
+		if (this->free_nodes != NULL) {
+			node = this->free_nodes;
+			this->free_nodes = node->next;
+		} else {
+			node = this->nodes.Alloc();
+		}
 		prev->next = node;
 	}
 	node->next = NULL;
@@ -12,9 +12,64 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
+#include "../../core/alloc_func.hpp"
+
 //#define HASH_STATS
 
 
+/**
+ * Allocator for the items of a search, handing them out from blocks of
+ * memory. Clearing it makes all items available again but keeps the blocks,
+ * so once it has grown to the size of a search no memory is allocated.
+ * It is a plain struct, so it can be part of structs that are zeroed.
+ */
+template <typename T>
+struct BlockArena {
+	static const uint BLOCK_BITS = 10;              ///< Number of bits of the index of an item within a block.
+	static const uint BLOCK_SIZE = 1 << BLOCK_BITS; ///< Number of items per block.
+
+	T **blocks;      ///< The blocks of items.
+	uint num_blocks; ///< Number of allocated blocks.
+	uint used;       ///< Number of items handed out since the last #Clear.
+
+	/** Initializes the arena, without allocating anything yet. */
+	void Init()
+	{
+		this->blocks = NULL;
+		this->num_blocks = 0;
+		this->used = 0;
+	}
+
+	/**
+	 * Get an unused item.
+	 * @return The item; it is not initialised.
+	 */
+	inline T *Alloc()
+	{
+		uint block = this->used >> BLOCK_BITS;
+		if (block == this->num_blocks) {
+			this->blocks = ReallocT(this->blocks, this->num_blocks + 1);
+			this->blocks[this->num_blocks++] = MallocT<T>(BLOCK_SIZE);
+		}
+		return &this->blocks[block][this->used++ & (BLOCK_SIZE - 1)];
+	}
+
+	/** Makes all items available again, keeping the memory. */
+	inline void Clear()
+	{
+		this->used = 0;
+	}
+
+	/** Frees all memory of the arena. */
+	void Free()
+	{
+		for (uint i = 0; i < this->num_blocks; i++) free(this->blocks[i]);
+		free(this->blocks);
+		this->Init();
+	}
+};
+
+
 struct BinaryHeapNode {
 	void *item;
 	int priority;
@@ -35,8 +90,8 @@ struct BinaryHeap {
 	bool Push(void *item, int priority);
 	void *Pop();
 	bool Delete(void *item, int priority);
-	void Clear(bool free_values);
-	void Free(bool free_values);
+	void Clear();
+	void Free();
 
 	/**
 	 * Get an element from the #elements.
@@ -79,9 +134,15 @@ struct Hash {
 	uint num_buckets;
 	/* A pointer to an array of num_buckets buckets. */
 	HashNode *buckets;
-	/* A pointer to an array of numbuckets booleans, which will be true if
-	 * there are any Nodes in the bucket */
-	bool *buckets_in_use;
+	/* A pointer to an array of num_buckets generations; a bucket has any
+	 * Nodes when its generation is the current one */
+	uint32 *bucket_generations;
+	/* The current generation; clearing the hash starts a new one */
+	uint32 generation;
+	/* The Nodes beyond the first of a bucket */
+	BlockArena<HashNode> nodes;
+	/* Deleted Nodes of the arena, linked by their next pointer */
+	HashNode *free_nodes;
 
 	void Init(Hash_HashProc *hash, uint num_buckets);
 
@@ -90,8 +151,8 @@ struct Hash {
 
 	void *DeleteValue(uint key1, uint key2);
 
-	void Clear(bool free_values);
-	void Delete(bool free_values);
+	void Clear();
+	void Delete();
 
 	/**
 	 * Gets the current size of the hash.
@@ -106,6 +167,16 @@ protected:
 	void PrintStatistics() const;
 #endif
 	HashNode *FindNode(uint key1, uint key2, HashNode** prev_out) const;
+
+	/**
+	 * Checks whether there are any Nodes in a bucket.
+	 * @param hash The bucket.
+	 * @return True if the bucket has Nodes.
+	 */
+	inline bool IsBucketInUse(uint hash) const
+	{
+		return this->bucket_generations[hash] == this->generation;
+	}
 };
 
 #endif /* QUEUE_H */
@@ -0,0 +1,101 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_budget.cpp Limiting the time non-critical path finder searches take per tick. */
+
+#include "../stdafx.h"
+#include "pf_budget.h"
+#include "pf_record.h"
+
+#include "../safeguards.h"
+
+/**
+ * Number of nodes the non-critical searches of the current tick may still
+ * expand. It is reset when the vehicles start their tick, so it is not part
+ * of the state that has to be saved.
+ */
+static int64 _pathfinder_budget = PATHFINDER_NONCRITICAL_NODES_PER_TICK;
+
+/**
+ * Whether the vehicles are ticking, i.e. whether the budget applies. Searches
+ * done by commands between (or during other parts of) the ticks are not
+ * limited; otherwise their results would depend on the budget the previous
+ * tick left, which clients that joined later don't know.
+ */
+static bool _pathfinder_budget_active = false;
+
+/** Maximum number of nodes a search may expand, or UINT_MAX for no limit besides the settings. */
+static uint _pathfinder_node_limit = UINT_MAX;
+
+/** Give the non-critical path finder searches of the vehicles of a new tick their budget. */
+void StartPathfinderBudget()
+{
+	_pathfinder_budget = PATHFINDER_NONCRITICAL_NODES_PER_TICK;
+	_pathfinder_budget_active = true;
+}
+
+/** Stop limiting the non-critical path finder searches after the vehicles ticked. */
+void EndPathfinderBudget()
+{
+	_pathfinder_budget_active = false;
+}
+
+/**
+ * Check whether non-critical path finder searches may still be done this tick.
+ * @return True if the budget of the tick is not used up, or if there is no budget as the vehicles are not ticking.
+ */
+bool HasPathfinderBudget()
+{
+	return !_pathfinder_budget_active || _pathfinder_budget > 0;
+}
+
+/**
+ * Check whether the searches are limited to fewer nodes than the settings
+ * allow. Caches of search results must then not be used, as the results
+ * differ from those of normal searches.
+ * @return True if the searches are limited.
+ */
+bool IsPathfinderNodeLimited()
+{
+	return _pathfinder_node_limit != UINT_MAX;
+}
+
+/**
+ * Get the number of nodes a search may expand.
+ * @param max_search_nodes The number according to the settings, 0 for no limit.
+ * @return The number of nodes, 0 for no limit.
+ */
+uint GetPathfinderNodeLimit(uint max_search_nodes)
+{
+	if (!IsPathfinderNodeLimited()) return max_search_nodes;
+	return max_search_nodes == 0 ? _pathfinder_node_limit : min(max_search_nodes, _pathfinder_node_limit);
+}
+
+/**
+ * Start a non-critical search.
+ * @param active Whether the search is non-critical; if not, nothing is done.
+ * @param limit_nodes Whether to limit the number of nodes of the search when the budget is used up.
+ */
+NonCriticalPathfinderSearch::NonCriticalPathfinderSearch(bool active, bool limit_nodes) : active(active)
+{
+	if (!this->active) return;
+
+	this->start_nodes = _pathfinder_stats.searched_nodes;
+	this->old_node_limit = _pathfinder_node_limit;
+	if (limit_nodes && !HasPathfinderBudget()) _pathfinder_node_limit = min(_pathfinder_node_limit, PATHFINDER_LOST_VEHICLE_NODES);
+}
+
+/** End a non-critical search, charging its nodes to the budget. */
+NonCriticalPathfinderSearch::~NonCriticalPathfinderSearch()
+{
+	if (!this->active) return;
+
+	_pathfinder_budget -= (int64)(_pathfinder_stats.searched_nodes - this->start_nodes);
+	_pathfinder_node_limit = this->old_node_limit;
+}
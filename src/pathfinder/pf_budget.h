@@ -0,0 +1,47 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_budget.h Limiting the time non-critical path finder searches take per tick. */
+
+#ifndef PF_BUDGET_H
+#define PF_BUDGET_H
+
+/** Number of nodes the non-critical path finder searches of one tick may expand together. */
+static const uint PATHFINDER_NONCRITICAL_NODES_PER_TICK = 20000;
+
+/** Number of nodes a search of a lost vehicle may expand when the budget of the tick is used up. */
+static const uint PATHFINDER_LOST_VEHICLE_NODES = 1000;
+
+/** Interval in days at which a vehicle searches for a depot to be serviced at, even when the budget of the tick is used up. */
+static const uint PATHFINDER_SERVICE_SEARCH_INTERVAL = 8;
+
+void StartPathfinderBudget();
+void EndPathfinderBudget();
+bool HasPathfinderBudget();
+bool IsPathfinderNodeLimited();
+uint GetPathfinderNodeLimit(uint max_search_nodes);
+
+/**
+ * Scope of a path finder search whose result is not needed right away, like
+ * the search for a depot to be serviced at, or the track choice of a lost
+ * vehicle. The nodes it expands are charged to the budget of the tick, which
+ * only applies while the vehicles tick. The budget is counted in nodes rather
+ * than time, so all clients make the same decisions based on it.
+ */
+class NonCriticalPathfinderSearch {
+	bool active;         ///< Whether the search is non-critical at all.
+	uint64 start_nodes;  ///< Value of PathfinderStats::searched_nodes at the start of the search.
+	uint old_node_limit; ///< The node limit before the search.
+
+public:
+	NonCriticalPathfinderSearch(bool active, bool limit_nodes);
+	~NonCriticalPathfinderSearch();
+};
+
+#endif /* PF_BUDGET_H */
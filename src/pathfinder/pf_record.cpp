@@ -0,0 +1,183 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_record.cpp Recording the path finder queries of vehicles, and replaying them. */
+
+#include "../stdafx.h"
+#include "../train.h"
+#include "../roadveh.h"
+#include "../ship.h"
+#include "../fileio_func.h"
+#include "../map_func.h"
+#include "../debug.h"
+#include "pf_record.h"
+#include "npf/npf_func.h"
+#include "opf/opf_ship.h"
+#include "yapf/yapf.h"
+
+#include "../safeguards.h"
+
+PathfinderStats _pathfinder_stats; ///< The work done by the path finders so far.
+FILE *_pathfinder_record_file;     ///< The file queries are recorded to, or \c NULL when not recording.
+
+/** Line at the start of a file with queries, describing the columns. */
+static const char * const PATHFINDER_QUERIES_HEADER = "# OpenTTD path finder queries: type vehicle tile enterdir tracks order dest_tile pathfinder result path_found\n";
+
+/**
+ * Start recording the path finder queries of all vehicles.
+ * @param filename The file in the autosave directory to write them to.
+ * @return Whether the file could be opened.
+ */
+bool StartRecordingPathfinderQueries(const char *filename)
+{
+	StopRecordingPathfinderQueries();
+
+	_pathfinder_record_file = FioFOpenFile(filename, "w", AUTOSAVE_DIR);
+	if (_pathfinder_record_file == NULL) return false;
+
+	fputs(PATHFINDER_QUERIES_HEADER, _pathfinder_record_file);
+	return true;
+}
+
+/** Stop recording path finder queries. */
+void StopRecordingPathfinderQueries()
+{
+	if (_pathfinder_record_file == NULL) return;
+
+	FioFCloseFile(_pathfinder_record_file);
+	_pathfinder_record_file = NULL;
+}
+
+/**
+ * Write a path finder query to the record file.
+ * @param v The vehicle.
+ * @param tile The tile the vehicle is about to enter.
+ * @param enterdir The direction the vehicle enters the tile from.
+ * @param tracks The tracks or trackdirs to choose from.
+ * @param pathfinder The path finder that answered the query.
+ * @param result The chosen track or trackdir.
+ * @param path_found Whether the path finder found a path.
+ */
+void WritePathfinderQuery(const Vehicle *v, TileIndex tile, DiagDirection enterdir, uint tracks, VehiclePathFinders pathfinder, uint result, bool path_found)
+{
+	fprintf(_pathfinder_record_file, "%u %u %u %u %u %u %u %u %u %u\n",
+			(uint)v->type, v->index, tile, enterdir, tracks, v->current_order.Pack(), v->dest_tile, pathfinder, result, path_found);
+}
+
+/**
+ * Load recorded path finder queries.
+ * @param filename The file in the autosave directory to read them from.
+ * @param[out] queries The queries.
+ * @return Whether the file could be read; lines that are not queries are skipped.
+ */
+bool LoadPathfinderQueries(const char *filename, PathfinderQueries &queries)
+{
+	queries.Clear();
+
+	FILE *f = FioFOpenFile(filename, "r", AUTOSAVE_DIR);
+	if (f == NULL) return false;
+
+	char line[256];
+	uint skipped = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (line[0] == '#') continue;
+
+		uint type, vehicle, tile, enterdir, tracks, order, dest_tile, pathfinder, result, path_found;
+		if (sscanf(line, "%u %u %u %u %u %u %u %u %u %u", &type, &vehicle, &tile, &enterdir, &tracks, &order, &dest_tile, &pathfinder, &result, &path_found) != 10 ||
+				type > VEH_SHIP || vehicle >= INVALID_VEHICLE || enterdir >= DIAGDIR_END || pathfinder > VPF_YAPF) {
+			skipped++;
+			continue;
+		}
+
+		PathfinderQuery *q = queries.Append();
+		q->type = (VehicleType)type;
+		q->vehicle = vehicle;
+		q->tile = tile;
+		q->enterdir = (DiagDirection)enterdir;
+		q->tracks = tracks;
+		q->order = order;
+		q->dest_tile = dest_tile;
+		q->pathfinder = (VehiclePathFinders)pathfinder;
+		q->result = result;
+		q->path_found = path_found != 0;
+	}
+	FioFCloseFile(f);
+
+	if (skipped != 0) DEBUG(misc, 0, "Skipped %u invalid path finder queries in %s", skipped, filename);
+	return true;
+}
+
+/**
+ * Ask a path finder a recorded query again. The vehicle gets the order and
+ * destination it had when the query was recorded for the duration of the
+ * query; it must still exist, and the tile must still have the tracks the
+ * vehicle could choose from. Trains do not reserve the path they find.
+ * @param query The query.
+ * @param pathfinder The path finder to ask.
+ * @param[out] result The chosen track (trains and ships) or trackdir (road vehicles).
+ * @param[out] path_found Whether the path finder found a path.
+ * @return Whether the query could be asked in the current game.
+ */
+bool ReplayPathfinderQuery(const PathfinderQuery &query, VehiclePathFinders pathfinder, uint &result, bool &path_found)
+{
+	Vehicle *v = Vehicle::GetIfValid(query.vehicle);
+	if (v == NULL || v->type != query.type || !v->IsPrimaryVehicle() || (v->vehstatus & VS_CRASHED) != 0) return false;
+	if (query.tile >= MapSize()) return false;
+	if (pathfinder == VPF_OPF && query.type != VEH_SHIP) return false;
+
+	/* The path finders expect a choice between tracks that are actually there. */
+	uint available;
+	switch (query.type) {
+		case VEH_TRAIN: available = TrackStatusToTrackBits(GetTileTrackStatus(query.tile, TRANSPORT_RAIL, 0)) & DiagdirReachesTracks(query.enterdir); break;
+		case VEH_ROAD:  available = TrackStatusToTrackdirBits(GetTileTrackStatus(query.tile, TRANSPORT_ROAD, RoadVehicle::From(v)->compatible_roadtypes)) & DiagdirReachesTrackdirs(query.enterdir); break;
+		case VEH_SHIP:  available = TrackStatusToTrackBits(GetTileTrackStatus(query.tile, TRANSPORT_WATER, 0)) & DiagdirReachesTracks(query.enterdir); break;
+		default: return false;
+	}
+	if (query.tracks == 0 || (query.tracks & ~available) != 0) return false;
+
+	Order order = v->current_order;
+	TileIndex dest_tile = v->dest_tile;
+	v->current_order = Order(query.order);
+	v->dest_tile = query.dest_tile;
+
+	path_found = true;
+	switch (query.type) {
+		case VEH_TRAIN: {
+			const Train *t = Train::From(v);
+			TrackBits tracks = (TrackBits)query.tracks;
+			result = (pathfinder == VPF_NPF ? NPFTrainChooseTrack : YapfTrainChooseTrack)(t, query.tile, query.enterdir, tracks, path_found, false, NULL);
+			break;
+		}
+
+		case VEH_ROAD: {
+			const RoadVehicle *rv = RoadVehicle::From(v);
+			TrackdirBits trackdirs = (TrackdirBits)query.tracks;
+			result = (pathfinder == VPF_NPF ? NPFRoadVehicleChooseTrack : YapfRoadVehicleChooseTrack)(rv, query.tile, query.enterdir, trackdirs, path_found);
+			break;
+		}
+
+		case VEH_SHIP: {
+			const Ship *s = Ship::From(v);
+			TrackBits tracks = (TrackBits)query.tracks;
+			switch (pathfinder) {
+				case VPF_OPF:  result = OPFShipChooseTrack(s, query.tile, query.enterdir, tracks, path_found); break;
+				case VPF_NPF:  result = NPFShipChooseTrack(s, query.tile, query.enterdir, tracks, path_found); break;
+				case VPF_YAPF: result = YapfShipChooseTrack(s, query.tile, query.enterdir, tracks, path_found); break;
+				default: NOT_REACHED();
+			}
+			break;
+		}
+
+		default: NOT_REACHED();
+	}
+
+	v->current_order = order;
+	v->dest_tile = dest_tile;
+	return true;
+}
@@ -0,0 +1,70 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file pf_record.h Recording the path finder queries of vehicles, and replaying them. */
+
+#ifndef PF_RECORD_H
+#define PF_RECORD_H
+
+#include "../vehicle_type.h"
+#include "../tile_type.h"
+#include "../direction_type.h"
+#include "../core/smallvec_type.hpp"
+
+/** Counters of the work done by the path finders. They are never reset; take differences. */
+struct PathfinderStats {
+	uint64 nodes;          ///< Number of nodes expanded by YAPF and NPF.
+	uint64 cache_hits;     ///< Number of node costs and road vehicle routes that were taken from a cache.
+	uint64 searched_nodes; ///< Like #nodes, but routes taken from a cache count the nodes their search expanded; the same on all clients.
+};
+
+extern PathfinderStats _pathfinder_stats;
+
+/** A path finder query of a vehicle, as recorded during a game. */
+struct PathfinderQuery {
+	VehicleType type;              ///< Type of the vehicle.
+	VehicleID vehicle;             ///< The vehicle.
+	TileIndex tile;                ///< The tile the vehicle is about to enter.
+	DiagDirection enterdir;        ///< The direction the vehicle enters the tile from.
+	uint tracks;                   ///< The tracks (trains and ships) or trackdirs (road vehicles) to choose from.
+	uint32 order;                  ///< The current order of the vehicle, see Order::Pack.
+	TileIndex dest_tile;           ///< The tile the vehicle heads for.
+	VehiclePathFinders pathfinder; ///< The path finder that answered the query.
+	uint result;                   ///< The chosen track (trains and ships) or trackdir (road vehicles).
+	bool path_found;               ///< Whether the path finder found a path.
+};
+
+/** A list of path finder queries. */
+typedef SmallVector<PathfinderQuery, 64> PathfinderQueries;
+
+extern FILE *_pathfinder_record_file;
+
+bool StartRecordingPathfinderQueries(const char *filename);
+void StopRecordingPathfinderQueries();
+void WritePathfinderQuery(const Vehicle *v, TileIndex tile, DiagDirection enterdir, uint tracks, VehiclePathFinders pathfinder, uint result, bool path_found);
+
+/**
+ * Record a path finder query, if queries are being recorded.
+ * @param v The vehicle.
+ * @param tile The tile the vehicle is about to enter.
+ * @param enterdir The direction the vehicle enters the tile from.
+ * @param tracks The tracks or trackdirs to choose from.
+ * @param pathfinder The path finder that answered the query.
+ * @param result The chosen track or trackdir.
+ * @param path_found Whether the path finder found a path.
+ */
+static inline void RecordPathfinderQuery(const Vehicle *v, TileIndex tile, DiagDirection enterdir, uint tracks, VehiclePathFinders pathfinder, uint result, bool path_found)
+{
+	if (_pathfinder_record_file != NULL) WritePathfinderQuery(v, tile, enterdir, tracks, pathfinder, result, path_found);
+}
+
+bool LoadPathfinderQueries(const char *filename, PathfinderQueries &queries);
+bool ReplayPathfinderQuery(const PathfinderQuery &query, VehiclePathFinders pathfinder, uint &result, bool &path_found);
+
+#endif /* PF_RECORD_H */
@@ -0,0 +1,352 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.cpp Dividing the water of the map into square regions to assist pathfinding for ships. */
+
+#include "../stdafx.h"
+#include "water_regions.h"
+#include "../map_func.h"
+#include "../landscape.h"
+#include "../track_func.h"
+#include "../tunnelbridge_map.h"
+#include "../debug.h"
+
+#include "../safeguards.h"
+
+/**
+ * The connectivity of the water within a water region. The labels of the
+ * tiles are stored separately in #_water_region_labels.
+ */
+struct WaterRegion {
+	bool valid;                       ///< Whether the region has been computed since the last change to its tiles.
+	bool has_cross_region_aqueducts;  ///< Whether an aqueduct leads from this region to another one.
+	uint8 number_of_patches;          ///< Number of connected water patches in the region.
+	WaterRegionPatchLabel edge_labels[DIAGDIR_END][WATER_REGION_EDGE_LENGTH]; ///< Per edge of the region the labels of the tiles that ships can leave the region from, or #INVALID_WATER_REGION_PATCH.
+};
+
+static WaterRegion *_water_regions = NULL;                  ///< All water regions, row by row.
+static WaterRegionPatchLabel *_water_region_labels = NULL; ///< The patch label of each tile, grouped per water region.
+static uint _water_regions_x = 0;                           ///< Number of water regions along the X axis of the map.
+static uint _water_regions_y = 0;                           ///< Number of water regions along the Y axis of the map.
+
+/**
+ * Get the index of a tile within its water region.
+ * @param tile The tile.
+ * @return The index in [0, #WATER_REGION_NUMBER_OF_TILES).
+ */
+static inline uint GetLocalIndex(TileIndex tile)
+{
+	return GB(TileX(tile), 0, WATER_REGION_EDGE_BITS) | GB(TileY(tile), 0, WATER_REGION_EDGE_BITS) << WATER_REGION_EDGE_BITS;
+}
+
+/**
+ * Get the tile at a position within a water region.
+ * @param x X coordinate of the region.
+ * @param y Y coordinate of the region.
+ * @param local Index of the tile within the region.
+ * @return The tile.
+ */
+static inline TileIndex GetRegionTile(uint x, uint y, uint local)
+{
+	return TileXY((x << WATER_REGION_EDGE_BITS) + GB(local, 0, WATER_REGION_EDGE_BITS), (y << WATER_REGION_EDGE_BITS) + GB(local, WATER_REGION_EDGE_BITS, WATER_REGION_EDGE_BITS));
+}
+
+/**
+ * Get the index of the tile at a position along an edge of a water region.
+ * @param side The edge.
+ * @param i The position along the edge.
+ * @return The index of the tile within the region.
+ */
+static inline uint GetEdgeIndex(DiagDirection side, uint i)
+{
+	static const uint LAST = WATER_REGION_EDGE_LENGTH - 1;
+	switch (side) {
+		case DIAGDIR_NE: return 0 | i << WATER_REGION_EDGE_BITS;
+		case DIAGDIR_SE: return i | LAST << WATER_REGION_EDGE_BITS;
+		case DIAGDIR_SW: return LAST | i << WATER_REGION_EDGE_BITS;
+		case DIAGDIR_NW: return i | 0 << WATER_REGION_EDGE_BITS;
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Check whether a tile is the head of an aqueduct.
+ * @param tile The tile.
+ * @return True if ships can enter an aqueduct at the tile.
+ */
+static inline bool IsAqueductHead(TileIndex tile)
+{
+	return IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_WATER;
+}
+
+/**
+ * Get the edges of a tile that ships can leave it through to the adjacent
+ * tile. As ships can always turn around, they can also enter the tile
+ * through these edges, provided the adjacent tile allows it.
+ * @param tile The tile.
+ * @return Bitmask of DiagDirection.
+ */
+static uint8 GetWaterExitSides(TileIndex tile)
+{
+	uint8 sides = 0;
+	for (TrackdirBits tdb = TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0)); tdb != TRACKDIR_BIT_NONE; tdb = KillFirstBit(tdb)) {
+		SetBit(sides, TrackdirToExitdir((Trackdir)FindFirstBit2x64(tdb)));
+	}
+	/* Ships going onto the aqueduct end up at its other end, not on the tile next to the head. */
+	if (sides != 0 && IsAqueductHead(tile)) ClrBit(sides, GetTunnelBridgeDirection(tile));
+	return sides;
+}
+
+/**
+ * Find the connected water patches of a water region.
+ * @param x X coordinate of the region.
+ * @param y Y coordinate of the region.
+ * @param[out] region The connectivity of the region.
+ * @param[out] labels The label of each tile of the region.
+ */
+static void ComputeWaterRegion(uint x, uint y, WaterRegion &region, WaterRegionPatchLabel *labels)
+{
+	uint8 sides[WATER_REGION_NUMBER_OF_TILES];
+	TileIndex aqueduct_ends[WATER_REGION_NUMBER_OF_TILES];
+
+	region.has_cross_region_aqueducts = false;
+	for (uint i = 0; i < WATER_REGION_NUMBER_OF_TILES; i++) {
+		TileIndex tile = GetRegionTile(x, y, i);
+		sides[i] = GetWaterExitSides(tile);
+		aqueduct_ends[i] = INVALID_TILE;
+		if (sides[i] == 0 || !IsAqueductHead(tile)) continue;
+
+		aqueduct_ends[i] = GetOtherTunnelBridgeEnd(tile);
+		if (TileX(aqueduct_ends[i]) >> WATER_REGION_EDGE_BITS != x || TileY(aqueduct_ends[i]) >> WATER_REGION_EDGE_BITS != y) {
+			region.has_cross_region_aqueducts = true;
+		}
+	}
+
+	/* Flood fill the patches; two adjacent tiles are connected when both can be left towards the other. */
+	memset(labels, INVALID_WATER_REGION_PATCH, WATER_REGION_NUMBER_OF_TILES * sizeof(*labels));
+	uint stack[WATER_REGION_NUMBER_OF_TILES];
+	uint label = INVALID_WATER_REGION_PATCH;
+	for (uint start = 0; start < WATER_REGION_NUMBER_OF_TILES; start++) {
+		if (sides[start] == 0 || labels[start] != INVALID_WATER_REGION_PATCH) continue;
+
+		/* Should there ever be more patches than labels, the remaining tiles
+		 * share the last label. The pathfinder then has to find out itself
+		 * that some of them are not connected, which it does. */
+		if (label < UINT8_MAX) label++;
+
+		uint depth = 0;
+		labels[start] = label;
+		stack[depth++] = start;
+		while (depth > 0) {
+			uint cur = stack[--depth];
+			uint cx = GB(cur, 0, WATER_REGION_EDGE_BITS);
+			uint cy = GB(cur, WATER_REGION_EDGE_BITS, WATER_REGION_EDGE_BITS);
+
+			uint8 cur_sides = sides[cur];
+			for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+				if (!HasBit(cur_sides, side)) continue;
+
+				TileIndexDiffC diff = TileIndexDiffCByDiagDir(side);
+				uint nx = cx + diff.x;
+				uint ny = cy + diff.y;
+				if (nx >= WATER_REGION_EDGE_LENGTH || ny >= WATER_REGION_EDGE_LENGTH) continue;
+
+				uint next = nx | ny << WATER_REGION_EDGE_BITS;
+				if (labels[next] != INVALID_WATER_REGION_PATCH || !HasBit(sides[next], ReverseDiagDir(side))) continue;
+				labels[next] = label;
+				stack[depth++] = next;
+			}
+
+			/* Aqueducts within the region connect both their heads. */
+			if (aqueduct_ends[cur] != INVALID_TILE) {
+				TileIndex end = aqueduct_ends[cur];
+				if (TileX(end) >> WATER_REGION_EDGE_BITS == x && TileY(end) >> WATER_REGION_EDGE_BITS == y) {
+					uint next = GetLocalIndex(end);
+					if (labels[next] == INVALID_WATER_REGION_PATCH) {
+						labels[next] = label;
+						stack[depth++] = next;
+					}
+				}
+			}
+		}
+	}
+	region.number_of_patches = label;
+
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		for (uint i = 0; i < WATER_REGION_EDGE_LENGTH; i++) {
+			uint index = GetEdgeIndex(side, i);
+			region.edge_labels[side][i] = HasBit(sides[index], side) ? labels[index] : INVALID_WATER_REGION_PATCH;
+		}
+	}
+	region.valid = true;
+}
+
+/**
+ * Get a water region, computing it first when a tile of it has changed.
+ * @param x X coordinate of the region.
+ * @param y Y coordinate of the region.
+ * @return The up to date region.
+ */
+static const WaterRegion &GetUpdatedWaterRegion(uint x, uint y)
+{
+	assert(x < _water_regions_x && y < _water_regions_y);
+	uint index = x + y * _water_regions_x;
+	WaterRegion &region = _water_regions[index];
+	if (!region.valid) ComputeWaterRegion(x, y, region, &_water_region_labels[index * WATER_REGION_NUMBER_OF_TILES]);
+	return region;
+}
+
+/** Forget all water regions and size them for the current map. */
+void InitializeWaterRegions()
+{
+	free(_water_regions);
+	free(_water_region_labels);
+
+	_water_regions_x = MapSizeX() >> WATER_REGION_EDGE_BITS;
+	_water_regions_y = MapSizeY() >> WATER_REGION_EDGE_BITS;
+	_water_regions = CallocT<WaterRegion>(_water_regions_x * _water_regions_y);
+	_water_region_labels = MallocT<WaterRegionPatchLabel>(MapSize());
+}
+
+/**
+ * Mark the water region of a tile as out of date, as ships might use the
+ * tile differently than before. It is computed again when it is needed.
+ * @param tile The tile that changed.
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	uint x = TileX(tile) >> WATER_REGION_EDGE_BITS;
+	uint y = TileY(tile) >> WATER_REGION_EDGE_BITS;
+	/* While loading the map might not match the regions yet. */
+	if (x >= _water_regions_x || y >= _water_regions_y) return;
+
+	_water_regions[x + y * _water_regions_x].valid = false;
+}
+
+/**
+ * Get the water region patch a tile is part of.
+ * @param tile The tile.
+ * @return The patch; its label is #INVALID_WATER_REGION_PATCH if ships cannot use the tile.
+ */
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile)
+{
+	WaterRegionPatchDesc patch;
+	patch.x = TileX(tile) >> WATER_REGION_EDGE_BITS;
+	patch.y = TileY(tile) >> WATER_REGION_EDGE_BITS;
+
+	GetUpdatedWaterRegion(patch.x, patch.y);
+	patch.label = _water_region_labels[GetWaterRegionIndex(patch) * WATER_REGION_NUMBER_OF_TILES + GetLocalIndex(tile)];
+	return patch;
+}
+
+/**
+ * Get the index of the water region of a patch.
+ * @param patch The patch.
+ * @return The index, unique for each region of the map.
+ */
+uint GetWaterRegionIndex(const WaterRegionPatchDesc &patch)
+{
+	return patch.x + patch.y * _water_regions_x;
+}
+
+/**
+ * Get the tile in the middle of the water region of a patch.
+ * @param patch The patch.
+ * @return The tile.
+ */
+TileIndex GetWaterRegionCenterTile(const WaterRegionPatchDesc &patch)
+{
+	return TileXY((patch.x << WATER_REGION_EDGE_BITS) + WATER_REGION_EDGE_LENGTH / 2, (patch.y << WATER_REGION_EDGE_BITS) + WATER_REGION_EDGE_LENGTH / 2);
+}
+
+/**
+ * Add a patch to a list of patches, unless it is already in there.
+ * @param neighbours The list.
+ * @param patch The patch.
+ */
+static void AddNeighbour(WaterRegionPatchNeighbours &neighbours, const WaterRegionPatchDesc &patch)
+{
+	for (const WaterRegionPatchDesc *n = neighbours.Begin(); n != neighbours.End(); n++) {
+		if (*n == patch) return;
+	}
+	*neighbours.Append() = patch;
+}
+
+/**
+ * Get the patches of other water regions that ships can directly go to
+ * from a water region patch, i.e. by crossing the edge of the region or
+ * by taking an aqueduct.
+ * @param patch The patch.
+ * @param[out] neighbours The neighbouring patches.
+ */
+void GetWaterRegionPatchNeighbours(const WaterRegionPatchDesc &patch, WaterRegionPatchNeighbours &neighbours)
+{
+	neighbours.Clear();
+	if (patch.label == INVALID_WATER_REGION_PATCH) return;
+
+	const WaterRegion &region = GetUpdatedWaterRegion(patch.x, patch.y);
+	for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+		TileIndexDiffC diff = TileIndexDiffCByDiagDir(side);
+		uint nx = patch.x + diff.x;
+		uint ny = patch.y + diff.y;
+		if (nx >= _water_regions_x || ny >= _water_regions_y) continue;
+
+		const WaterRegion &neighbour = GetUpdatedWaterRegion(nx, ny);
+		DiagDirection opposite = ReverseDiagDir(side);
+		for (uint i = 0; i < WATER_REGION_EDGE_LENGTH; i++) {
+			if (region.edge_labels[side][i] != patch.label || neighbour.edge_labels[opposite][i] == INVALID_WATER_REGION_PATCH) continue;
+
+			WaterRegionPatchDesc n;
+			n.x = nx;
+			n.y = ny;
+			n.label = neighbour.edge_labels[opposite][i];
+			AddNeighbour(neighbours, n);
+		}
+	}
+
+	if (!region.has_cross_region_aqueducts) return;
+
+	const WaterRegionPatchLabel *labels = &_water_region_labels[GetWaterRegionIndex(patch) * WATER_REGION_NUMBER_OF_TILES];
+	for (uint i = 0; i < WATER_REGION_NUMBER_OF_TILES; i++) {
+		if (labels[i] != patch.label) continue;
+
+		TileIndex tile = GetRegionTile(patch.x, patch.y, i);
+		if (!IsAqueductHead(tile)) continue;
+
+		WaterRegionPatchDesc n = GetWaterRegionPatchInfo(GetOtherTunnelBridgeEnd(tile));
+		if (n.x != patch.x || n.y != patch.y) AddNeighbour(neighbours, n);
+	}
+}
+
+/**
+ * Check whether all water regions that are considered up to date match
+ * the map. A mismatch means a change to the water was not reported with
+ * #InvalidateWaterRegion, which will cause desyncs as clients that joined
+ * later compute the region anew.
+ */
+void CheckWaterRegions()
+{
+	WaterRegion region;
+	WaterRegionPatchLabel labels[WATER_REGION_NUMBER_OF_TILES];
+
+	for (uint y = 0; y < _water_regions_y; y++) {
+		for (uint x = 0; x < _water_regions_x; x++) {
+			uint index = x + y * _water_regions_x;
+			const WaterRegion &old = _water_regions[index];
+			if (!old.valid) continue;
+
+			ComputeWaterRegion(x, y, region, labels);
+			if (region.number_of_patches != old.number_of_patches || region.has_cross_region_aqueducts != old.has_cross_region_aqueducts ||
+					memcmp(region.edge_labels, old.edge_labels, sizeof(region.edge_labels)) != 0 ||
+					memcmp(labels, &_water_region_labels[index * WATER_REGION_NUMBER_OF_TILES], sizeof(labels)) != 0) {
+				DEBUG(desync, 2, "water region mismatch: region %u, %u", x, y);
+			}
+		}
+	}
+}
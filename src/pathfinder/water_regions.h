@@ -0,0 +1,59 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.h Dividing the water of the map into square regions to assist pathfinding for ships. */
+
+#ifndef WATER_REGIONS_H
+#define WATER_REGIONS_H
+
+#include "../tile_type.h"
+#include "../core/smallvec_type.hpp"
+
+/** Label of a connected water patch within a water region. */
+typedef uint8 WaterRegionPatchLabel;
+
+static const WaterRegionPatchLabel INVALID_WATER_REGION_PATCH = 0; ///< Label of the tiles that ships cannot use.
+
+static const uint WATER_REGION_EDGE_BITS = 4;                                                   ///< Number of bits of a tile coordinate within a water region.
+static const uint WATER_REGION_EDGE_LENGTH = 1 << WATER_REGION_EDGE_BITS;                       ///< Number of tiles along an edge of a water region.
+static const uint WATER_REGION_NUMBER_OF_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH; ///< Number of tiles in a water region.
+
+/**
+ * A connected patch of water within a water region. Within the region ships
+ * can get from every tile of the patch to every other tile of the patch.
+ */
+struct WaterRegionPatchDesc {
+	uint x;                      ///< X coordinate of the region, i.e. the tile X coordinate divided by #WATER_REGION_EDGE_LENGTH.
+	uint y;                      ///< Y coordinate of the region, i.e. the tile Y coordinate divided by #WATER_REGION_EDGE_LENGTH.
+	WaterRegionPatchLabel label; ///< Label of the patch within the region, or #INVALID_WATER_REGION_PATCH.
+
+	inline bool operator==(const WaterRegionPatchDesc &other) const
+	{
+		return this->x == other.x && this->y == other.y && this->label == other.label;
+	}
+
+	inline bool operator!=(const WaterRegionPatchDesc &other) const
+	{
+		return !(*this == other);
+	}
+};
+
+/** The patches that ships can go to directly from a water region patch. */
+typedef SmallVector<WaterRegionPatchDesc, 16> WaterRegionPatchNeighbours;
+
+void InitializeWaterRegions();
+void InvalidateWaterRegion(TileIndex tile);
+void CheckWaterRegions();
+
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile);
+uint GetWaterRegionIndex(const WaterRegionPatchDesc &patch);
+TileIndex GetWaterRegionCenterTile(const WaterRegionPatchDesc &patch);
+void GetWaterRegionPatchNeighbours(const WaterRegionPatchDesc &patch, WaterRegionPatchNeighbours &neighbours);
+
+#endif /* WATER_REGIONS_H */
@@ -15,6 +15,8 @@
 #include "../../landscape.h"
 #include "../pathfinder_func.h"
 #include "../pf_performance_timer.hpp"
+#include "../pf_record.h"
+#include "../pf_budget.h"
 #include "yapf.h"
 
 //#undef FORCEINLINE
@@ -84,7 +84,7 @@ public:
 		: m_pBestDestNode(NULL)
 		, m_pBestIntermediateNode(NULL)
 		, m_settings(&_settings_game.pf.yapf)
-		, m_max_search_nodes(PfGetSettings().max_search_nodes)
+		, m_max_search_nodes(GetPathfinderNodeLimit(PfGetSettings().max_search_nodes))
 		, m_veh(NULL)
 		, m_stats_cost_calcs(0)
 		, m_stats_cache_hits(0)
@@ -154,6 +154,10 @@ public:
 
 		bDestFound &= (m_pBestDestNode != NULL);
 
+		_pathfinder_stats.nodes += m_num_steps;
+		_pathfinder_stats.searched_nodes += m_num_steps;
+		_pathfinder_stats.cache_hits += m_stats_cache_hits;
+
 #ifndef NO_DEBUG_MESSAGES
 		perf.Stop();
 		if (_debug_yapf_level >= 2) {
@@ -13,6 +13,8 @@
 #define YAPF_CACHE_H
 
 #include "../../track_type.h"
+#include "../../tile_type.h"
+#include "../../transport_type.h"
 
 /**
  * Use this function to notify YAPF that track layout (or signal configuration) has change.
@@ -21,4 +23,33 @@
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/**
+ * Use this function to notify YAPF that the road layout (or anything else road vehicles take into account) has changed.
+ * @param tile the tile that is changed
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
+void YapfFlushSegmentCaches();
+
+/** Counters of the segment cost caches of YAPF. */
+struct YapfCacheStats {
+	uint64 hits;      ///< Number of segments that were found in a cache.
+	uint64 misses;    ///< Number of segments that were not found in a cache, i.e. had to be calculated.
+	uint64 evictions; ///< Number of segments removed because the track or road near them changed.
+	uint64 flushes;   ///< Number of times a whole cache was emptied.
+	uint segments;    ///< Number of segments currently in the caches.
+};
+
+void YapfGetCacheStats(TransportType transport, YapfCacheStats *stats);
+void YapfResetCacheStats();
+
+void YapfFlushRoadRouteCache();
+void YapfGetRoadRouteCacheStats(YapfCacheStats *stats);
+void YapfResetRoadRouteCacheStats();
+
+void YapfInvalidateRailStationDistances(TileIndex tile);
+void YapfFlushRailStationDistances();
+void YapfGetRailStationDistancesStats(YapfCacheStats *stats);
+void YapfResetRailStationDistancesStats();
+
 #endif /* YAPF_CACHE_H */
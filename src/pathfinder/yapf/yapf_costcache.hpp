@@ -42,6 +42,14 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF for each tile the segment of the given node passes while its cost is calculated.
+	 *  Nothing is cached, so there is nothing to invalidate later on.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+	}
 };
 
 
@@ -89,23 +97,68 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF for each tile the segment of the given node passes while its cost is calculated.
+	 *  Nothing is cached, so there is nothing to invalidate later on.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+	}
 };
 
 
 /**
- * Base class for segment cost cache providers. Contains global counter
- *  of track layout changes and static notification function called whenever
- *  the track layout changes. It is implemented as base class because it needs
- *  to be shared between all rail YAPF types (one shared counter, one notification
- *  function.
+ * Base class for segment cost caches. Keeps the list of all existing caches,
+ *  so the static notification function that is called whenever the track or
+ *  road layout changes can pass the change on to each of them. It is implemented
+ *  as base class because it needs to be shared between all YAPF types (one
+ *  list of caches, one notification function).
  */
 struct CSegmentCostCacheBase
 {
-	static int   s_rail_change_counter;
+	static SmallVector<CSegmentCostCacheBase *, 8> s_caches; ///< all segment cost caches
+
+	TransportType m_transport; ///< transport type of the segments in the cache
+	uint64 m_hits;      ///< number of segments that were found in the cache
+	uint64 m_misses;    ///< number of segments that were not found in the cache
+	uint64 m_evictions; ///< number of segments removed because the track near them changed
+	uint64 m_flushes;   ///< number of times the whole cache was emptied
+
+	CSegmentCostCacheBase(TransportType transport) : m_transport(transport), m_hits(0), m_misses(0), m_evictions(0), m_flushes(0)
+	{
+		*s_caches.Append() = this;
+	}
 
-	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
+	virtual ~CSegmentCostCacheBase()
 	{
-		s_rail_change_counter++;
+		s_caches.Erase(s_caches.Find(this));
+	}
+
+	/** flush (clear) the cache the next time it is used */
+	virtual void Flush() = 0;
+
+	/** remove the segments that pass the given tile or one of its neighbours */
+	virtual void Invalidate(TileIndex tile) = 0;
+
+	/** number of segments in the cache */
+	virtual uint Count() const = 0;
+
+	/**
+	 * Tell the caches of the given transport type about a changed tile.
+	 * @param transport The transport type, or INVALID_TRANSPORT for all caches.
+	 * @param tile The changed tile, or INVALID_TILE to flush the caches.
+	 */
+	static void NotifyLayoutChange(TransportType transport, TileIndex tile)
+	{
+		for (CSegmentCostCacheBase **it = s_caches.Begin(); it != s_caches.End(); it++) {
+			if (transport != INVALID_TRANSPORT && (*it)->m_transport != transport) continue;
+			if (tile == INVALID_TILE) {
+				(*it)->Flush();
+			} else {
+				(*it)->Invalidate(tile);
+			}
+		}
 	}
 };
 
@@ -119,25 +172,146 @@ struct CSegmentCostCacheBase
  *  of the segment (origin tile and exit-dir from this tile).
  *  Different CYapfCachedCostT types can share the same type of CSegmentCostCacheT.
  *  Look at CYapfRailSegment (yapf_node_rail.hpp) for the segment example
+ *
+ * The tiles each segment passes are kept in a spatial index: the map is split
+ *  in square regions and every region has a list of the (segment, tile) pairs
+ *  within it. A change of the track layout only removes the segments that pass
+ *  the changed tile or one of its neighbours; the neighbours are included as
+ *  the end of a segment depends on the tile after it. Removed segments stay in
+ *  the heap, as it can't free single items, until there are more removed than
+ *  cached segments; then the whole cache is flushed.
+ *
+ * Flushing is delayed until the cache is used by the next path finder, as the
+ *  nodes of a running path finder may still point to the segments in the heap.
  */
 template <class Tsegment>
 struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 	static const int C_HASH_BITS = 14;
+	static const uint C_REGION_BITS = 4;          ///< regions are squares of 2^C_REGION_BITS tiles
+	static const uint C_MIN_FLUSH_EVICTED = 1024; ///< don't flush for less removed segments than this
+	static const uint INVALID_ENTRY = UINT_MAX;   ///< end of the list of a region
 
-	typedef CHashTableT<Tsegment, C_HASH_BITS> HashTable;
+	typedef COpenHashTableT<Tsegment, C_HASH_BITS> HashTable;
 	typedef SmallArray<Tsegment> Heap;
 	typedef typename Tsegment::Key Key;    ///< key to hash table
 
+	/** A tile some segment passes, in the list of the region of the tile. */
+	struct TileEntry {
+		Tsegment *segment; ///< the segment
+		TileIndex tile;    ///< the tile it passes
+		uint next;         ///< index of the next entry in the same region, or INVALID_ENTRY
+	};
+
 	HashTable    m_map;
 	Heap         m_heap;
+	SmallVector<TileEntry, 256> m_tiles; ///< the tiles of all segments in the heap
+	uint        *m_regions;              ///< index of the first entry in m_tiles per region, or INVALID_ENTRY
+	uint         m_map_size_x;           ///< width of the map the regions were made for
+	uint         m_map_size_y;           ///< height of the map the regions were made for
+	uint         m_evicted;              ///< segments in the heap that are no longer in the hash-map
+	bool         m_flush_pending;        ///< the cache has to be flushed before it is used again
 
-	inline CSegmentCostCacheT() {}
+	inline CSegmentCostCacheT(TransportType transport) : CSegmentCostCacheBase(transport), m_regions(NULL), m_map_size_x(0), m_map_size_y(0), m_evicted(0), m_flush_pending(true) {}
 
-	/** flush (clear) the cache */
-	inline void Flush()
+	~CSegmentCostCacheT()
 	{
+		free(m_regions);
+	}
+
+	virtual void Flush()
+	{
+		m_flush_pending = true;
+	}
+
+	/** make sure the cache can be used, i.e. do the pending flush and fit the regions to the map */
+	inline void Update()
+	{
+		if (!m_flush_pending && m_map_size_x == MapSizeX() && m_map_size_y == MapSizeY()) return;
+
+		if (m_regions != NULL) m_flushes++;
+		m_flush_pending = false;
 		m_map.Clear();
 		m_heap.Clear();
+		m_tiles.Clear();
+		m_evicted = 0;
+
+		if (m_map_size_x != MapSizeX() || m_map_size_y != MapSizeY()) {
+			m_map_size_x = MapSizeX();
+			m_map_size_y = MapSizeY();
+			free(m_regions);
+			m_regions = MallocT<uint>(GetRegionCount());
+		}
+		for (uint i = 0; i < GetRegionCount(); i++) m_regions[i] = INVALID_ENTRY;
+	}
+
+	inline uint GetRegionCount() const
+	{
+		return (m_map_size_x >> C_REGION_BITS) * (m_map_size_y >> C_REGION_BITS);
+	}
+
+	inline uint GetRegion(uint x, uint y) const
+	{
+		return (y >> C_REGION_BITS) * (m_map_size_x >> C_REGION_BITS) + (x >> C_REGION_BITS);
+	}
+
+	/** is the segment still in the hash-map, i.e. not removed by Invalidate()? */
+	inline bool IsCached(Tsegment *segment)
+	{
+		return m_map.Find(segment->GetKey()) == segment;
+	}
+
+	virtual void Invalidate(TileIndex tile)
+	{
+		/* Everything goes anyway, or the regions are not made for this map (yet). */
+		if (m_flush_pending || m_map_size_x != MapSizeX() || m_map_size_y != MapSizeY()) {
+			m_flush_pending = true;
+			return;
+		}
+
+		uint x = TileX(tile);
+		uint y = TileY(tile);
+		uint first_x = x > 0 ? x - 1 : 0;
+		uint first_y = y > 0 ? y - 1 : 0;
+		uint last_x = min(x + 1, m_map_size_x - 1);
+		uint last_y = min(y + 1, m_map_size_y - 1);
+
+		for (uint ry = first_y >> C_REGION_BITS; ry <= last_y >> C_REGION_BITS; ry++) {
+			for (uint rx = first_x >> C_REGION_BITS; rx <= last_x >> C_REGION_BITS; rx++) {
+				uint *prev = &m_regions[GetRegion(rx << C_REGION_BITS, ry << C_REGION_BITS)];
+				while (*prev != INVALID_ENTRY) {
+					TileEntry &entry = m_tiles[*prev];
+					if (IsCached(entry.segment)) {
+						if (DistanceMax(entry.tile, tile) > 1) {
+							prev = &entry.next;
+							continue;
+						}
+						m_map.Pop(*entry.segment);
+						m_evicted++;
+						m_evictions++;
+					}
+					/* Unlink entries of removed segments; their other entries go when their region is visited. */
+					*prev = entry.next;
+				}
+			}
+		}
+
+		if (m_evicted >= C_MIN_FLUSH_EVICTED && m_evicted > (uint)m_map.Count()) Flush();
+	}
+
+	virtual uint Count() const
+	{
+		return m_map.Count();
+	}
+
+	/** record that the segment passes the given tile */
+	inline void AddTile(Tsegment &segment, TileIndex tile)
+	{
+		uint &first = m_regions[GetRegion(TileX(tile), TileY(tile))];
+		TileEntry *entry = m_tiles.Append();
+		entry->segment = &segment;
+		entry->tile = tile;
+		entry->next = first;
+		first = m_tiles.Length() - 1;
 	}
 
 	inline Tsegment& Get(Key &key, bool *found)
@@ -150,6 +324,12 @@ struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 		} else {
 			*found = true;
 		}
+		/* segments that were not (or could not be) calculated before are no help */
+		if (item->m_cost >= 0) {
+			m_hits++;
+		} else {
+			m_misses++;
+		}
 		return *item;
 	}
 };
@@ -183,9 +363,8 @@ protected:
 
 	inline static Cache& stGetGlobalCache()
 	{
-		static int last_rail_change_counter = 0;
 		static Date last_date = 0;
-		static Cache C;
+		static Cache C(Types::TrackFollower::TT());
 
 		/* some statistics */
 		if (last_date != _date) {
@@ -194,11 +373,8 @@ protected:
 			_total_pf_time_us = 0;
 		}
 
-		/* delete the cache sometimes... */
-		if (last_rail_change_counter != Cache::s_rail_change_counter) {
-			last_rail_change_counter = Cache::s_rail_change_counter;
-			C.Flush();
-		}
+		/* flush the cache if needed; a new game may also have a different map size */
+		C.Update();
 		return C;
 	}
 
@@ -226,6 +402,15 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF for each tile the segment of the given node passes while its cost is calculated.
+	 *  The global cache remembers them, so the segment can be removed when one of those tiles changes.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+		if (Yapf().CanUseGlobalCache(n)) m_global_cache.AddTile(*n.m_segment, tile);
+	}
 };
 
 #endif /* YAPF_COSTCACHE_HPP */
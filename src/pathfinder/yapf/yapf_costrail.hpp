@@ -381,6 +381,17 @@ public:
 
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
+			/* Let the cache know which tiles the segment passes, including the skipped platform tiles. */
+			Yapf().PfNodeCacheAddTile(n, cur.tile);
+			if (tf->m_is_station) {
+				TileIndexDiff diff = TileOffsByDiagDir(TrackdirToExitdir(ReverseTrackdir(cur.td)));
+				TileIndex tile = cur.tile;
+				for (int i = 0; i < tf->m_tiles_skipped; i++) {
+					tile += diff;
+					Yapf().PfNodeCacheAddTile(n, tile);
+				}
+			}
+
 			/* All other tile costs will be calculated here. */
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
@@ -120,6 +120,7 @@ protected:
 	TileIndex    m_destTile;
 	TrackdirBits m_destTrackdirs;
 	StationID    m_dest_station_id;
+	const RailStationDistances *m_dest_distances; ///< distances to the destination station found by searching backwards, or NULL
 
 	/** to access inherited path finder */
 	Tpf& Yapf()
@@ -155,6 +156,11 @@ public:
 				break;
 		}
 		CYapfDestinationRailBase::SetDestination(v);
+
+		m_dest_distances = NULL;
+		if (m_dest_station_id != INVALID_STATION && Yapf().PfGetSettings().rail_search_from_destination) {
+			m_dest_distances = YapfGetRailStationDistances(m_dest_station_id, v->owner, GetCompatibleRailTypes());
+		}
 	}
 
 	/** Called by YAPF to detect if node ends in the desired destination */
@@ -202,6 +208,14 @@ public:
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+
+		/* The distance along the track is never shorter, unless the station can't be reached at all.
+		 * Then the straight distance still leads lost trains towards it. */
+		if (m_dest_distances != NULL) {
+			int distance = m_dest_distances->GetDistance(tile, n.GetLastTrackdir());
+			d = (distance == RAIL_DISTANCE_UNREACHABLE) ? d + RAIL_DISTANCE_UNREACHABLE : max(d, distance);
+		}
+
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
@@ -12,17 +12,121 @@
 #ifndef YAPF_NODE_ROAD_HPP
 #define YAPF_NODE_ROAD_HPP
 
+/** key for cached segment cost for road YAPF */
+struct CYapfRoadSegmentKey
+{
+	uint32    m_value;
+
+	inline CYapfRoadSegmentKey(const CYapfRoadSegmentKey &src) : m_value(src.m_value) {}
+
+	inline CYapfRoadSegmentKey(const CYapfNodeKeyExitDir &node_key)
+	{
+		Set(node_key);
+	}
+
+	inline void Set(const CYapfRoadSegmentKey &src)
+	{
+		m_value = src.m_value;
+	}
+
+	/* The segment depends on the trackdir, also for nodes that only use the exit direction. */
+	inline void Set(const CYapfNodeKeyExitDir &node_key)
+	{
+		m_value = (((int)node_key.m_tile) << 4) | node_key.m_td;
+	}
+
+	inline int32 CalcHash() const
+	{
+		return m_value;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return (TileIndex)(m_value >> 4);
+	}
+
+	inline Trackdir GetTrackdir() const
+	{
+		return (Trackdir)(m_value & 0x0F);
+	}
+
+	inline bool operator==(const CYapfRoadSegmentKey &other) const
+	{
+		return m_value == other.m_value;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteTile("tile", GetTile());
+		dmp.WriteEnumT("td", GetTrackdir());
+	}
+};
+
+/** cached segment cost for road YAPF */
+struct CYapfRoadSegment
+{
+	typedef CYapfRoadSegmentKey Key;
+
+	CYapfRoadSegmentKey    m_key;
+	TileIndex              m_last_tile;
+	Trackdir               m_last_td;
+	int                    m_cost;      ///< cost of the segment, or -1 if it is not known
+	bool                   m_is_loop;   ///< the segment is a loop without junctions, i.e. a dead end for the path finder
+	CYapfRoadSegment      *m_hash_next;
+
+	inline CYapfRoadSegment(const CYapfRoadSegmentKey &key)
+		: m_key(key)
+		, m_last_tile(INVALID_TILE)
+		, m_last_td(INVALID_TRACKDIR)
+		, m_cost(-1)
+		, m_is_loop(false)
+		, m_hash_next(NULL)
+	{}
+
+	inline const Key& GetKey() const
+	{
+		return m_key;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return m_key.GetTile();
+	}
+
+	inline CYapfRoadSegment *GetHashNext()
+	{
+		return m_hash_next;
+	}
+
+	inline void SetHashNext(CYapfRoadSegment *next)
+	{
+		m_hash_next = next;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteStructT("m_key", &m_key);
+		dmp.WriteTile("m_last_tile", m_last_tile);
+		dmp.WriteEnumT("m_last_td", m_last_td);
+		dmp.WriteLine("m_cost = %d", m_cost);
+		dmp.WriteLine("m_is_loop = %s", m_is_loop ? "Yes" : "No");
+	}
+};
+
 /** Yapf Node for road YAPF */
 template <class Tkey_>
 struct CYapfRoadNodeT : CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > {
 	typedef CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > base;
+	typedef CYapfRoadSegment CachedData;
 
+	CYapfRoadSegment *m_segment;
 	TileIndex m_segment_last_tile;
 	Trackdir  m_segment_last_td;
 
 	void Set(CYapfRoadNodeT *parent, TileIndex tile, Trackdir td, bool is_choice)
 	{
 		base::Set(parent, tile, td, is_choice);
+		m_segment = NULL;
 		m_segment_last_tile = tile;
 		m_segment_last_td = td;
 	}
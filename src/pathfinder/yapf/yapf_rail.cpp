@@ -15,6 +15,7 @@
 #include "yapf_cache.h"
 #include "yapf_node_rail.hpp"
 #include "yapf_costrail.hpp"
+#include "yapf_rail_distance.h"
 #include "yapf_destrail.hpp"
 #include "../../viewport_func.h"
 #include "../../newgrf_station.h"
@@ -124,6 +125,13 @@ private:
 		return (tile != m_res_dest || td != m_res_dest_td) && (tile != m_res_fail_tile || td != m_res_fail_td);
 	}
 
+	/** Tell the segment cost cache about a reserved track/platform. Reservations don't change which tracks are connected. */
+	bool NotifyReservedTrack(TileIndex tile, Trackdir td)
+	{
+		CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_RAIL, tile);
+		return tile != m_res_dest || td != m_res_dest_td;
+	}
+
 public:
 	/** Set the target to where the reservation should be extended. */
 	inline void SetReservationTarget(Node *node, TileIndex tile, Trackdir td)
@@ -180,7 +188,9 @@ public:
 		if (target != NULL) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			for (Node *node = m_res_node; node->m_parent != NULL; node = node->m_parent) {
+				node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::NotifyReservedTrack);
+			}
 		}
 
 		return true;
@@ -636,10 +646,50 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
-int CSegmentCostCacheBase::s_rail_change_counter = 0;
+/** all segment cost caches; if any track or road changes, they are told to invalidate the segments near it */
+SmallVector<CSegmentCostCacheBase *, 8> CSegmentCostCacheBase::s_caches;
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
-	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_RAIL, tile);
+	if (tile == INVALID_TILE) {
+		YapfFlushRailStationDistances();
+	} else {
+		YapfInvalidateRailStationDistances(tile);
+	}
+}
+
+/** Flush the segment cost caches of all transport types, e.g. when a different game is started. */
+void YapfFlushSegmentCaches()
+{
+	CSegmentCostCacheBase::NotifyLayoutChange(INVALID_TRANSPORT, INVALID_TILE);
+}
+
+/**
+ * Get the counters of all segment cost caches of a transport type together.
+ * @param transport The transport type.
+ * @param[out] stats The counters.
+ */
+void YapfGetCacheStats(TransportType transport, YapfCacheStats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	for (CSegmentCostCacheBase **it = CSegmentCostCacheBase::s_caches.Begin(); it != CSegmentCostCacheBase::s_caches.End(); it++) {
+		if ((*it)->m_transport != transport) continue;
+		stats->hits += (*it)->m_hits;
+		stats->misses += (*it)->m_misses;
+		stats->evictions += (*it)->m_evictions;
+		stats->flushes += (*it)->m_flushes;
+		stats->segments += (*it)->Count();
+	}
+}
+
+/** Reset the counters of all segment cost caches. */
+void YapfResetCacheStats()
+{
+	for (CSegmentCostCacheBase **it = CSegmentCostCacheBase::s_caches.Begin(); it != CSegmentCostCacheBase::s_caches.End(); it++) {
+		(*it)->m_hits = 0;
+		(*it)->m_misses = 0;
+		(*it)->m_evictions = 0;
+		(*it)->m_flushes = 0;
+	}
 }
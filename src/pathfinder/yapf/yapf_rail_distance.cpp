@@ -0,0 +1,374 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_rail_distance.cpp Distances along the track to rail stations, found by searching backwards from the station. */
+
+#include "../../stdafx.h"
+#include "../../train.h"
+#include "../../base_station_base.h"
+#include "../../station_map.h"
+#include "../../core/sort_func.hpp"
+
+#include "yapf.hpp"
+#include "yapf_cache.h"
+#include "yapf_rail_distance.h"
+
+#include "../../safeguards.h"
+
+/** Yapf Node for searching backwards; the key is the position of the train, i.e. the trackdir it drives in. */
+struct CYapfRailDistanceNodeT : CYapfNodeT<CYapfNodeKeyTrackDir, CYapfRailDistanceNodeT> { };
+
+/** NodeList type for searching backwards. */
+typedef CNodeList_HashTableT<CYapfRailDistanceNodeT, 12, 16> CRailDistanceNodeList;
+
+/**
+ * YAPF searching backwards from the tiles of a station, i.e. Dijkstra's
+ * algorithm on the reversed track. The tracks are followed from a position
+ * against its trackdir; the positions that are found are the ones a train
+ * can come from. Every tile is a node, and the cost of a node is the length
+ * of the tiles a train drives over from it to the station. Nothing but the
+ * connections of the track matters, so the cost is a lower bound of the cost
+ * of the rail path finder, which never charges less than the length of a
+ * tile. 90 degree turns are always allowed, so the bound holds with and
+ * without them.
+ */
+template <class Types>
+class CYapfRailDistanceT : public CYapfBaseT<Types>
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+protected:
+	const BaseStation *m_station;      ///< The station to search from.
+	RailStationDistances *m_distances; ///< The distances to fill.
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	CYapfRailDistanceT()
+	{
+		/* The distances are cached, so they may not depend on the node budget of the tick they are searched in. */
+		this->m_max_search_nodes = RAIL_DISTANCE_MAX_NODES;
+	}
+
+	/** Called by YAPF to create the nodes of the station tiles; both directions can be the end of a path. */
+	inline void PfSetStartupNodes()
+	{
+		TILE_AREA_LOOP(tile, m_station->train_station) {
+			if (!m_station->TileBelongsToRailStation(tile)) continue;
+
+			Trackdir td = TrackToTrackdir(GetRailStationTrack(tile));
+			for (uint i = 0; i < 2; i++, td = ReverseTrackdir(td)) {
+				Node &node = Yapf().CreateNewNode();
+				node.Set(NULL, tile, td, false);
+				Yapf().AddStartupNode(node);
+			}
+		}
+	}
+
+	/** Called by YAPF to add the positions a train can come from. The node is closed, so its distance is final. */
+	inline void PfFollowNode(Node &old_node)
+	{
+		RailStationDistance *d = m_distances->distances.Append();
+		d->position = RailStationDistances::GetPosition(old_node.GetTile(), old_node.GetTrackdir());
+		d->distance = old_node.m_cost;
+
+		TrackFollower F(m_distances->owner, m_distances->railtypes);
+		if (!F.Follow(old_node.GetTile(), ReverseTrackdir(old_node.GetTrackdir()))) return;
+
+		/* A train coming from the platform of a station is on its last tile,
+		 * not on the one the track follower skips to. */
+		TileIndex tile = F.m_new_tile;
+		if (F.m_is_station) tile = TILE_ADD(tile, -F.m_tiles_skipped * TileOffsByDiagDir(F.m_exitdir));
+
+		for (TrackdirBits rtds = F.m_new_td_bits; rtds != TRACKDIR_BIT_NONE; rtds = KillFirstBit(rtds)) {
+			Node &node = Yapf().CreateNewNode();
+			node.Set(&old_node, tile, ReverseTrackdir(FindFirstTrackdir(rtds)), false);
+			Yapf().AddNewNode(node, F);
+		}
+	}
+
+	/** Called by YAPF to calculate the cost; the length of the tile the train drives to, and of the tunnel or bridge in between. */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		int length = IsDiagonalTrackdir(n.m_parent->GetTrackdir()) ? YAPF_TILE_LENGTH : YAPF_TILE_CORNER_LENGTH;
+		if (!tf->m_is_station) length += tf->m_tiles_skipped * YAPF_TILE_LENGTH;
+		n.m_cost = n.m_parent->m_cost + length;
+		return true;
+	}
+
+	/** Called by YAPF to calculate the cost estimate; nothing is known about where the trains come from. */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		n.m_estimate = n.m_cost;
+		return true;
+	}
+
+	/** There is no destination; the search continues until all positions are visited. */
+	inline bool PfDetectDestination(Node &n)
+	{
+		return false;
+	}
+
+	/** There are no costs to cache. */
+	inline bool PfNodeCacheFetch(Node &n)
+	{
+		return false;
+	}
+
+	/** There are no costs to cache. */
+	inline void PfNodeCacheFlush(Node &n)
+	{
+	}
+
+	/** return debug report character to identify the transportation type */
+	inline char TransportTypeChar() const
+	{
+		return '<';
+	}
+
+	/**
+	 * Search the distances to a station.
+	 * @param station The station.
+	 * @param[in,out] distances The distances, with the station, owner and rail types set.
+	 */
+	static void FindDistances(const BaseStation *station, RailStationDistances &distances)
+	{
+		distances.distances.Clear();
+
+		uint64 start_nodes = _pathfinder_stats.searched_nodes;
+		Tpf pf;
+		pf.m_station = station;
+		pf.m_distances = &distances;
+		pf.FindPath(NULL);
+		distances.nodes = (uint)(_pathfinder_stats.searched_nodes - start_nodes);
+
+		/* When the search stopped early, the positions it did not visit are at least as far away as the last one it did. */
+		distances.radius = pf.m_nodes.OpenCount() == 0 ? RAIL_DISTANCE_UNREACHABLE : distances.distances.End()[-1].distance;
+
+		QSortT(distances.distances.Begin(), distances.distances.Length(), &RailStationDistanceSorter);
+	}
+
+private:
+	/** Sort the distances by position. */
+	static int CDECL RailStationDistanceSorter(const RailStationDistance *a, const RailStationDistance *b)
+	{
+		return (a->position > b->position) - (a->position < b->position);
+	}
+};
+
+/** Config struct of YAPF for searching backwards from a station. */
+template <class Tpf_, class Ttrack_follower, class Tnode_list>
+struct CYapfRailDistance_TypesT
+{
+	/** Types - shortcut for this struct type */
+	typedef CYapfRailDistance_TypesT<Tpf_, Ttrack_follower, Tnode_list> Types;
+
+	/** Tpf - pathfinder type */
+	typedef Tpf_                              Tpf;
+	/** track follower helper class */
+	typedef Ttrack_follower                   TrackFollower;
+	/** node list type */
+	typedef Tnode_list                        NodeList;
+	typedef Train                             VehicleType;
+};
+
+struct CYapfRailDistance : CYapfRailDistanceT<CYapfRailDistance_TypesT<CYapfRailDistance, CFollowTrackRail, CRailDistanceNodeList> > {};
+
+/**
+ * Find the first of the distances whose position is not before the given one.
+ * @param position The position.
+ * @return The index of the distance, or the number of distances when all are before it.
+ */
+uint RailStationDistances::FindPosition(uint32 position) const
+{
+	uint first = 0;
+	uint last = this->distances.Length();
+	while (first < last) {
+		uint middle = (first + last) / 2;
+		if (this->distances[middle].position < position) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	return first;
+}
+
+/**
+ * Get the distance from a position to the station.
+ * @param tile The tile.
+ * @param td The trackdir on the tile.
+ * @return The distance, or a lower bound of it.
+ */
+int RailStationDistances::GetDistance(TileIndex tile, Trackdir td) const
+{
+	uint32 position = GetPosition(tile, td);
+	uint i = this->FindPosition(position);
+	if (i < this->distances.Length() && this->distances[i].position == position) return this->distances[i].distance;
+	return this->radius;
+}
+
+/**
+ * Check whether the search visited a tile.
+ * @param tile The tile.
+ * @return True if the distance of any position on the tile is known.
+ */
+bool RailStationDistances::HasTile(TileIndex tile) const
+{
+	uint i = this->FindPosition(GetPosition(tile, (Trackdir)0));
+	return i < this->distances.Length() && (this->distances[i].position >> 4) == tile;
+}
+
+/**
+ * Check whether a change of a tile can change the distances. The search only
+ * looks at the tiles next to the ones it visits, and at the other end of a
+ * tunnel or bridge, which it visits as well; changes further away can't
+ * change the distances. A search that stopped early did not visit all
+ * positions, so for it any change may matter.
+ * @param tile The changed tile.
+ * @return True if the distances have to be searched again.
+ */
+bool RailStationDistances::IsAffectedBy(TileIndex tile) const
+{
+	if (this->radius != RAIL_DISTANCE_UNREACHABLE || this->HasTile(tile)) return true;
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		if (this->HasTile(TileAddByDiagDir(tile, dir))) return true;
+	}
+	return false;
+}
+
+/**
+ * Maximum number of positions whose distances are cached together, i.e. 16 MiB.
+ * The distances of every station trains are routed to are kept, unless they
+ * don't fit; then the least recently used ones are removed.
+ */
+static const uint RAIL_STATION_DISTANCES_CACHE_POSITIONS = 1 << 21;
+
+static AutoDeleteSmallVector<RailStationDistances *, 16> _rail_station_distances; ///< The cached distances.
+static uint _rail_station_distances_positions; ///< Number of positions in all cached distances.
+static uint32 _rail_station_distances_clock; ///< Counter for the last use of the distances.
+static YapfCacheStats _rail_station_distances_stats; ///< Counters of the cache of distances; the segments are the cached stations.
+
+/**
+ * Remove cached distances.
+ * @param index The index of the distances in the cache.
+ */
+static void RemoveRailStationDistances(uint index)
+{
+	_rail_station_distances_positions -= _rail_station_distances[index]->distances.Length();
+	delete _rail_station_distances[index];
+	_rail_station_distances.Erase(_rail_station_distances.Get(index));
+}
+
+/**
+ * Get the distances to a rail station or waypoint. They are searched when
+ * they are not cached yet; the cached distances are removed whenever the
+ * track near them changes.
+ * @param station The station.
+ * @param owner The owner of the train.
+ * @param railtypes The rail types the train can drive on.
+ * @return The distances.
+ */
+const RailStationDistances *YapfGetRailStationDistances(StationID station, Owner owner, RailTypes railtypes)
+{
+	const BaseStation *st = BaseStation::Get(station);
+
+	for (uint i = 0; i < _rail_station_distances.Length(); i++) {
+		RailStationDistances *d = _rail_station_distances[i];
+		if (d->station != station || d->owner != owner || d->railtypes != railtypes) continue;
+
+		/* Tiles of the station that are not next to the visited ones change its area. */
+		if (d->station_area.tile != st->train_station.tile || d->station_area.w != st->train_station.w || d->station_area.h != st->train_station.h) {
+			_rail_station_distances_stats.evictions++;
+			RemoveRailStationDistances(i);
+			break;
+		}
+
+		_rail_station_distances_stats.hits++;
+		d->last_used = ++_rail_station_distances_clock;
+		/* Whether the distances are cached differs between the server and
+		 * clients that joined later, so using them must cost the node
+		 * budget of the tick as much as searching them does. */
+		_pathfinder_stats.searched_nodes += d->nodes;
+		return d;
+	}
+
+	_rail_station_distances_stats.misses++;
+
+	RailStationDistances *d = new RailStationDistances();
+	d->station = station;
+	d->owner = owner;
+	d->railtypes = railtypes;
+	d->station_area = st->train_station;
+	d->last_used = ++_rail_station_distances_clock;
+	CYapfRailDistance::FindDistances(st, *d);
+
+	/* Make room for the new distances by removing the least recently used ones. */
+	_rail_station_distances_positions += d->distances.Length();
+	while (_rail_station_distances_positions > RAIL_STATION_DISTANCES_CACHE_POSITIONS && _rail_station_distances.Length() != 0) {
+		uint oldest = 0;
+		for (uint i = 1; i < _rail_station_distances.Length(); i++) {
+			if (_rail_station_distances[i]->last_used < _rail_station_distances[oldest]->last_used) oldest = i;
+		}
+		_rail_station_distances_stats.evictions++;
+		RemoveRailStationDistances(oldest);
+	}
+
+	*_rail_station_distances.Append() = d;
+	return d;
+}
+
+/**
+ * Forget the cached distances to rail stations that a change of a tile may affect.
+ * @param tile The changed tile.
+ */
+void YapfInvalidateRailStationDistances(TileIndex tile)
+{
+	for (uint i = 0; i < _rail_station_distances.Length(); /* nothing */) {
+		if (_rail_station_distances[i]->IsAffectedBy(tile)) {
+			_rail_station_distances_stats.evictions++;
+			RemoveRailStationDistances(i);
+		} else {
+			i++;
+		}
+	}
+}
+
+/** Forget all cached distances to rail stations, e.g. because the owners of the track changed. */
+void YapfFlushRailStationDistances()
+{
+	if (_rail_station_distances.Length() == 0) return;
+
+	_rail_station_distances.Clear();
+	_rail_station_distances_positions = 0;
+	_rail_station_distances_stats.flushes++;
+}
+
+/**
+ * Get the counters of the cache of distances to rail stations.
+ * @param[out] stats The counters.
+ */
+void YapfGetRailStationDistancesStats(YapfCacheStats *stats)
+{
+	*stats = _rail_station_distances_stats;
+	stats->segments = _rail_station_distances.Length();
+}
+
+/** Reset the counters of the cache of distances to rail stations. */
+void YapfResetRailStationDistancesStats()
+{
+	MemSetT(&_rail_station_distances_stats, 0);
+}
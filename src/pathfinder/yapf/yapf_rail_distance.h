@@ -0,0 +1,72 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_rail_distance.h Distances along the track to rail stations, found by searching backwards from the station. */
+
+#ifndef YAPF_RAIL_DISTANCE_H
+#define YAPF_RAIL_DISTANCE_H
+
+#include "../../station_type.h"
+#include "../../company_type.h"
+#include "../../rail_type.h"
+#include "../../track_type.h"
+#include "../../tilearea_type.h"
+#include "../../core/smallvec_type.hpp"
+
+/** Maximum number of positions the search backwards from a station visits. */
+static const uint RAIL_DISTANCE_MAX_NODES = 1 << 15;
+
+/** Distance of the positions from which the station can't be reached; larger than any real distance. */
+static const int RAIL_DISTANCE_UNREACHABLE = 1 << 28;
+
+/** Distance from a position, i.e. a tile and trackdir, to a station. */
+struct RailStationDistance {
+	uint32 position; ///< The position, see #RailStationDistances::GetPosition.
+	int distance;    ///< The distance.
+};
+
+/**
+ * The lower bounds of the cost of driving from positions on the track to a
+ * rail station. The bound of a position is the sum of the lengths of the
+ * tiles after it, along the shortest route to the station; the cost of
+ * following that route includes at least those lengths. Whether the track
+ * can be followed depends on the owner and the rail types of the train.
+ */
+struct RailStationDistances {
+	StationID station;     ///< The station (or waypoint) the distances are to.
+	Owner owner;           ///< The owner of the track that is followed.
+	RailTypes railtypes;   ///< The rail types that are followed.
+	TileArea station_area; ///< The area of the rail tiles of the station when the distances were searched.
+	uint32 last_used;      ///< When the distances were last asked for, to evict the least recently used ones.
+	int radius;            ///< Lower bound for positions that are not in the list, or #RAIL_DISTANCE_UNREACHABLE when the search visited every position that can reach the station.
+	uint nodes;            ///< Number of nodes the search expanded; charged again whenever the cached distances are used.
+	SmallVector<RailStationDistance, 256> distances; ///< The distances of the visited positions, sorted by position.
+
+	/**
+	 * Get the identifier of a position in the list of distances.
+	 * @param tile The tile.
+	 * @param td The trackdir on the tile.
+	 * @return The position.
+	 */
+	static inline uint32 GetPosition(TileIndex tile, Trackdir td)
+	{
+		return tile << 4 | td;
+	}
+
+	int GetDistance(TileIndex tile, Trackdir td) const;
+	bool HasTile(TileIndex tile) const;
+	bool IsAffectedBy(TileIndex tile) const;
+
+private:
+	uint FindPosition(uint32 position) const;
+};
+
+const RailStationDistances *YapfGetRailStationDistances(StationID station, Owner owner, RailTypes railtypes);
+
+#endif /* YAPF_RAIL_DISTANCE_H */
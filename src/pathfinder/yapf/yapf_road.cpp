@@ -11,11 +11,207 @@
 
 #include "../../stdafx.h"
 #include "yapf.hpp"
+#include "yapf_cache.h"
 #include "yapf_node_road.hpp"
 #include "../../roadstop_base.h"
 
 #include "../../safeguards.h"
 
+/**
+ * Get the tile the path of a road vehicle leads to; for stations it is the
+ * station tile closest to the vehicle.
+ * @param v The vehicle.
+ * @return The tile.
+ */
+static TileIndex GetRoadVehicleDestinationTile(const RoadVehicle *v)
+{
+	if (!v->current_order.IsType(OT_GOTO_STATION)) return v->dest_tile;
+	return CalcClosestStationTile(v->current_order.GetDestination(), v->tile, v->IsBus() ? STATION_BUS : STATION_TRUCK);
+}
+
+/** An occupancy value of a road stop that the cost of a path depended on. */
+struct CYapfRoadStopObservation {
+	RoadStopID    m_stop;  ///< the road stop
+	DiagDirection m_dir;   ///< the entry of a drive through road stop, or INVALID_DIAGDIR for the bays of a bay road stop
+	int           m_value; ///< occupied length of the entry, or number of occupied bays
+
+	/**
+	 * Get the occupancy of a road stop as used by the cost calculation.
+	 * @param rs The road stop.
+	 * @param dir The entry of a drive through road stop, or INVALID_DIAGDIR for the bays of a bay road stop.
+	 * @return The occupancy.
+	 */
+	static inline int GetValue(const RoadStop *rs, DiagDirection dir)
+	{
+		if (dir == INVALID_DIAGDIR) return !rs->IsFreeBay(0) + !rs->IsFreeBay(1);
+		return rs->GetEntry(dir)->GetOccupied();
+	}
+
+	/** Check whether the road stop is still occupied like it was observed. */
+	inline bool IsCurrent() const
+	{
+		const RoadStop *rs = RoadStop::GetIfValid(m_stop);
+		return rs != NULL && GetValue(rs, m_dir) == m_value;
+	}
+};
+
+/** Maximum number of road stop occupancy values a cached route can depend on. */
+static const uint YAPF_ROAD_ROUTE_OBSERVATIONS = 8;
+
+typedef SmallVector<CYapfRoadStopObservation, YAPF_ROAD_ROUTE_OBSERVATIONS> CYapfRoadStopObservations;
+
+/**
+ * Key of a cached next hop of a road vehicle; everything the path found by
+ * YAPF depends on, apart from the road layout, the road stop occupancy and
+ * the settings.
+ */
+struct CYapfRoadRouteKey {
+	TileIndex     m_tile;         ///< the tile the vehicle is about to enter
+	TileIndex     m_dest_tile;    ///< the tile the search heads for
+	StationID     m_dest_station; ///< the station the vehicle goes to, or INVALID_STATION
+	uint16        m_max_speed;    ///< maximum speed of the vehicle, for the speed limit penalties
+	DiagDirection m_enterdir;     ///< the direction the vehicle enters the tile from
+	Owner         m_owner;        ///< owner of the vehicle, as only own depots can be entered
+	RoadTypes     m_roadtypes;    ///< the road types the vehicle can drive on
+	bool          m_bus;          ///< whether the vehicle uses bus stops rather than truck stops
+	bool          m_non_artic;    ///< whether the vehicle can use bay road stops
+
+	inline void Set(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir)
+	{
+		m_tile = tile;
+		m_dest_tile = GetRoadVehicleDestinationTile(v);
+		m_dest_station = v->current_order.IsType(OT_GOTO_STATION) ? (StationID)v->current_order.GetDestination() : INVALID_STATION;
+		m_max_speed = v->GetDisplayMaxSpeed();
+		m_enterdir = enterdir;
+		m_owner = v->owner;
+		m_roadtypes = v->compatible_roadtypes;
+		m_bus = v->IsBus();
+		m_non_artic = !v->HasArticulatedPart();
+	}
+
+	inline uint32 CalcHash() const
+	{
+		return ((m_tile << 2 | m_enterdir) * 0x9E3779B1U) ^ ((m_dest_tile ^ m_dest_station << 16) * 0x85EBCA6BU);
+	}
+
+	inline bool operator==(const CYapfRoadRouteKey &other) const
+	{
+		return m_tile == other.m_tile && m_dest_tile == other.m_dest_tile && m_dest_station == other.m_dest_station &&
+				m_max_speed == other.m_max_speed && m_enterdir == other.m_enterdir && m_owner == other.m_owner &&
+				m_roadtypes == other.m_roadtypes && m_bus == other.m_bus && m_non_artic == other.m_non_artic;
+	}
+};
+
+/**
+ * Cache of the next hops of road vehicles. Many vehicles on the same route
+ *  ask the path finder the same question at every junction, and as long as
+ *  the road layout and the occupancy of the road stops the path finder looked
+ *  at did not change, the answer is the same. The cache only ever returns
+ *  what the path finder would return, as clients that joined later would
+ *  desync otherwise; so it is flushed on every road layout change, and an
+ *  entry is only used when all road stops it looked at are occupied alike.
+ *  It is direct mapped; a new entry replaces the one in its slot.
+ */
+class CYapfRoadRouteCache {
+protected:
+	/** A cached next hop. */
+	struct Entry {
+		CYapfRoadRouteKey m_key;          ///< the question
+		uint32            m_generation;   ///< generation of the cache the entry was made in; entries of other ones are empty
+		Trackdir          m_trackdir;     ///< the trackdir to take on the tile
+		bool              m_path_found;   ///< whether the path finder found a path to the destination
+		uint32            m_nodes;        ///< number of nodes the search expanded
+		uint8             m_num_observations; ///< number of valid items of m_observations
+		CYapfRoadStopObservation m_observations[YAPF_ROAD_ROUTE_OBSERVATIONS]; ///< the road stop occupancy the answer depends on
+	};
+
+	static const uint C_SIZE_BITS = 12; ///< number of bits of the slot index
+
+	Entry  m_entries[1 << C_SIZE_BITS]; ///< the slots
+	uint32 m_generation;                ///< current generation; flushing the cache starts a new one
+
+public:
+	uint64 m_hits;    ///< number of questions answered from the cache
+	uint64 m_misses;  ///< number of questions the path finder had to answer
+	uint64 m_stale;   ///< number of misses due to a changed road stop occupancy
+	uint64 m_flushes; ///< number of times the cache was flushed
+
+	CYapfRoadRouteCache() : m_generation(1), m_hits(0), m_misses(0), m_stale(0), m_flushes(0) {}
+
+	/**
+	 * Look up the next hop for a question.
+	 * @param key The question.
+	 * @param[out] trackdir The trackdir to take.
+	 * @param[out] path_found Whether the path finder found a path.
+	 * @param[out] nodes Number of nodes the search for the answer expanded.
+	 * @return True if the answer was cached.
+	 */
+	bool Find(const CYapfRoadRouteKey &key, Trackdir &trackdir, bool &path_found, uint &nodes)
+	{
+		const Entry &e = m_entries[key.CalcHash() >> (32 - C_SIZE_BITS)];
+		if (e.m_generation != m_generation || !(e.m_key == key)) {
+			m_misses++;
+			return false;
+		}
+		for (uint i = 0; i < e.m_num_observations; i++) {
+			if (!e.m_observations[i].IsCurrent()) {
+				m_misses++;
+				m_stale++;
+				return false;
+			}
+		}
+		m_hits++;
+		trackdir = e.m_trackdir;
+		path_found = e.m_path_found;
+		nodes = e.m_nodes;
+		return true;
+	}
+
+	/**
+	 * Remember the next hop for a question.
+	 * @param key The question.
+	 * @param trackdir The trackdir to take.
+	 * @param path_found Whether the path finder found a path.
+	 * @param nodes Number of nodes the search for the answer expanded.
+	 * @param observations The road stop occupancy the answer depends on.
+	 */
+	void Insert(const CYapfRoadRouteKey &key, Trackdir trackdir, bool path_found, uint nodes, const CYapfRoadStopObservations &observations)
+	{
+		assert(observations.Length() <= YAPF_ROAD_ROUTE_OBSERVATIONS);
+		Entry &e = m_entries[key.CalcHash() >> (32 - C_SIZE_BITS)];
+		e.m_key = key;
+		e.m_generation = m_generation;
+		e.m_trackdir = trackdir;
+		e.m_path_found = path_found;
+		e.m_nodes = nodes;
+		e.m_num_observations = observations.Length();
+		MemCpyT(e.m_observations, observations.Begin(), observations.Length());
+	}
+
+	/** Forget all cached next hops. */
+	void Flush()
+	{
+		m_flushes++;
+		if (++m_generation != 0) return;
+
+		/* Entries of the first generation could be mistaken for current ones after a wrap around. */
+		for (uint i = 0; i < lengthof(m_entries); i++) m_entries[i].m_generation = 0;
+		m_generation = 1;
+	}
+
+	/** Get the number of cached next hops. */
+	uint Count() const
+	{
+		uint count = 0;
+		for (uint i = 0; i < lengthof(m_entries); i++) {
+			if (m_entries[i].m_generation == m_generation) count++;
+		}
+		return count;
+	}
+};
+
+/** The next hop cache of all road vehicles. */
+static CYapfRoadRouteCache _road_route_cache;
 
 template <class Types>
 class CYapfCostRoadT
@@ -25,14 +221,63 @@ public:
 	typedef typename Types::TrackFollower TrackFollower; ///< track follower helper
 	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
 	typedef typename Node::Key Key;    ///< key to hash tables
+	typedef typename Node::CachedData CachedData;
 
 protected:
+	bool m_disable_cache;                      ///< don't use the global segment cost cache
+	SmallVector<TileIndex, 64> m_segment_tiles; ///< tiles of the segment whose cost is being calculated
+	CYapfRoadStopObservations m_stop_observations; ///< occupancy of the road stops the costs depended on
+	bool m_too_many_observations;              ///< whether the costs depended on more road stops than m_stop_observations can hold
+
+	CYapfCostRoadT() : m_disable_cache(false), m_too_many_observations(false) {}
+
 	/** to access inherited path finder */
 	Tpf& Yapf()
 	{
 		return *static_cast<Tpf *>(this);
 	}
 
+	/**
+	 * Remember that a cost depended on the occupancy of a road stop.
+	 * @param rs The road stop.
+	 * @param dir The entry of a drive through road stop, or INVALID_DIAGDIR for the bays of a bay road stop.
+	 * @return The occupancy.
+	 */
+	inline int ObserveRoadStop(const RoadStop *rs, DiagDirection dir)
+	{
+		int value = CYapfRoadStopObservation::GetValue(rs, dir);
+		for (const CYapfRoadStopObservation *o = m_stop_observations.Begin(); o != m_stop_observations.End(); o++) {
+			if (o->m_stop == rs->index && o->m_dir == dir) return value;
+		}
+		if (m_stop_observations.Length() == YAPF_ROAD_ROUTE_OBSERVATIONS) {
+			m_too_many_observations = true;
+			return value;
+		}
+		CYapfRoadStopObservation *o = m_stop_observations.Append();
+		o->m_stop = rs->index;
+		o->m_dir = dir;
+		o->m_value = value;
+		return value;
+	}
+
+	/**
+	 * Check whether the cost of a tile or the end of a segment at the tile
+	 * depends on more than the road layout, i.e. on the vehicle, its
+	 * destination or the vehicles in a road stop. Segments with such tiles
+	 * are not cached.
+	 * @param tile The tile.
+	 * @return True if segments with the tile can't be cached.
+	 */
+	static inline bool IsVolatileTile(TileIndex tile)
+	{
+		switch (GetTileType(tile)) {
+			case MP_STATION:      return true;              // road stop occupancy; possible destination
+			case MP_ROAD:         return IsRoadDepot(tile); // possible destination
+			case MP_TUNNELBRIDGE: return IsBridge(tile);    // speed limit, the penalty depends on the vehicle
+			default:              return false;
+		}
+	}
+
 	int SlopeCost(TileIndex tile, TileIndex next_tile, Trackdir trackdir)
 	{
 		/* height of the center of the current tile */
@@ -77,11 +322,11 @@ protected:
 							/* When we're the first road stop in a 'queue' of them we increase
 							 * cost based on the fill percentage of the whole queue. */
 							const RoadStop::Entry *entry = rs->GetEntry(dir);
-							cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
+							cost += ObserveRoadStop(rs, dir) * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
 						}
 					} else {
 						/* Increase cost for filled road stops */
-						cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
+						cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * ObserveRoadStop(rs, INVALID_DIAGDIR) / 2;
 					}
 					break;
 				}
@@ -104,12 +349,30 @@ public:
 	 */
 	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
 	{
+		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
+
+		/* Do we already have a cached segment? */
+		CachedData &segment = *n.m_segment;
+		if (segment.m_cost >= 0) {
+			if (segment.m_is_loop) return false;
+			n.m_segment_last_tile = segment.m_last_tile;
+			n.m_segment_last_td = segment.m_last_td;
+			n.m_cost = parent_cost + segment.m_cost;
+			return true;
+		}
+
 		int segment_cost = 0;
 		uint tiles = 0;
+		/* whether the segment only depends on the road layout */
+		bool cacheable = true;
+		m_segment_tiles.Clear();
 		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
 		TileIndex tile = n.m_key.m_tile;
 		Trackdir trackdir = n.m_key.m_td;
 		for (;;) {
+			*m_segment_tiles.Append() = tile;
+			if (cacheable && IsVolatileTile(tile)) cacheable = false;
+
 			/* base tile cost depending on distance between edges */
 			segment_cost += Yapf().OneTileCost(tile, trackdir);
 
@@ -123,6 +386,15 @@ public:
 				break;
 			}
 
+			/* Only the owner of a depot can enter it; other road vehicles reverse in
+			 * front of it, and Follow() does not tell which one happened. The segment
+			 * cache is shared by all companies, so such a segment is not cached. */
+			if (cacheable) {
+				DiagDirection exitdir = TrackdirToExitdir(trackdir);
+				TileIndex ahead = TileAddByDiagDir(tile, exitdir);
+				if (IsRoadDepotTile(ahead) && GetRoadDepotDirection(ahead) == ReverseDiagDir(exitdir)) cacheable = false;
+			}
+
 			/* if there are no reachable trackdirs on new tile, we have end of road */
 			TrackFollower F(Yapf().GetVehicle());
 			if (!F.Follow(tile, trackdir)) break;
@@ -133,7 +405,14 @@ public:
 			Trackdir new_td = (Trackdir)FindFirstBit2x64(F.m_new_td_bits);
 
 			/* stop if RV is on simple loop with no junctions */
-			if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) return false;
+			if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) {
+				if (cacheable) {
+					segment.m_cost = 0;
+					segment.m_is_loop = true;
+					AddSegmentTiles(n);
+				}
+				return false;
+			}
 
 			/* if we skipped some tunnel tiles, add their cost */
 			segment_cost += F.m_tiles_skipped * YAPF_TILE_LENGTH;
@@ -159,11 +438,51 @@ public:
 		n.m_segment_last_tile = tile;
 		n.m_segment_last_td = trackdir;
 
+		/* and into the segment, so it can be reused the next time */
+		if (cacheable && !IsVolatileTile(tile)) {
+			segment.m_last_tile = tile;
+			segment.m_last_td = trackdir;
+			segment.m_cost = segment_cost;
+			if (*(m_segment_tiles.End() - 1) != tile) *m_segment_tiles.Append() = tile;
+			AddSegmentTiles(n);
+		}
+
 		/* save also tile cost */
-		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
 		n.m_cost = parent_cost + segment_cost;
 		return true;
 	}
+
+	/** Tell the segment cost cache which tiles the segment of the node passes. */
+	inline void AddSegmentTiles(Node &n)
+	{
+		for (const TileIndex *tile = m_segment_tiles.Begin(); tile != m_segment_tiles.End(); tile++) {
+			Yapf().PfNodeCacheAddTile(n, *tile);
+		}
+	}
+
+	inline bool CanUseGlobalCache(Node &n) const
+	{
+		return !m_disable_cache;
+	}
+
+	inline void ConnectNodeToCachedData(Node &n, CachedData &ci)
+	{
+		n.m_segment = &ci;
+	}
+
+	void DisableCache(bool disable)
+	{
+		m_disable_cache = disable;
+	}
+
+	/**
+	 * Get the occupancy of the road stops the costs depended on.
+	 * @return The occupancy, or NULL if the costs depended on too many road stops.
+	 */
+	inline const CYapfRoadStopObservations *GetRoadStopObservations() const
+	{
+		return m_too_many_observations ? NULL : &m_stop_observations;
+	}
 };
 
 
@@ -228,13 +547,15 @@ public:
 		if (v->current_order.IsType(OT_GOTO_STATION)) {
 			m_dest_station  = v->current_order.GetDestination();
 			m_bus           = v->IsBus();
-			m_destTile      = CalcClosestStationTile(m_dest_station, v->tile, m_bus ? STATION_BUS : STATION_TRUCK);
+			m_destTile      = GetRoadVehicleDestinationTile(v);
 			m_non_artic     = !v->HasArticulatedPart();
 			m_destTrackdirs = INVALID_TRACKDIR_BIT;
 		} else {
 			m_dest_station  = INVALID_STATION;
-			m_destTile      = v->dest_tile;
+			m_destTile      = GetRoadVehicleDestinationTile(v);
 			m_destTrackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_ROAD, v->compatible_roadtypes));
+			/* cached segments don't stop at plain road tiles, so the destination could be inside one */
+			if (!IsTileType(m_destTile, MP_STATION) && !IsRoadDepotTile(m_destTile)) Yapf().DisableCache(true);
 		}
 	}
 
@@ -335,8 +656,32 @@ public:
 
 	static Trackdir stChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found)
 	{
+		/* searches with fewer nodes than usual give different answers */
+		if (IsPathfinderNodeLimited()) {
+			Tpf pf;
+			return pf.ChooseRoadTrack(v, tile, enterdir, path_found);
+		}
+
+		/* vehicles on the same route keep asking the same question, so try the cache first */
+		CYapfRoadRouteKey key;
+		key.Set(v, tile, enterdir);
+		Trackdir next_trackdir;
+		uint nodes;
+		if (_road_route_cache.Find(key, next_trackdir, path_found, nodes)) {
+			/* the node budget must not depend on what is cached */
+			_pathfinder_stats.cache_hits++;
+			_pathfinder_stats.searched_nodes += nodes;
+			return next_trackdir;
+		}
+
+		uint64 start_nodes = _pathfinder_stats.searched_nodes;
 		Tpf pf;
-		return pf.ChooseRoadTrack(v, tile, enterdir, path_found);
+		next_trackdir = pf.ChooseRoadTrack(v, tile, enterdir, path_found);
+		nodes = (uint)(_pathfinder_stats.searched_nodes - start_nodes);
+
+		const CYapfRoadStopObservations *observations = pf.GetRoadStopObservations();
+		if (observations != NULL) _road_route_cache.Insert(key, next_trackdir, path_found, nodes, *observations);
+		return next_trackdir;
 	}
 
 	inline Trackdir ChooseRoadTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, bool &path_found)
@@ -474,26 +819,32 @@ struct CYapfRoad_TypesT
 	typedef CYapfFollowRoadT<Types>           PfFollow;
 	typedef CYapfOriginTileT<Types>           PfOrigin;
 	typedef Tdestination<Types>               PfDestination;
-	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;
+	typedef CYapfSegmentCostCacheGlobalT<Types> PfCache;
 	typedef CYapfCostRoadT<Types>             PfCost;
 };
 
+/* Road vehicles and trams follow different roads, so they get their own path finders and with that their own segment cost caches. */
 struct CYapfRoad1         : CYapfT<CYapfRoad_TypesT<CYapfRoad1        , CRoadNodeListTrackDir, CYapfDestinationTileRoadT    > > {};
 struct CYapfRoad2         : CYapfT<CYapfRoad_TypesT<CYapfRoad2        , CRoadNodeListExitDir , CYapfDestinationTileRoadT    > > {};
+struct CYapfTram1         : CYapfT<CYapfRoad_TypesT<CYapfTram1        , CRoadNodeListTrackDir, CYapfDestinationTileRoadT    > > {};
+struct CYapfTram2         : CYapfT<CYapfRoad_TypesT<CYapfTram2        , CRoadNodeListExitDir , CYapfDestinationTileRoadT    > > {};
 
 struct CYapfRoadAnyDepot1 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot1, CRoadNodeListTrackDir, CYapfDestinationAnyDepotRoadT> > {};
 struct CYapfRoadAnyDepot2 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot2, CRoadNodeListExitDir , CYapfDestinationAnyDepotRoadT> > {};
+struct CYapfTramAnyDepot1 : CYapfT<CYapfRoad_TypesT<CYapfTramAnyDepot1, CRoadNodeListTrackDir, CYapfDestinationAnyDepotRoadT> > {};
+struct CYapfTramAnyDepot2 : CYapfT<CYapfRoad_TypesT<CYapfTramAnyDepot2, CRoadNodeListExitDir , CYapfDestinationAnyDepotRoadT> > {};
 
 
 Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, TrackdirBits trackdirs, bool &path_found)
 {
 	/* default is YAPF type 2 */
 	typedef Trackdir (*PfnChooseRoadTrack)(const RoadVehicle*, TileIndex, DiagDirection, bool &path_found);
-	PfnChooseRoadTrack pfnChooseRoadTrack = &CYapfRoad2::stChooseRoadTrack; // default: ExitDir, allow 90-deg
+	bool tram = HasBit(v->compatible_roadtypes, ROADTYPE_TRAM);
+	PfnChooseRoadTrack pfnChooseRoadTrack = tram ? &CYapfTram2::stChooseRoadTrack : &CYapfRoad2::stChooseRoadTrack; // default: ExitDir, allow 90-deg
 
 	/* check if non-default YAPF type should be used */
 	if (_settings_game.pf.yapf.disable_node_optimization) {
-		pfnChooseRoadTrack = &CYapfRoad1::stChooseRoadTrack; // Trackdir, allow 90-deg
+		pfnChooseRoadTrack = tram ? &CYapfTram1::stChooseRoadTrack : &CYapfRoad1::stChooseRoadTrack; // Trackdir, allow 90-deg
 	}
 
 	Trackdir td_ret = pfnChooseRoadTrack(v, tile, enterdir, path_found);
@@ -510,12 +861,49 @@ FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_dist
 
 	/* default is YAPF type 2 */
 	typedef FindDepotData (*PfnFindNearestDepot)(const RoadVehicle*, TileIndex, Trackdir, int);
-	PfnFindNearestDepot pfnFindNearestDepot = &CYapfRoadAnyDepot2::stFindNearestDepot;
+	bool tram = HasBit(v->compatible_roadtypes, ROADTYPE_TRAM);
+	PfnFindNearestDepot pfnFindNearestDepot = tram ? &CYapfTramAnyDepot2::stFindNearestDepot : &CYapfRoadAnyDepot2::stFindNearestDepot;
 
 	/* check if non-default YAPF type should be used */
 	if (_settings_game.pf.yapf.disable_node_optimization) {
-		pfnFindNearestDepot = &CYapfRoadAnyDepot1::stFindNearestDepot; // Trackdir, allow 90-deg
+		pfnFindNearestDepot = tram ? &CYapfTramAnyDepot1::stFindNearestDepot : &CYapfRoadAnyDepot1::stFindNearestDepot; // Trackdir, allow 90-deg
 	}
 
 	return pfnFindNearestDepot(v, tile, trackdir, max_distance);
 }
+
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	CSegmentCostCacheBase::NotifyLayoutChange(TRANSPORT_ROAD, tile);
+	_road_route_cache.Flush();
+}
+
+/** Forget the cached next hops of road vehicles, e.g. when something they depend on changed. */
+void YapfFlushRoadRouteCache()
+{
+	_road_route_cache.Flush();
+}
+
+/**
+ * Get the counters of the next hop cache of road vehicles.
+ * @param[out] stats The counters; evictions are the entries that could not
+ *                   be used as a road stop was occupied differently, and
+ *                   segments is the number of cached next hops.
+ */
+void YapfGetRoadRouteCacheStats(YapfCacheStats *stats)
+{
+	stats->hits = _road_route_cache.m_hits;
+	stats->misses = _road_route_cache.m_misses;
+	stats->evictions = _road_route_cache.m_stale;
+	stats->flushes = _road_route_cache.m_flushes;
+	stats->segments = _road_route_cache.Count();
+}
+
+/** Reset the counters of the next hop cache of road vehicles. */
+void YapfResetRoadRouteCacheStats()
+{
+	_road_route_cache.m_hits = 0;
+	_road_route_cache.m_misses = 0;
+	_road_route_cache.m_stale = 0;
+	_road_route_cache.m_flushes = 0;
+}
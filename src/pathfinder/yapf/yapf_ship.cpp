@@ -14,6 +14,7 @@
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "yapf_ship_regions.h"
 
 #include "../../safeguards.h"
 
@@ -28,13 +29,42 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	const WaterRegionPatchPath *m_water_region_corridor; ///< Water region patches the search is limited to, or NULL when it is not limited.
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
 		return *static_cast<Tpf *>(this);
 	}
 
+	/**
+	 * Check whether the search may enter a tile.
+	 * @param tile The tile.
+	 * @return True if there is no corridor or the tile is part of it.
+	 */
+	inline bool IsInWaterRegionCorridor(TileIndex tile) const
+	{
+		if (m_water_region_corridor == NULL) return true;
+
+		WaterRegionPatchDesc patch = GetWaterRegionPatchInfo(tile);
+		for (const WaterRegionPatchDesc *p = m_water_region_corridor->Begin(); p != m_water_region_corridor->End(); p++) {
+			if (*p == patch) return true;
+		}
+		return false;
+	}
+
 public:
+	CYapfFollowShipT() : m_water_region_corridor(NULL) {}
+
+	/**
+	 * Limit the search to some water region patches.
+	 * @param corridor The patches; they must outlive the search.
+	 */
+	inline void SetWaterRegionCorridor(const WaterRegionPatchPath *corridor)
+	{
+		m_water_region_corridor = corridor;
+	}
+
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
 	 *  reachable trackdir on the new tile creates new node, initializes it
@@ -43,7 +73,7 @@ public:
 	inline void PfFollowNode(Node &old_node)
 	{
 		TrackFollower F(Yapf().GetVehicle());
-		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td) && IsInWaterRegionCorridor(F.m_new_tile)) {
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -75,6 +105,31 @@ public:
 
 		/* convert origin trackdir to TrackdirBits */
 		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
+
+		/* Search the path through the first few water regions along the
+		 * route over the regions only, so the search does not spread over a
+		 * whole ocean. Only if that fails, search without limits. */
+		WaterRegionPatchPath corridor;
+		if (YapfShipFindWaterRegionPath(v, tile, v->dest_tile, WATER_REGION_LOOKAHEAD + 1, corridor)) {
+			Trackdir next_trackdir = FindShipPath(v, tile, src_tile, trackdirs, &corridor, path_found);
+			if (path_found) return next_trackdir;
+		}
+		return FindShipPath(v, tile, src_tile, trackdirs, NULL, path_found);
+	}
+
+	/**
+	 * Find the path of a ship and get its first step.
+	 * @param v The ship.
+	 * @param tile The tile the ship is about to enter.
+	 * @param src_tile The tile the ship is on.
+	 * @param trackdirs The trackdir of the ship.
+	 * @param corridor The water region patches to limit the search to, or NULL for no limit.
+	 *                 If it does not reach the destination, its last patch is searched for instead.
+	 * @param[out] path_found Whether a path has been found.
+	 * @return The trackdir to take on \a tile, or INVALID_TRACKDIR if there is no path.
+	 */
+	static Trackdir FindShipPath(const Ship *v, TileIndex tile, TileIndex src_tile, TrackdirBits trackdirs, const WaterRegionPatchPath *corridor, bool &path_found)
+	{
 		/* get available trackdirs on the destination tile */
 		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
 
@@ -83,6 +138,11 @@ public:
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
 		pf.SetDestination(v->dest_tile, dest_trackdirs);
+		if (corridor != NULL) {
+			pf.SetWaterRegionCorridor(corridor);
+			const WaterRegionPatchDesc &last = (*corridor)[corridor->Length() - 1];
+			if (last != GetWaterRegionPatchInfo(v->dest_tile)) pf.SetIntermediateDestination(last);
+		}
 		/* find best path */
 		path_found = pf.FindPath(v);
 
@@ -141,6 +201,73 @@ public:
 	}
 };
 
+/**
+ * Destination provider of YAPF for ships. It either searches for the
+ *  destination tile, or for a water region patch that is on the way to it.
+ */
+template <class Types>
+class CYapfDestinationShipT : public CYapfDestinationTileT<Types>
+{
+public:
+	typedef CYapfDestinationTileT<Types> Base;    ///< the plain destination tile provider
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	bool                 m_intermediate;     ///< whether a water region patch is searched for instead of the destination tile
+	WaterRegionPatchDesc m_dest_patch;       ///< the water region patch to search for
+	int                  m_box_x1, m_box_y1; ///< north corner of the region of the patch, in half tiles
+	int                  m_box_x2, m_box_y2; ///< south corner of the region of the patch, in half tiles
+
+public:
+	CYapfDestinationShipT() : m_intermediate(false) {}
+
+	/** search for any tile of a water region patch instead of the destination tile */
+	void SetIntermediateDestination(const WaterRegionPatchDesc &patch)
+	{
+		m_intermediate = true;
+		m_dest_patch = patch;
+		m_box_x1 = 2 * (patch.x << WATER_REGION_EDGE_BITS);
+		m_box_y1 = 2 * (patch.y << WATER_REGION_EDGE_BITS);
+		m_box_x2 = m_box_x1 + 2 * (WATER_REGION_EDGE_LENGTH - 1);
+		m_box_y2 = m_box_y1 + 2 * (WATER_REGION_EDGE_LENGTH - 1);
+	}
+
+	/** Called by YAPF to detect if node ends in the desired destination */
+	inline bool PfDetectDestination(Node &n)
+	{
+		if (!m_intermediate) return Base::PfDetectDestination(n);
+		return GetWaterRegionPatchInfo(n.GetTile()) == m_dest_patch;
+	}
+
+	/**
+	 * Called by YAPF to calculate cost estimate. When searching for a water
+	 *  region patch, it is the distance to the nearest tile of its region.
+	 */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		if (!m_intermediate) return Base::PfCalcEstimate(n);
+
+		static const int dg_dir_to_x_offs[] = {-1, 0, 1, 0};
+		static const int dg_dir_to_y_offs[] = {0, 1, 0, -1};
+		if (PfDetectDestination(n)) {
+			n.m_estimate = n.m_cost;
+			return true;
+		}
+
+		TileIndex tile = n.GetTile();
+		DiagDirection exitdir = TrackdirToExitdir(n.GetTrackdir());
+		int x = 2 * TileX(tile) + dg_dir_to_x_offs[(int)exitdir];
+		int y = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
+		int dx = max(0, max(m_box_x1 - x, x - m_box_x2));
+		int dy = max(0, max(m_box_y1 - y, y - m_box_y2));
+		int dmin = min(dx, dy);
+		int dxy = abs(dx - dy);
+		int d = max(0, dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2));
+		n.m_estimate = n.m_cost + d;
+		return true;
+	}
+};
+
 /** Cost Provider module of YAPF for ships */
 template <class Types>
 class CYapfCostShipT
@@ -209,7 +336,7 @@ struct CYapfShip_TypesT
 	typedef CYapfBaseT<Types>                 PfBase;        // base pathfinder class
 	typedef CYapfFollowShipT<Types>           PfFollow;      // node follower
 	typedef CYapfOriginTileT<Types>           PfOrigin;      // origin provider
-	typedef CYapfDestinationTileT<Types>      PfDestination; // destination/distance provider
+	typedef CYapfDestinationShipT<Types>      PfDestination; // destination/distance provider
 	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;       // segment cost cache provider
 	typedef CYapfCostShipT<Types>             PfCost;        // cost provider
 };
@@ -0,0 +1,266 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_ship_regions.cpp Implementation of YAPF for water regions, which is used for finding intermediate ship destinations. */
+
+#include "../../stdafx.h"
+#include "../../ship.h"
+
+#include "yapf.hpp"
+#include "yapf_ship_regions.h"
+
+#include "../../safeguards.h"
+
+/** Yapf Node key for water region patches. */
+struct CYapfRegionPatchNodeKey {
+	WaterRegionPatchDesc m_water_region_patch;
+
+	inline void Set(const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_water_region_patch = water_region_patch;
+	}
+
+	inline int CalcHash() const
+	{
+		return m_water_region_patch.label | GetWaterRegionIndex(m_water_region_patch) << 8;
+	}
+
+	inline bool operator==(const CYapfRegionPatchNodeKey &other) const
+	{
+		return m_water_region_patch == other.m_water_region_patch;
+	}
+};
+
+/** Yapf Node for water region patches. */
+struct CYapfRegionNodeT {
+	typedef CYapfRegionPatchNodeKey Key;
+	typedef CYapfRegionNodeT Node;
+
+	Key         m_key;
+	Node       *m_hash_next;
+	Node       *m_parent;
+	int         m_cost;
+	int         m_estimate;
+
+	inline void Set(Node *parent, const WaterRegionPatchDesc &water_region_patch)
+	{
+		m_key.Set(water_region_patch);
+		m_hash_next = NULL;
+		m_parent = parent;
+		m_cost = 0;
+		m_estimate = 0;
+	}
+
+	inline Node *GetHashNext()
+	{
+		return m_hash_next;
+	}
+
+	inline void SetHashNext(Node *pNext)
+	{
+		m_hash_next = pNext;
+	}
+
+	inline const Key& GetKey() const
+	{
+		return m_key;
+	}
+
+	inline int GetCost() const
+	{
+		return m_cost;
+	}
+
+	inline int GetCostEstimate() const
+	{
+		return m_estimate;
+	}
+
+	inline bool operator<(const Node &other) const
+	{
+		return m_estimate < other.m_estimate;
+	}
+};
+
+/** Default NodeList type for water region patches. */
+typedef CNodeList_HashTableT<CYapfRegionNodeT, 12, 12> CRegionNodeListWater;
+
+/**
+ * Distance in tiles between the centres of the regions of two water region patches.
+ * @param a The first patch.
+ * @param b The second patch.
+ * @return The Manhattan distance.
+ */
+static inline int GetRegionDistance(const WaterRegionPatchDesc &a, const WaterRegionPatchDesc &b)
+{
+	return (Delta(a.x, b.x) + Delta(a.y, b.y)) * WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * YAPF for water region patches. Each node is a patch, and the cost of going
+ * to a neighbouring patch is the distance between the regions. It combines
+ * all YAPF modules, as none of the tile based ones fit.
+ */
+template <class Types>
+class CYapfShipRegionT : public CYapfBaseT<Types>
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+protected:
+	WaterRegionPatchDesc m_origin;      ///< Patch the search starts at.
+	WaterRegionPatchDesc m_destination; ///< Patch the search should reach.
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/**
+	 * Set the patches to search a path between.
+	 * @param origin The patch to start at.
+	 * @param destination The patch to reach.
+	 */
+	void SetOriginAndDestination(const WaterRegionPatchDesc &origin, const WaterRegionPatchDesc &destination)
+	{
+		m_origin = origin;
+		m_destination = destination;
+	}
+
+	/** Called by YAPF to create the origin node. */
+	inline void PfSetStartupNodes()
+	{
+		Node &node = Yapf().CreateNewNode();
+		node.Set(NULL, m_origin);
+		Yapf().AddStartupNode(node);
+	}
+
+	/** Called by YAPF to add the neighbouring patches of a node. */
+	inline void PfFollowNode(Node &old_node)
+	{
+		TrackFollower F(Yapf().GetVehicle());
+		WaterRegionPatchNeighbours neighbours;
+		GetWaterRegionPatchNeighbours(old_node.m_key.m_water_region_patch, neighbours);
+		for (const WaterRegionPatchDesc *n = neighbours.Begin(); n != neighbours.End(); n++) {
+			Node &node = Yapf().CreateNewNode();
+			node.Set(&old_node, *n);
+			Yapf().AddNewNode(node, F);
+		}
+	}
+
+	/** Called by YAPF to calculate the cost from the origin to the given node. */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		n.m_cost = n.m_parent->m_cost + GetRegionDistance(n.m_key.m_water_region_patch, n.m_parent->m_key.m_water_region_patch) * YAPF_TILE_LENGTH;
+		return true;
+	}
+
+	/** Called by YAPF to calculate the cost estimate; the distance to the destination region. */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		n.m_estimate = n.m_cost + GetRegionDistance(n.m_key.m_water_region_patch, m_destination) * YAPF_TILE_LENGTH;
+		return true;
+	}
+
+	/** Called by YAPF to detect if the node is the destination. */
+	inline bool PfDetectDestination(Node &n)
+	{
+		return n.m_key.m_water_region_patch == m_destination;
+	}
+
+	/** There are no costs to cache. */
+	inline bool PfNodeCacheFetch(Node &n)
+	{
+		return false;
+	}
+
+	/** There are no costs to cache. */
+	inline void PfNodeCacheFlush(Node &n)
+	{
+	}
+
+	/** return debug report character to identify the transportation type */
+	inline char TransportTypeChar() const
+	{
+		return '^';
+	}
+
+	/**
+	 * Find the first water region patches along the path of a ship.
+	 * @param v The ship.
+	 * @param start_tile Tile the path starts at.
+	 * @param dest_tile Tile the path should reach.
+	 * @param max_length Maximum number of patches to return.
+	 * @param[out] path The patches along the path, starting with the one of \a start_tile.
+	 * @return Whether a path was found.
+	 */
+	static bool FindWaterRegionPath(const Ship *v, TileIndex start_tile, TileIndex dest_tile, uint max_length, WaterRegionPatchPath &path)
+	{
+		path.Clear();
+
+		WaterRegionPatchDesc origin = GetWaterRegionPatchInfo(start_tile);
+		WaterRegionPatchDesc destination = GetWaterRegionPatchInfo(dest_tile);
+		if (origin.label == INVALID_WATER_REGION_PATCH || destination.label == INVALID_WATER_REGION_PATCH) return false;
+		if (origin == destination) {
+			*path.Append() = origin;
+			return true;
+		}
+
+		Tpf pf;
+		pf.SetOriginAndDestination(origin, destination);
+		if (!pf.FindPath(v)) return false;
+
+		/* Count the patches along the path, to skip the ones beyond the maximum length. */
+		uint length = 0;
+		for (Node *node = pf.GetBestNode(); node != NULL; node = node->m_parent) length++;
+
+		path.Append(min(length, max_length));
+		for (Node *node = pf.GetBestNode(); node != NULL; node = node->m_parent) {
+			if (--length < max_length) path[length] = node->m_key.m_water_region_patch;
+		}
+		return true;
+	}
+};
+
+/** Config struct of YAPF for water regions. */
+template <class Tpf_, class Ttrack_follower, class Tnode_list>
+struct CYapfShipRegion_TypesT
+{
+	/** Types - shortcut for this struct type */
+	typedef CYapfShipRegion_TypesT<Tpf_, Ttrack_follower, Tnode_list> Types;
+
+	/** Tpf - pathfinder type */
+	typedef Tpf_                              Tpf;
+	/** track follower helper class */
+	typedef Ttrack_follower                   TrackFollower;
+	/** node list type */
+	typedef Tnode_list                        NodeList;
+	typedef Ship                              VehicleType;
+};
+
+struct CYapfShipRegion : CYapfShipRegionT<CYapfShipRegion_TypesT<CYapfShipRegion, CFollowTrackWater, CRegionNodeListWater> > {};
+
+/**
+ * Find the first water region patches along the path of a ship. The tile
+ * level path of the ship can then be searched through these patches only.
+ * @param v The ship.
+ * @param start_tile Tile the path starts at.
+ * @param dest_tile Tile the path should reach.
+ * @param max_length Maximum number of patches to return.
+ * @param[out] path The patches along the path, starting with the one of \a start_tile.
+ * @return Whether a path was found.
+ */
+bool YapfShipFindWaterRegionPath(const Ship *v, TileIndex start_tile, TileIndex dest_tile, uint max_length, WaterRegionPatchPath &path)
+{
+	return CYapfShipRegion::FindWaterRegionPath(v, start_tile, dest_tile, max_length, path);
+}
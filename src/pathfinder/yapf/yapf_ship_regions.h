@@ -0,0 +1,26 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_ship_regions.h Implementation of YAPF for water regions, which is used for finding intermediate ship destinations. */
+
+#ifndef YAPF_SHIP_REGIONS_H
+#define YAPF_SHIP_REGIONS_H
+
+#include "../../vehicle_type.h"
+#include "../water_regions.h"
+
+/** Number of water regions beyond the current one that the tile level path of a ship is searched through. */
+static const uint WATER_REGION_LOOKAHEAD = 4;
+
+/** Water region patches along a path, starting with the one of the origin. */
+typedef SmallVector<WaterRegionPatchDesc, WATER_REGION_LOOKAHEAD + 1> WaterRegionPatchPath;
+
+bool YapfShipFindWaterRegionPath(const Ship *v, TileIndex start_tile, TileIndex dest_tile, uint max_length, WaterRegionPatchPath &path);
+
+#endif /* YAPF_SHIP_REGIONS_H */
@@ -19,6 +19,8 @@
 #include "articulated_vehicles.h"
 #include "newgrf_sound.h"
 #include "pathfinder/yapf/yapf.h"
+#include "pathfinder/pf_record.h"
+#include "pathfinder/pf_budget.h"
 #include "strings_func.h"
 #include "tunnelbridge_map.h"
 #include "date_func.h"
@@ -956,12 +958,18 @@ static Trackdir RoadFindPathToDest(RoadVehicle *v, TileIndex tile, DiagDirection
 		return_track(FindFirstBit2x64(trackdirs));
 	}
 
-	switch (_settings_game.pf.pathfinder_for_roadvehs) {
-		case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
-		case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+	{
+		/* Lost vehicles rarely find anything; don't let them take long once the budget of the tick is used up. */
+		NonCriticalPathfinderSearch search(HasBit(v->vehicle_flags, VF_PATHFINDER_LOST), true);
 
-		default: NOT_REACHED();
+		switch (_settings_game.pf.pathfinder_for_roadvehs) {
+			case VPF_NPF:  best_track = NPFRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+			case VPF_YAPF: best_track = YapfRoadVehicleChooseTrack(v, tile, enterdir, trackdirs, path_found); break;
+
+			default: NOT_REACHED();
+		}
 	}
+	RecordPathfinderQuery(v, tile, enterdir, trackdirs, (VehiclePathFinders)_settings_game.pf.pathfinder_for_roadvehs, best_track, path_found);
 	v->HandlePathfindingResult(path_found);
 
 found_best_track:;
@@ -1613,6 +1621,10 @@ static void CheckIfRoadVehNeedsService(RoadVehicle *v)
 		default: NOT_REACHED();
 	}
 
+	/* Servicing can wait a day when the searches of this tick took long already. */
+	if (!HasPathfinderBudget() && (_date + v->index) % PATHFINDER_SERVICE_SEARCH_INTERVAL != 0) return;
+	NonCriticalPathfinderSearch search(true, false);
+
 	FindDepotData rfdd = FindClosestRoadDepot(v, max_penalty);
 	/* Only go to the depot if it is not too far out of our way. */
 	if (rfdd.best_length == UINT_MAX || rfdd.best_length > max_penalty) {
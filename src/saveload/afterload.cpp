@@ -31,6 +31,8 @@
 #include "../roadstop_base.h"
 #include "../tunnelbridge_map.h"
 #include "../pathfinder/yapf/yapf_cache.h"
+#include "../signal_func.h"
+#include "../pathfinder/water_regions.h"
 #include "../elrail_func.h"
 #include "../signs_func.h"
 #include "../aircraft.h"
@@ -43,6 +45,7 @@
 #include "../ai/ai_gui.hpp"
 #include "../town.h"
 #include "../economy_base.h"
+#include "../economy_func.h"
 #include "../animated_tile_func.h"
 #include "../subsidy_base.h"
 #include "../subsidy_func.h"
@@ -285,6 +288,7 @@ static void InitializeWindowsAndCaches()
 	RecomputePrices();
 
 	GroupStatistics::UpdateAfterLoad();
+	RebuildCompanyRatingCaches();
 
 	Station::RecomputeIndustriesNearForAll();
 	RebuildSubsidisedSourceAndDestinationCache();
@@ -1328,6 +1332,7 @@ bool AfterLoadGame()
 	}
 
 	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	InvalidateSignalBlocks(INVALID_TILE);
 
 	if (IsSavegameVersionBefore(34)) {
 		Company *c;
@@ -2983,6 +2988,9 @@ bool AfterLoadGame()
 	AfterLoadCompanyStats();
 	AfterLoadStoryBook();
 
+	/* The loaded map might differ in size from the previous one, so the water regions are made anew. */
+	InitializeWaterRegions();
+
 	GamelogPrintDebug(1);
 
 	InitializeWindowsAndCaches();
@@ -3012,6 +3020,7 @@ void ReloadNewGRFData()
 	AfterLoadVehicles(false);
 	StartupEngines();
 	GroupStatistics::UpdateAfterLoad();
+	RebuildCompanyRatingCaches();
 	/* update station graphics */
 	AfterLoadStations();
 	/* Update company statistics. */
@@ -229,6 +229,8 @@ static void Load_LGRS()
  */
 void AfterLoadLinkGraphs()
 {
+	LinkGraphJob *lgj;
+
 	if (IsSavegameVersionBefore(191)) {
 		LinkGraph *lg;
 		FOR_ALL_LINK_GRAPHS(lg) {
@@ -237,7 +239,6 @@ void AfterLoadLinkGraphs()
 			}
 		}
 
-		LinkGraphJob *lgj;
 		FOR_ALL_LINK_GRAPH_JOBS(lgj) {
 			lg = &(const_cast<LinkGraph &>(lgj->Graph()));
 			for (NodeID node_id = 0; node_id < lg->Size(); ++node_id) {
@@ -246,6 +247,12 @@ void AfterLoadLinkGraphs()
 		}
 	}
 
+	if (IsSavegameVersionBefore(199)) {
+		/* Keep calculating the flows of one source at a time, so the distribution stays the same. */
+		_settings_game.linkgraph.parallel_mcf = false;
+		FOR_ALL_LINK_GRAPH_JOBS(lgj) const_cast<LinkGraphSettings &>(lgj->Settings()).parallel_mcf = false;
+	}
+
 	LinkGraphSchedule::instance.SpawnAll();
 }
 
@@ -551,7 +551,7 @@ void NORETURN SlErrorCorrupt(const char *msg);
 
 bool SaveloadCrashWithMissingNewGRFs();
 
-extern char _savegame_format[8];
+extern char _savegame_format[16];
 extern bool _do_autosave;
 
 #endif /* SAVELOAD_H */
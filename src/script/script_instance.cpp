@@ -678,6 +678,11 @@ SQInteger ScriptInstance::GetOpsTillSuspend()
 	return this->engine->GetOpsTillSuspend();
 }
 
+uint32 ScriptInstance::GetExecutedOps()
+{
+	return this->engine->GetExecutedOps();
+}
+
 void ScriptInstance::DoCommandCallback(const CommandCost &result, TileIndex tile, uint32 p1, uint32 p2)
 {
 	ScriptObject::ActiveInstance active(this);
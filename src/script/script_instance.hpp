@@ -176,6 +176,13 @@ public:
 	 */
 	SQInteger GetOpsTillSuspend();
 
+	/**
+	 * Get the number of operations the script executed since it started.
+	 * The value wraps around, so only use it to calculate a difference.
+	 * @return The number of operations.
+	 */
+	uint32 GetExecutedOps();
+
 	/**
 	 * DoCommand callback function for all commands executed by scripts.
 	 * @param result The result of the command.
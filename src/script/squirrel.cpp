@@ -200,6 +200,7 @@ bool Squirrel::Resume(int suspend)
 
 	this->crashed = !sq_resumecatch(this->vm, suspend);
 	this->overdrawn_ops = -this->vm->_ops_till_suspend;
+	if (suspend > 0) this->executed_ops += suspend + this->overdrawn_ops;
 	return this->vm->_suspended != 0;
 }
 
@@ -340,6 +341,7 @@ void Squirrel::Initialize()
 	this->print_func = NULL;
 	this->crashed = false;
 	this->overdrawn_ops = 0;
+	this->executed_ops = 0;
 	this->vm = sq_open(1024);
 
 	/* Handle compile-errors ourself, so we can display it nicely */
@@ -29,6 +29,7 @@ private:
 	SQPrintFunc *print_func; ///< Points to either NULL, or a custom print handler
 	bool crashed;            ///< True if the squirrel script made an error.
 	int overdrawn_ops;       ///< The amount of operations we have overdrawn.
+	uint32 executed_ops;     ///< The amount of operations executed since the start; may wrap around.
 	const char *APIName;     ///< Name of the API used for this squirrel.
 
 	/**
@@ -268,6 +269,12 @@ public:
 	 */
 	SQInteger GetOpsTillSuspend();
 
+	/**
+	 * How many operations were executed since the start? The value wraps
+	 *  around, so only use it to calculate a difference.
+	 */
+	uint32 GetExecutedOps() const { return this->executed_ops; }
+
 	/**
 	 * Completely reset the engine; start from scratch.
 	 */
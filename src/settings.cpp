@@ -51,6 +51,7 @@
 #include "sound/sound_driver.hpp"
 #include "music/music_driver.hpp"
 #include "blitter/factory.hpp"
+#include "thread/worker_pool.h"
 #include "base_media_base.h"
 #include "gamelog.h"
 #include "settings_func.h"
@@ -67,6 +68,7 @@
 
 #include "void_map.h"
 #include "station_base.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 #include "table/settings.h"
@@ -1866,6 +1868,9 @@ CommandCost CmdChangeSetting(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			GamelogStopAction();
 		}
 
+		/* The routes of road vehicles depend on many settings. */
+		YapfFlushRoadRouteCache();
+
 		SetWindowClassesDirty(WC_GAME_OPTIONS);
 	}
 
@@ -30,6 +30,8 @@
 #include "ai/ai.hpp"
 #include "game/game.hpp"
 #include "pathfinder/opf/opf_ship.h"
+#include "pathfinder/pf_record.h"
+#include "pathfinder/pf_budget.h"
 #include "engine_base.h"
 #include "company_base.h"
 #include "tunnelbridge_map.h"
@@ -440,6 +442,9 @@ static Track ChooseShipTrack(Ship *v, TileIndex tile, DiagDirection enterdir, Tr
 {
 	assert(IsValidDiagDirection(enterdir));
 
+	/* Lost ships rarely find anything; don't let them take long once the budget of the tick is used up. */
+	NonCriticalPathfinderSearch search(HasBit(v->vehicle_flags, VF_PATHFINDER_LOST), true);
+
 	bool path_found = true;
 	Track track;
 	switch (_settings_game.pf.pathfinder_for_ships) {
@@ -449,6 +454,7 @@ static Track ChooseShipTrack(Ship *v, TileIndex tile, DiagDirection enterdir, Tr
 		default: NOT_REACHED();
 	}
 
+	RecordPathfinderQuery(v, tile, enterdir, tracks, (VehiclePathFinders)_settings_game.pf.pathfinder_for_ships, track, path_found);
 	v->HandlePathfindingResult(path_found);
 	return track;
 }
@@ -17,6 +17,8 @@
 #include "viewport_func.h"
 #include "train.h"
 #include "company_base.h"
+#include "core/sort_func.hpp"
+#include "misc/hashtable.hpp"
 
 #include "safeguards.h"
 
@@ -45,6 +47,16 @@ static const TrackdirBits _enterdir_to_trackdirbits[DIAGDIR_END] = {
 	TRACKDIR_BIT_Y_SE | TRACKDIR_BIT_UPPER_E | TRACKDIR_BIT_LEFT_S
 };
 
+/** first side of a tile at which ends of the given track signals are updated */
+static const DiagDirection _search_dir_1[] = {
+	DIAGDIR_NE, DIAGDIR_SE, DIAGDIR_NE, DIAGDIR_SE, DIAGDIR_SW, DIAGDIR_SE
+};
+
+/** second side of a tile at which ends of the given track signals are updated */
+static const DiagDirection _search_dir_2[] = {
+	DIAGDIR_SW, DIAGDIR_NW, DIAGDIR_NW, DIAGDIR_SW, DIAGDIR_NW, DIAGDIR_NE
+};
+
 /**
  * Set containing 'items' items of 'tile and Tdir'
  * No tree structure is used because it would cause
@@ -111,6 +123,29 @@ public:
 	}
 
 
+	/**
+	 * Reads an item without removing it
+	 * @param index index of the item, less than Items()
+	 * @param tile pointer where tile is written to
+	 * @param dir pointer where dir is written to
+	 */
+	void Peek(uint index, TileIndex *tile, Tdir *dir)
+	{
+		assert(index < this->n);
+		*tile = this->data[index].tile;
+		*dir = this->data[index].dir;
+	}
+
+	/**
+	 * Removes an item, the last item takes its place
+	 * @param index index of the item, less than Items()
+	 */
+	void RemoveAt(uint index)
+	{
+		assert(index < this->n);
+		this->data[index] = this->data[--this->n];
+	}
+
 	/**
 	 * Tries to remove first instance of given tile and dir
 	 * @param tile tile
@@ -121,7 +156,7 @@ public:
 	{
 		for (uint i = 0; i < this->n; i++) {
 			if (this->data[i].tile == tile && this->data[i].dir == dir) {
-				this->data[i] = this->data[--this->n];
+				this->RemoveAt(i);
 				return true;
 			}
 		}
@@ -184,8 +219,6 @@ public:
 	}
 };
 
-static SmallSet<Trackdir, SIG_TBU_SIZE> _tbuset("_tbuset");         ///< set of signals that will be updated
-static SmallSet<DiagDirection, SIG_TBD_SIZE> _tbdset("_tbdset");    ///< set of open nodes in current signal block
 static SmallSet<DiagDirection, SIG_GLOB_SIZE> _globset("_globset"); ///< set of places to be updated in following runs
 
 
@@ -198,50 +231,252 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 }
 
 
+/** A tile of a signal block, and the side it is entered from. */
+struct SignalBlockItem {
+	TileIndex tile;    ///< the tile
+	DiagDirection dir; ///< the side, or INVALID_DIAGDIR for the inside of a depot or the wormhole of a tunnel or bridge
+};
+
+/** A tile of a signal block on which trains are looked for. */
+struct SignalBlockTile {
+	TileIndex tile;   ///< the tile
+	TrackBits tracks; ///< the tracks a train has to be on, or TRACK_BIT_NONE for any train on the tile
+};
+
+/** A signal at the border of a signal block. */
+struct SignalBlockSignal {
+	TileIndex tile;    ///< tile of the signal
+	Trackdir trackdir; ///< trackdir of the signal
+};
+
+struct SignalBlock;
+
+/** Key of the signal blocks: a side of a tile, for the signals of a company. */
+struct SignalBlockSideKey {
+	TileIndex tile;     ///< the tile
+	DiagDirection side; ///< the side, or INVALID_DIAGDIR for the inside of a depot or the wormhole of a tunnel or bridge
+	Owner owner;        ///< owner whose signals the block is for
+
+	inline int CalcHash() const
+	{
+		return (this->tile << 3 | (this->side & 7)) ^ (this->owner << 27);
+	}
+
+	inline bool operator==(const SignalBlockSideKey &other) const
+	{
+		return this->tile == other.tile && this->side == other.side && this->owner == other.owner;
+	}
+};
+
+/** A side of a tile the exploration of a signal block passed. */
+struct SignalBlockSide {
+	typedef SignalBlockSideKey Key;
+
+	Key key;            ///< the side
+	SignalBlock *block; ///< the block it belongs to
+
+	inline const Key &GetKey() const
+	{
+		return this->key;
+	}
+};
+
 /**
- * Perform some operations before adding data into Todo set
- * The new and reverse direction is removed from _globset, because we are sure
- * it doesn't need to be checked again
- * Also, remove reverse direction from _tbdset
- * This is the 'core' part so the graph searching won't enter any tile twice
+ * The outcome of exploring a signal block from some items. Exploring is not
+ * limited, but signals are not updated when exploring from the items needs
+ * more than #SIG_TBU_SIZE signals or #SIG_TBD_SIZE open items at a time, as
+ * the flood fill used to give up then. That depends on where the
+ * exploration starts, so it is kept for every start.
+ */
+struct SignalBlockStart {
+	SignalBlockItem seeds[2]; ///< items the exploration started with
+	uint num_seeds;           ///< number of items the exploration started with
+	bool full;                ///< the exploration exceeded the limits
+	bool full_pbs;            ///< a path signal was found before the limits were exceeded
+};
+
+/**
+ * The part of a signal block that only depends on the track layout: the
+ * tiles that are connected without passing a signal, the signals facing into
+ * the block and its pre-signal exits. Only the trains on the tiles and the
+ * states of the exits are looked at when the signals are updated.
  *
- * @param t1 tile we are entering
- * @param d1 direction (tile side) we are entering
- * @param t2 tile we are leaving
- * @param d2 direction (tile side) we are leaving
- * @return false iff reverse direction was in Todo set
+ * A block is explored when a side of a tile in it is updated for the first
+ * time, and kept until the track on one of its tiles changes. The lists are
+ * sorted, so the signals are updated in the same order no matter where the
+ * exploration started; clients that joined later must get the same result.
  */
-static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+struct SignalBlock {
+	Owner owner;                               ///< owner whose signals the block is for
+	bool pbs;                                  ///< there is a path signal at the border of the block
+	uint index;                                ///< index in _signal_blocks
+	SignalBlockItem seeds[2];                  ///< items the exploration started with
+	uint num_seeds;                            ///< number of items the exploration started with
+	SmallVector<SignalBlockTile, 16> tiles;    ///< tiles to look for trains on
+	SmallVector<SignalBlockSignal, 4> signals; ///< signals facing into the block, except path signals
+	SmallVector<SignalBlockSignal, 4> exits;   ///< pre-signal exits leaving the block
+	SmallVector<SignalBlockSide, 32> sides;    ///< sides of tiles the block was entered by or left by
+	SmallVector<SignalBlockStart, 2> starts;   ///< outcome of exploring from the items of the updates so far
+	bool full;                                 ///< exploring from #seeds exceeded the limits, see #SignalBlockStart
+	bool full_pbs;                             ///< a path signal was found before the limits were exceeded
+
+	SignalBlock(Owner owner) : owner(owner), pbs(false), index(0), num_seeds(0), full(false), full_pbs(false) {}
+};
+
+static SmallVector<SignalBlock *, 64> _signal_blocks;          ///< all explored signal blocks
+static COpenHashTableT<SignalBlockSide, 12> _signal_block_sides; ///< the sides of the tiles of all explored signal blocks
+static SmallVector<SignalBlockItem, 64> _signal_block_todo;    ///< open items while exploring a signal block
+
+
+/** Sort the tiles of a signal block. */
+static int CDECL SignalBlockTileSorter(const SignalBlockTile *a, const SignalBlockTile *b)
 {
-	_globset.Remove(t1, d1); // it can be in Global but not in Todo
-	_globset.Remove(t2, d2); // remove in all cases
+	if (a->tile != b->tile) return a->tile < b->tile ? -1 : 1;
+	return (int)a->tracks - (int)b->tracks;
+}
 
-	assert(!_tbdset.IsIn(t1, d1)); // it really shouldn't be there already
+/** Sort the signals of a signal block. */
+static int CDECL SignalBlockSignalSorter(const SignalBlockSignal *a, const SignalBlockSignal *b)
+{
+	if (a->tile != b->tile) return a->tile < b->tile ? -1 : 1;
+	return (int)a->trackdir - (int)b->trackdir;
+}
+
+/** Sort the sides of a signal block. */
+static int CDECL SignalBlockSideSorter(const SignalBlockSide *a, const SignalBlockSide *b)
+{
+	if (a->key.tile != b->key.tile) return a->key.tile < b->key.tile ? -1 : 1;
+	return (int)a->key.side - (int)b->key.side;
+}
 
-	if (_tbdset.Remove(t2, d2)) return false;
+/**
+ * Sort a list and remove the duplicates.
+ * @param list The list.
+ * @param comparator Function comparing two items.
+ */
+template <typename T, uint S>
+static void SortUnique(SmallVector<T, S> &list, int (CDECL *comparator)(const T *, const T *))
+{
+	if (list.Length() < 2) return;
+
+	QSortT(list.Begin(), list.Length(), comparator);
+
+	T *last = list.Begin();
+	for (T *it = last + 1; it != list.End(); it++) {
+		if (comparator(last, it) != 0) *++last = *it;
+	}
+	list.Resize(last + 1 - list.Begin());
+}
+
+/**
+ * Compare two sorted lists.
+ * @param a The first list.
+ * @param b The second list.
+ * @param comparator Function comparing two items.
+ * @return Whether the lists have the same items.
+ */
+template <typename T, uint S>
+static bool IsSameList(const SmallVector<T, S> &a, const SmallVector<T, S> &b, int (CDECL *comparator)(const T *, const T *))
+{
+	if (a.Length() != b.Length()) return false;
 
+	for (uint i = 0; i < a.Length(); i++) {
+		if (comparator(a.Get(i), b.Get(i)) != 0) return false;
+	}
 	return true;
 }
 
+/**
+ * Add a side of a tile to a signal block.
+ * @param block the block
+ * @param tile the tile
+ * @param side the side
+ */
+static inline void AddSignalBlockSide(SignalBlock *block, TileIndex tile, DiagDirection side)
+{
+	SignalBlockSide *s = block->sides.Append();
+	s->key.tile = tile;
+	s->key.side = side;
+	s->key.owner = block->owner;
+	s->block = block;
+}
+
+/**
+ * Add a tile to a signal block, when the exploration enters it.
+ * The side of the tile it is entered by and the facing side of the tile
+ * before it are added too; when the exploration started at this tile, the
+ * block changes when the tile before it does.
+ * @param block the block
+ * @param tile the tile
+ * @param enterdir the side it is entered by
+ * @param tracks the tracks a train has to be on, or TRACK_BIT_NONE for any track
+ */
+static inline void AddSignalBlockTile(SignalBlock *block, TileIndex tile, DiagDirection enterdir, TrackBits tracks)
+{
+	SignalBlockTile *t = block->tiles.Append();
+	t->tile = tile;
+	t->tracks = tracks;
+	AddSignalBlockSide(block, tile, enterdir);
+	if (enterdir != INVALID_DIAGDIR) AddSignalBlockSide(block, tile + TileOffsByDiagDir(enterdir), ReverseDiagDir(enterdir));
+}
+
+/**
+ * Mark that exploring a signal block exceeds the limits, unless that happened already.
+ * @param block the block
+ */
+static inline void SetSignalBlockFull(SignalBlock *block)
+{
+	if (block->full) return;
+
+	block->full = true;
+	block->full_pbs = block->pbs;
+	DEBUG(misc, 0, "SignalSegment too complex. Signal block at tile 0x%X is not updated", block->seeds[0].tile);
+}
+
+/**
+ * Add a signal to a list of a signal block.
+ * @param list the list
+ * @param tile tile of the signal
+ * @param trackdir trackdir of the signal
+ */
+static inline void AddSignalBlockSignal(SmallVector<SignalBlockSignal, 4> &list, TileIndex tile, Trackdir trackdir)
+{
+	SignalBlockSignal *s = list.Append();
+	s->tile = tile;
+	s->trackdir = trackdir;
+}
+
 
 /**
  * Perform some operations before adding data into Todo set
- * The new and reverse direction is removed from Global set, because we are sure
- * it doesn't need to be checked again
+ * Both sides are added to the sides of the block, so updates of them are
+ * found to belong to this block.
  * Also, remove reverse direction from Todo set
  * This is the 'core' part so the graph searching won't enter any tile twice
  *
+ * @param block block being explored
  * @param t1 tile we are entering
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
- * @return false iff the Todo buffer would be overrun
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline void MaybeAddToTodoSet(SignalBlock *block, TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
+	AddSignalBlockSide(block, t1, d1);
+	AddSignalBlockSide(block, t2, d2);
+
+	for (SignalBlockItem *it = _signal_block_todo.Begin(); it != _signal_block_todo.End(); it++) {
+		if (it->tile == t2 && it->dir == d2) {
+			_signal_block_todo.Erase(it);
+			return;
+		}
+	}
+
+	if (_signal_block_todo.Length() == SIG_TBD_SIZE) SetSignalBlockFull(block);
 
-	return _tbdset.Add(t1, d1);
+	SignalBlockItem *item = _signal_block_todo.Append();
+	item->tile = t1;
+	item->dir = d1;
 }
 
 
@@ -253,7 +488,7 @@ enum SigFlags {
 	SF_EXIT2  = 1 << 2, ///< two or more exits found
 	SF_GREEN  = 1 << 3, ///< green exitsignal found
 	SF_GREEN2 = 1 << 4, ///< two or more green exits found
-	SF_FULL   = 1 << 5, ///< some of buffers was full, do not continue
+	SF_FULL   = 1 << 5, ///< the block is too complex, do not continue
 	SF_PBS    = 1 << 6, ///< pbs signal found
 };
 
@@ -261,19 +496,25 @@ DECLARE_ENUM_AS_BIT_SET(SigFlags)
 
 
 /**
- * Search signal block
+ * Explore signal block
  *
- * @param owner owner whose signals we are updating
- * @return SigFlags
+ * @param block block with the owner whose signals we are updating, and the items to start with
  */
-static SigFlags ExploreSegment(Owner owner)
+static void ExploreSignalBlock(SignalBlock *block)
 {
-	SigFlags flags = SF_NONE;
+	Owner owner = block->owner;
+	block->full = false;
+	block->full_pbs = false;
 
-	TileIndex tile;
-	DiagDirection enterdir;
+	_signal_block_todo.Clear();
+	for (uint i = 0; i < block->num_seeds; i++) *_signal_block_todo.Append() = block->seeds[i];
+
+	while (_signal_block_todo.Length() != 0) {
+		SignalBlockItem item = _signal_block_todo.End()[-1];
+		_signal_block_todo.Resize(_signal_block_todo.Length() - 1);
 
-	while (_tbdset.Get(&tile, &enterdir)) {
+		TileIndex tile = item.tile;
+		DiagDirection enterdir = item.dir;
 		TileIndex oldtile = tile; // tile we are leaving
 		DiagDirection exitdir = enterdir == INVALID_DIAGDIR ? INVALID_DIAGDIR : ReverseDiagDir(enterdir); // expected new exit direction (for straight line)
 
@@ -283,13 +524,14 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
+						AddSignalBlockSide(block, tile, INVALID_DIAGDIR); // the block is also updated from 'inside'
 						continue;
 					} else {
 						continue;
@@ -302,11 +544,10 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
-					/* If no train detected yet, and there is not no train -> there is a train -> set the flag */
-					if (!(flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) flags |= SF_TRAIN;
+					AddSignalBlockTile(block, tile, enterdir, tracks);
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
 				}
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
@@ -315,27 +556,21 @@ static SigFlags ExploreSegment(Owner owner)
 						SignalType sig = GetSignalType(tile, track);
 						Trackdir trackdir = (Trackdir)FindFirstBit((tracks * 0x101) & _enterdir_to_trackdirbits[enterdir]);
 						Trackdir reversedir = ReverseTrackdir(trackdir);
-						/* add (tile, reversetrackdir) to 'to-be-updated' set when there is
+						/* add (tile, reversetrackdir) to 'to-be-updated' list when there is
 						 * ANY conventional signal in REVERSE direction
 						 * (if it is a presignal EXIT and it changes, it will be added to 'to-be-done' set later) */
 						if (HasSignalOnTrackdir(tile, reversedir)) {
 							if (IsPbsSignal(sig)) {
-								flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, reversedir)) {
-								return flags | SF_FULL;
-							}
-						}
-						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) flags |= SF_PBS;
-
-						/* if it is a presignal EXIT in OUR direction and we haven't found 2 green exits yes, do special check */
-						if (!(flags & SF_GREEN2) && IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) { // found presignal exit
-							if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
-							flags |= SF_EXIT; // found at least one exit - allow for compiler optimizations
-							if (GetSignalStateByTrackdir(tile, trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
-								if (flags & SF_GREEN) flags |= SF_GREEN2;
-								flags |= SF_GREEN;
+								block->pbs = true;
+							} else {
+								if (block->signals.Length() == SIG_TBU_SIZE) SetSignalBlockFull(block);
+								AddSignalBlockSignal(block->signals, tile, reversedir);
 							}
 						}
+						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) block->pbs = true;
+
+						/* the state of presignal EXITs in OUR direction is looked at when updating */
+						if (IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) AddSignalBlockSignal(block->exits, tile, trackdir);
 
 						continue;
 					}
@@ -345,7 +580,7 @@ static SigFlags ExploreSegment(Owner owner)
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) return flags | SF_FULL;
+						MaybeAddToTodoSet(block, newtile, newdir, tile, dir);
 					}
 				}
 
@@ -358,7 +593,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -367,7 +602,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (GetTileOwner(tile) != owner) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -377,13 +612,13 @@ static SigFlags ExploreSegment(Owner owner)
 				DiagDirection dir = GetTunnelBridgeDirection(tile);
 
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
 					enterdir = dir;
 					exitdir = ReverseDiagDir(dir);
 					tile += TileOffsByDiagDir(exitdir); // just skip to next tile
 				} else { // NOT incoming from the wormhole!
 					if (ReverseDiagDir(enterdir) != dir) continue;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddSignalBlockTile(block, tile, enterdir, TRACK_BIT_NONE);
 					tile = GetOtherTunnelBridgeEnd(tile); // just skip to exit tile
 					enterdir = INVALID_DIAGDIR;
 					exitdir = INVALID_DIAGDIR;
@@ -395,7 +630,148 @@ static SigFlags ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) return flags | SF_FULL;
+		MaybeAddToTodoSet(block, tile, enterdir, oldtile, exitdir);
+	}
+
+	SortUnique(block->tiles, &SignalBlockTileSorter);
+	SortUnique(block->signals, &SignalBlockSignalSorter);
+	SortUnique(block->exits, &SignalBlockSignalSorter);
+	SortUnique(block->sides, &SignalBlockSideSorter);
+}
+
+
+/**
+ * Forget an explored signal block.
+ * @param block the block
+ */
+static void DeleteSignalBlock(SignalBlock *block)
+{
+	for (SignalBlockSide *side = block->sides.Begin(); side != block->sides.End(); side++) {
+		_signal_block_sides.Pop(*side);
+	}
+
+	SignalBlock *last = _signal_blocks[_signal_blocks.Length() - 1];
+	last->index = block->index;
+	_signal_blocks[block->index] = last;
+	_signal_blocks.Erase(_signal_blocks.End() - 1);
+
+	delete block;
+}
+
+
+/**
+ * Get the flags of a signal block that is too complex to be updated from the given items.
+ * The outcome for new items is found by exploring the block from them.
+ *
+ * @param block the block
+ * @param seeds the items to start with
+ * @param num_seeds the number of items
+ * @return SF_FULL, and SF_PBS if a path signal was found before the limits were exceeded; SF_NONE if the limits are not exceeded
+ */
+static SigFlags GetSignalBlockFullFlags(SignalBlock *block, const SignalBlockItem *seeds, uint num_seeds)
+{
+	SignalBlockStart *start;
+	for (start = block->starts.Begin(); start != block->starts.End(); start++) {
+		if (start->num_seeds == num_seeds && MemCmpT(start->seeds, seeds, num_seeds) == 0) break;
+	}
+
+	if (start == block->starts.End()) {
+		SignalBlock fresh(block->owner);
+		fresh.num_seeds = num_seeds;
+		MemCpyT(fresh.seeds, seeds, num_seeds);
+		ExploreSignalBlock(&fresh);
+
+		start = block->starts.Append();
+		MemCpyT(start->seeds, seeds, num_seeds);
+		start->num_seeds = num_seeds;
+		start->full = fresh.full;
+		start->full_pbs = fresh.full_pbs;
+	}
+
+	if (!start->full) return SF_NONE;
+	return start->full_pbs ? SF_FULL | SF_PBS : SF_FULL;
+}
+
+
+/**
+ * Get the signal block that the exploration from the given items finds;
+ * when it is not explored yet, explore it.
+ *
+ * @param owner owner whose signals we are updating
+ * @param seeds the items to start with
+ * @param num_seeds the number of items
+ * @param[out] full the flags when the block is too complex to be updated from the items, or SF_NONE
+ * @return the block, or NULL when there is no track of \a owner at the items
+ */
+static SignalBlock *GetSignalBlock(Owner owner, const SignalBlockItem *seeds, uint num_seeds, SigFlags *full)
+{
+	for (uint i = 0; i < num_seeds; i++) {
+		SignalBlockSideKey key = { seeds[i].tile, seeds[i].dir, owner };
+		SignalBlockSide *side = _signal_block_sides.Find(key);
+		if (side != NULL) {
+			*full = GetSignalBlockFullFlags(side->block, seeds, num_seeds);
+			return side->block;
+		}
+	}
+
+	SignalBlock *block = new SignalBlock(owner);
+	block->num_seeds = num_seeds;
+	MemCpyT(block->seeds, seeds, num_seeds);
+	ExploreSignalBlock(block);
+
+	*full = SF_NONE;
+	if (block->tiles.Length() == 0) {
+		delete block;
+		return NULL;
+	}
+
+	SignalBlockStart *start = block->starts.Append();
+	MemCpyT(start->seeds, seeds, num_seeds);
+	start->num_seeds = num_seeds;
+	start->full = block->full;
+	start->full_pbs = block->full_pbs;
+	if (block->full) *full = block->full_pbs ? SF_FULL | SF_PBS : SF_FULL;
+
+	for (SignalBlockSide *side = block->sides.Begin(); side != block->sides.End(); side++) {
+		/* Exploring from any item of a block finds the same sides; this only happens when the track changed without telling. */
+		SignalBlockSide *old = _signal_block_sides.Find(side->key);
+		if (old != NULL) DeleteSignalBlock(old->block);
+		_signal_block_sides.Push(*side);
+	}
+
+	block->index = _signal_blocks.Length();
+	*_signal_blocks.Append() = block;
+	return block;
+}
+
+
+/**
+ * Get the state of a signal block from the trains on it and the states of its exits
+ *
+ * @param block the block
+ * @return SigFlags
+ */
+static SigFlags GetSignalBlockFlags(const SignalBlock *block)
+{
+	SigFlags flags = block->pbs ? SF_PBS : SF_NONE;
+
+	for (const SignalBlockTile *t = block->tiles.Begin(); t != block->tiles.End(); t++) {
+		if (t->tracks == TRACK_BIT_NONE ? HasVehicleOnPos(t->tile, NULL, &TrainOnTileEnum) : EnsureNoTrainOnTrackBits(t->tile, t->tracks).Failed()) {
+			flags |= SF_TRAIN;
+			break;
+		}
+	}
+
+	for (const SignalBlockSignal *s = block->exits.Begin(); s != block->exits.End(); s++) {
+		if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
+		flags |= SF_EXIT; // found at least one exit - allow for compiler optimizations
+		if (GetSignalStateByTrackdir(s->tile, s->trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
+			if (flags & SF_GREEN) {
+				flags |= SF_GREEN2;
+				break;
+			}
+			flags |= SF_GREEN;
+		}
 	}
 
 	return flags;
@@ -403,16 +779,39 @@ static SigFlags ExploreSegment(Owner owner)
 
 
 /**
- * Update signals around segment in _tbuset
+ * Remove the places of a signal block from _globset, as the block doesn't need to be checked again
  *
+ * @param block the block
+ */
+static void RemoveSignalBlockFromBuffer(const SignalBlock *block)
+{
+	for (uint i = 0; i < _globset.Items();) {
+		SignalBlockSideKey key;
+		_globset.Peek(i, &key.tile, &key.side);
+		key.owner = block->owner;
+
+		const SignalBlockSide *side = _signal_block_sides.Find(key);
+		if (side != NULL && side->block == block) {
+			_globset.RemoveAt(i);
+		} else {
+			i++;
+		}
+	}
+}
+
+
+/**
+ * Update signals around segment
+ *
+ * @param block the segment
  * @param flags info about segment
  */
-static void UpdateSignalsAroundSegment(SigFlags flags)
+static void UpdateSignalsAroundSegment(const SignalBlock *block, SigFlags flags)
 {
-	TileIndex tile;
-	Trackdir trackdir;
+	for (const SignalBlockSignal *s = block->signals.Begin(); s != block->signals.End(); s++) {
+		TileIndex tile = s->tile;
+		Trackdir trackdir = s->trackdir;
 
-	while (_tbuset.Get(&tile, &trackdir)) {
 		assert(HasSignalOnTrackdir(tile, trackdir));
 
 		SignalType sig = GetSignalType(tile, TrackdirToTrack(trackdir));
@@ -453,15 +852,6 @@ static void UpdateSignalsAroundSegment(SigFlags flags)
 }
 
 
-/** Reset all sets after one set overflowed */
-static inline void ResetSets()
-{
-	_tbuset.Reset();
-	_tbdset.Reset();
-	_globset.Reset();
-}
-
-
 /**
  * Updates blocks in _globset buffer
  *
@@ -480,8 +870,8 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 	DiagDirection dir;
 
 	while (_globset.Get(&tile, &dir)) {
-		assert(_tbuset.IsEmpty());
-		assert(_tbdset.IsEmpty());
+		SignalBlockItem seeds[2];
+		uint num_seeds = 0;
 
 		/* After updating signal, data stored are always MP_RAILWAY with signals.
 		 * Other situations happen when data are from outside functions -
@@ -493,15 +883,18 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 				/* 'optimization assert' - do not try to update signals when it is not needed */
 				assert(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL);
 				assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
-				_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
-				_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
+				seeds[num_seeds].tile = tile; // we can safely start from wormhole centre
+				seeds[num_seeds++].dir = INVALID_DIAGDIR;
+				seeds[num_seeds].tile = GetOtherTunnelBridgeEnd(tile);
+				seeds[num_seeds++].dir = INVALID_DIAGDIR;
 				break;
 
 			case MP_RAILWAY:
 				if (IsRailDepot(tile)) {
 					/* 'optimization assert' do not try to update signals in other cases */
 					assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
-					_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
+					seeds[num_seeds].tile = tile; // start from depot inside
+					seeds[num_seeds++].dir = INVALID_DIAGDIR;
 					break;
 				}
 				FALLTHROUGH;
@@ -510,8 +903,10 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 			case MP_ROAD:
 				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
 					/* only add to set when there is some 'interesting' track */
-					_tbdset.Add(tile, dir);
-					_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
+					seeds[num_seeds].tile = tile;
+					seeds[num_seeds++].dir = dir;
+					seeds[num_seeds].tile = tile + TileOffsByDiagDir(dir);
+					seeds[num_seeds++].dir = ReverseDiagDir(dir);
 					break;
 				}
 				FALLTHROUGH;
@@ -521,17 +916,17 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 				tile = tile + TileOffsByDiagDir(dir);
 				dir = ReverseDiagDir(dir);
 				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					_tbdset.Add(tile, dir);
+					seeds[num_seeds].tile = tile;
+					seeds[num_seeds++].dir = dir;
 					break;
 				}
 				/* happens when removing a rail that wasn't connected at one or both sides */
 				continue; // continue the while() loop
 		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
-		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
-
-		SigFlags flags = ExploreSegment(owner);
+		SigFlags flags;
+		const SignalBlock *block = GetSignalBlock(owner, seeds, num_seeds, &flags);
+		if (block != NULL && flags == SF_NONE) flags = GetSignalBlockFlags(block);
 
 		if (first) {
 			first = false;
@@ -543,19 +938,108 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 			}
 		}
 
-		/* do not do anything when some buffer was full */
+		/* do not do anything when the block is too complex */
 		if (flags & SF_FULL) {
-			ResetSets(); // free all sets
+			_globset.Reset(); // free all sets
 			break;
 		}
 
-		UpdateSignalsAroundSegment(flags);
+		if (block == NULL) continue;
+
+		RemoveSignalBlockFromBuffer(block);
+		UpdateSignalsAroundSegment(block, flags);
 	}
 
 	return state;
 }
 
 
+/**
+ * Forget the explored signal blocks that have a side of a tile
+ *
+ * @param tile the tile
+ */
+static void DeleteSignalBlocksAt(TileIndex tile)
+{
+	for (CompanyID c = COMPANY_FIRST; c < MAX_COMPANIES; c++) {
+		for (uint i = 0; i <= DIAGDIR_END; i++) {
+			SignalBlockSideKey key = { tile, i == DIAGDIR_END ? INVALID_DIAGDIR : (DiagDirection)i, c };
+			SignalBlockSide *side = _signal_block_sides.Find(key);
+			if (side != NULL) DeleteSignalBlock(side->block);
+		}
+	}
+}
+
+
+/**
+ * Forget the explored signal blocks at a tile, because its track changed
+ *
+ * @param tile the tile, or INVALID_TILE to forget all blocks
+ */
+void InvalidateSignalBlocks(TileIndex tile)
+{
+	if (tile == INVALID_TILE) {
+		for (SignalBlock **it = _signal_blocks.Begin(); it != _signal_blocks.End(); it++) delete *it;
+		_signal_blocks.Clear();
+		_signal_block_sides.Clear();
+		return;
+	}
+
+	/* Every block that passes the tile, or can pass it, has a side of the tile:
+	 * the neighbouring tiles of a block are visited even when they don't continue it. */
+	DeleteSignalBlocksAt(tile);
+
+	/* a new tunnel or bridge also connects the blocks at its other end */
+	if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL) {
+		DeleteSignalBlocksAt(GetOtherTunnelBridgeEnd(tile));
+	}
+}
+
+
+/**
+ * Check whether the explored signal blocks are still the same as the ones
+ * found when exploring them again; a difference means the track changed
+ * without InvalidateSignalBlocks being called, which would desync clients.
+ */
+void CheckSignalBlocks()
+{
+	for (const SignalBlock * const *it = _signal_blocks.Begin(); it != _signal_blocks.End(); it++) {
+		const SignalBlock *block = *it;
+
+		SignalBlock fresh(block->owner);
+		fresh.num_seeds = block->num_seeds;
+		MemCpyT(fresh.seeds, block->seeds, block->num_seeds);
+		ExploreSignalBlock(&fresh);
+
+		if (fresh.pbs != block->pbs || !IsSameList(fresh.tiles, block->tiles, &SignalBlockTileSorter) ||
+				!IsSameList(fresh.signals, block->signals, &SignalBlockSignalSorter) || !IsSameList(fresh.exits, block->exits, &SignalBlockSignalSorter) ||
+				!IsSameList(fresh.sides, block->sides, &SignalBlockSideSorter)) {
+			DEBUG(desync, 2, "signal block cache mismatch: tile 0x%X, side %i, company %i", block->seeds[0].tile, (int)block->seeds[0].dir, (int)block->owner);
+		}
+
+		for (const SignalBlockStart *start = block->starts.Begin(); start != block->starts.End(); start++) {
+			SignalBlock from_start(block->owner);
+			from_start.num_seeds = start->num_seeds;
+			MemCpyT(from_start.seeds, start->seeds, start->num_seeds);
+			ExploreSignalBlock(&from_start);
+
+			if (from_start.full != start->full || from_start.full_pbs != start->full_pbs) {
+				DEBUG(desync, 2, "signal block cache mismatch: too complex from tile 0x%X, side %i, company %i", start->seeds[0].tile, (int)start->seeds[0].dir, (int)block->owner);
+			}
+		}
+	}
+}
+
+/** Free the explored signal blocks, e.g. when the game is shut down. */
+void FreeSignalBlocks()
+{
+	for (SignalBlock **it = _signal_blocks.Begin(); it != _signal_blocks.End(); it++) delete *it;
+	_signal_blocks.Reset();
+	_signal_block_sides.Free();
+	_signal_block_todo.Reset();
+}
+
+
 static Owner _last_owner = INVALID_OWNER; ///< last owner whose track was put into _globset
 
 
@@ -581,12 +1065,8 @@ void UpdateSignalsInBuffer()
  */
 void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
 {
-	static const DiagDirection _search_dir_1[] = {
-		DIAGDIR_NE, DIAGDIR_SE, DIAGDIR_NE, DIAGDIR_SE, DIAGDIR_SW, DIAGDIR_SE
-	};
-	static const DiagDirection _search_dir_2[] = {
-		DIAGDIR_SW, DIAGDIR_NW, DIAGDIR_NW, DIAGDIR_SW, DIAGDIR_NW, DIAGDIR_NE
-	};
+	/* the track changed, so the blocks explored before are no longer valid */
+	InvalidateSignalBlocks(tile);
 
 	/* do not allow signal updates for two companies in one run */
 	assert(_globset.IsEmpty() || owner == _last_owner);
@@ -613,6 +1093,9 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
  */
 void AddSideToSignalBuffer(TileIndex tile, DiagDirection side, Owner owner)
 {
+	/* the track changed, so the blocks explored before are no longer valid */
+	InvalidateSignalBlocks(tile);
+
 	/* do not allow signal updates for two companies in one run */
 	assert(_globset.IsEmpty() || owner == _last_owner);
 
@@ -659,6 +1142,8 @@ void SetSignalsOnBothDir(TileIndex tile, Track track, Owner owner)
 {
 	assert(_globset.IsEmpty());
 
-	AddTrackToSignalBuffer(tile, track, owner);
+	/* unlike AddTrackToSignalBuffer(), the track didn't change */
+	_globset.Add(tile, _search_dir_1[track]);
+	_globset.Add(tile, _search_dir_2[track]);
 	UpdateSignalsInBuffer(owner);
 }
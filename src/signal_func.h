@@ -59,5 +59,7 @@ void SetSignalsOnBothDir(TileIndex tile, Track track, Owner owner);
 void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner);
 void AddSideToSignalBuffer(TileIndex tile, DiagDirection side, Owner owner);
 void UpdateSignalsInBuffer();
+void InvalidateSignalBlocks(TileIndex tile);
+void FreeSignalBlocks();
 
 #endif /* SIGNAL_FUNC_H */
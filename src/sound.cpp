@@ -121,8 +121,10 @@ static bool SetBankSource(MixerChannel *mc, const SoundEntry *sound)
 	mem[sound->file_size    ] = 0;
 	mem[sound->file_size + 1] = 0;
 
+	FioLock();
 	FioSeekToFile(sound->file_slot, sound->file_offset);
 	FioReadBlock(mem, sound->file_size);
+	FioUnlock();
 
 	/* 16-bit PCM WAV files should be signed by default */
 	if (sound->bits_per_sample == 8) {
@@ -153,7 +155,9 @@ static bool SetBankSource(MixerChannel *mc, const SoundEntry *sound)
 void InitializeSound()
 {
 	DEBUG(misc, 1, "Loading sound effects...");
+	FioLock();
 	OpenBankFile(BaseSounds::GetUsedSet()->files->filename);
+	FioUnlock();
 }
 
 /* Low level sound player */
@@ -166,7 +170,10 @@ static void StartSound(SoundID sound_id, float pan, uint volume)
 
 	/* NewGRF sound that wasn't loaded yet? */
 	if (sound->rate == 0 && sound->file_slot != 0) {
-		if (!LoadNewGRFSound(sound)) {
+		FioLock();
+		bool loaded = LoadNewGRFSound(sound);
+		FioUnlock();
+		if (!loaded) {
 			/* Mark as invalid. */
 			sound->file_slot = 0;
 			return;
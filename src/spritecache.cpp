@@ -19,6 +19,8 @@
 #include "blitter/factory.hpp"
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
+#include "core/smallvec_type.hpp"
+#include "thread/thread.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -40,6 +42,7 @@ struct SpriteCache {
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
+	bool prefetching;    ///< Whether the sprite is read in the background, and not added to the cache yet. Only used by the main thread.
 };
 
 
@@ -77,18 +80,59 @@ static SpriteCache *AllocateSpriteCache(uint index)
 
 
 struct MemBlock {
-	size_t size;
+	size_t size;   ///< Size of the block including this header; the block is free when any of the #S_FREE_MASK bits are set.
+	size_t sprite; ///< The sprite the block is used for; a size_t to keep the data aligned.
 	byte data[];
 };
 
-static uint _sprite_lru_counter;
+/** Maximum number of parts of the sprite cache; each part has its own memory, least recently used sprites and lock. */
+static const uint MAX_SPRITE_CACHE_SHARDS = 4;
+/** Minimum size of a part of the sprite cache, so large sprites fit in it. */
+static const uint MIN_SPRITE_CACHE_SHARD_SIZE = 1024 * 1024;
+
+/** A part of the sprite cache; a sprite is in the part of its number modulo #_spritecache_shard_count. */
+struct SpriteCacheShard {
+	MemBlock *ptr;      ///< The memory of the part, ending with a sentinel block.
+	uint lru_counter;   ///< Counter for the last use of the sprites in the part.
+	ThreadMutex *mutex; ///< Mutex for using the part while the cache is shared, see #SetSpriteCacheShared.
+};
+
 static MemBlock *_spritecache_ptr;
 static uint _allocated_sprite_cache_size = 0;
+static SpriteCacheShard _spritecache_shards[MAX_SPRITE_CACHE_SHARDS];
+static uint _spritecache_shard_count = 1; ///< Number of parts the sprite cache is split in.
+static uint _spritecache_alloc_shard; ///< The part #AllocSprite and #AllocSpriteShared allocate in; set by the thread that reads the sprite, see #GetRawSprite.
 static int _compact_cache_counter;
+static uint _compact_cache_shard;     ///< The part of the cache that is compacted next.
+
+static bool _spritecache_shared = false;              ///< Whether other threads read sprites too, see #SetSpriteCacheShared.
+static SmallVector<void *, 16> _spritecache_overflow; ///< Sprites that did not fit in the cache while it was shared.
+static bool _spritecache_overflowed;                  ///< Whether the last read sprite did not fit in the cache.
 
-static void CompactSpriteCache();
+static const uint SPRITE_PREFETCH_QUEUE_SIZE = 1024; ///< Maximum number of sprites that wait for being read in the background.
+
+static ThreadMutex *_sprite_prefetch_mutex = NULL;        ///< Mutex for the sprites that are read in the background; \c NULL when they are not, see #StartSpritePrefetching.
+static ThreadObject *_sprite_prefetch_thread = NULL;      ///< The thread reading sprites in the background.
+static bool _sprite_prefetch_exit = false;                ///< Whether the thread reading sprites in the background has to stop.
+static bool _sprite_prefetch_failed = false;              ///< Whether the thread for reading sprites in the background could not be started.
+static SmallVector<SpriteID, 64> _sprite_prefetch_queue;  ///< Sprites that are still to be read in the background.
+static SmallVector<MemBlock *, 64> _sprite_prefetch_done; ///< Sprites that are read in the background, but not added to the cache yet.
+static uint _sprite_prefetch_generation;                  ///< Changes when the sprites that are read in the background are not wanted anymore.
+
+static void CompactSpriteCache(uint shard);
+static void DeleteEntryFromSpriteCache(uint item);
 static void *AllocSprite(size_t mem_req);
 
+/**
+ * Get the part of the sprite cache a sprite is in.
+ * @param sprite The sprite.
+ * @return The index of the part in #_spritecache_shards.
+ */
+static inline uint GetSpriteCacheShard(SpriteID sprite)
+{
+	return sprite % _spritecache_shard_count;
+}
+
 /**
  * Skip the given amount of sprite graphics data.
  * @param type the type of sprite (compressed etc)
@@ -391,15 +435,32 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
 	return dest;
 }
 
+static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator, Blitter *blitter);
+
+/**
+ * Read the 'query' sprite from disk, for a sprite that cannot be read.
+ * Like GetRawSprite, but for any blitter.
+ * @param allocator Allocator function to use.
+ * @param blitter   Blitter to encode the sprite for.
+ * @return Read sprite data.
+ */
+static void *ReadFallbackSprite(AllocatorProc *allocator, Blitter *blitter)
+{
+	const SpriteCache *sc = GetSpriteCache(SPR_IMG_QUERY);
+	if (sc->type != ST_NORMAL) usererror("Uhm, would you be so kind not to load a NewGRF that makes the 'query' sprite a non-normal sprite?");
+	return ReadSprite(sc, SPR_IMG_QUERY, ST_NORMAL, allocator, blitter);
+}
+
 /**
  * Read a sprite from disk.
  * @param sc          Location of sprite.
  * @param id          Sprite number.
  * @param sprite_type Type of sprite.
  * @param allocator   Allocator function to use.
+ * @param blitter     Blitter to encode the sprite for.
  * @return Read sprite data.
  */
-static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator)
+static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_type, AllocatorProc *allocator, Blitter *blitter)
 {
 	uint8 file_slot = sc->file_slot;
 	size_t file_pos = sc->file_pos;
@@ -415,7 +476,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	sprite[ZOOM_LVL_NORMAL].type = sprite_type;
 
 	SpriteLoaderGrf sprite_loader(sc->container_ver);
-	if (sprite_type != ST_MAPGEN && BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
+	if (sprite_type != ST_MAPGEN && blitter->GetScreenDepth() == 32) {
 		/* Try for 32bpp sprites first. */
 		sprite_avail = sprite_loader.LoadSprite(sprite, file_slot, file_pos, sprite_type, true);
 	}
@@ -426,7 +487,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	if (sprite_avail == 0) {
 		if (sprite_type == ST_MAPGEN) return NULL;
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+		return ReadFallbackSprite(allocator, blitter);
 	}
 
 	if (sprite_type == ST_MAPGEN) {
@@ -459,7 +520,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 
 	if (!ResizeSprites(sprite, sprite_avail, file_slot, sc->id)) {
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't resize the fallback sprite. What should I do?");
-		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
+		return ReadFallbackSprite(allocator, blitter);
 	}
 
 	if (sprite->type == ST_FONT && ZOOM_LVL_GUI != ZOOM_LVL_NORMAL) {
@@ -471,7 +532,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 		sprite[ZOOM_LVL_NORMAL].data   = sprite[ZOOM_LVL_GUI].data;
 	}
 
-	return BlitterFactory::GetCurrentBlitter()->Encode(sprite, allocator);
+	return blitter->Encode(sprite, allocator);
 }
 
 
@@ -544,7 +605,9 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 			return false;
 		}
 		type = ST_RECOLOUR;
+		_spritecache_alloc_shard = GetSpriteCacheShard(load_index);
 		data = ReadRecolourSprite(file_slot, num);
+		((MemBlock *)data - 1)->sprite = load_index;
 	} else if (container_version >= 2 && grf_type == 0xFD) {
 		if (num != 4) {
 			/* Invalid sprite section include, ignore. */
@@ -575,6 +638,8 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	/* A sprite that replaces a cached one; the block of the old one has to be freed, as compacting the cache moves blocks by their sprite. */
+	if (sc->ptr != NULL) DeleteEntryFromSpriteCache(load_index);
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
@@ -583,6 +648,7 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	sc->type = type;
 	sc->warned = false;
 	sc->container_ver = container_version;
+	sc->prefetching = false;
 
 	return true;
 }
@@ -593,6 +659,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
 	SpriteCache *scold = GetSpriteCache(old_spr);
 
+	if (scnew->ptr != NULL) DeleteEntryFromSpriteCache(new_spr);
 	scnew->file_slot = scold->file_slot;
 	scnew->file_pos = scold->file_pos;
 	scnew->ptr = NULL;
@@ -600,6 +667,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	scnew->type = scold->type;
 	scnew->warned = false;
 	scnew->container_ver = scold->container_ver;
+	scnew->prefetching = false;
 }
 
 /**
@@ -611,7 +679,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 static const size_t S_FREE_MASK = sizeof(size_t) - 1;
 
 /* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
+assert_compile(sizeof(MemBlock) == 2 * sizeof(size_t));
 /* make sure it's a power of two */
 assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
 
@@ -620,28 +688,33 @@ static inline MemBlock *NextBlock(MemBlock *block)
 	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
 }
 
-static size_t GetSpriteCacheUsage()
+static size_t GetSpriteCacheUsage(uint shard)
 {
 	size_t tot_size = 0;
 	MemBlock *s;
 
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
+	for (s = _spritecache_shards[shard].ptr; s->size != 0; s = NextBlock(s)) {
 		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
 	}
 
 	return tot_size;
 }
 
+static void AddPrefetchedSprites();
+static void ClearPrefetchedSprites();
 
 void IncreaseSpriteLRU()
 {
+	AddPrefetchedSprites();
+
 	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
+	for (uint shard = 0; shard < _spritecache_shard_count; shard++) {
+		SpriteCacheShard *scs = &_spritecache_shards[shard];
+		if (scs->lru_counter <= 16384) continue;
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
+		DEBUG(sprite, 3, "Fixing lru %u of part %u, inuse=" PRINTF_SIZE, scs->lru_counter, shard, GetSpriteCacheUsage(shard));
 
-		for (i = 0; i != _spritecache_items; i++) {
+		for (SpriteID i = shard; i < _spritecache_items; i += _spritecache_shard_count) {
 			SpriteCache *sc = GetSpriteCache(i);
 			if (sc->ptr != NULL) {
 				if (sc->lru >= 0) {
@@ -651,31 +724,32 @@ void IncreaseSpriteLRU()
 				}
 			}
 		}
-		_sprite_lru_counter = 0;
+		scs->lru_counter = 0;
 	}
 
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
+	/* Compact a part of the sprite cache every now and then; every part as often as the whole cache used to be. */
+	if (++_compact_cache_counter >= 740 / (int)_spritecache_shard_count) {
+		CompactSpriteCache(_compact_cache_shard);
+		_compact_cache_shard = (_compact_cache_shard + 1) % _spritecache_shard_count;
 		_compact_cache_counter = 0;
 	}
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
+ * Called when holes in a part of the sprite cache should be removed.
  * That is accomplished by moving the cached data.
+ * @param shard The part of the cache.
  */
-static void CompactSpriteCache()
+static void CompactSpriteCache(uint shard)
 {
 	MemBlock *s;
 
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+	DEBUG(sprite, 3, "Compacting sprite cache part %u, inuse=" PRINTF_SIZE, shard, GetSpriteCacheUsage(shard));
 
-	for (s = _spritecache_ptr; s->size != 0;) {
+	for (s = _spritecache_shards[shard].ptr; s->size != 0;) {
 		if (s->size & S_FREE_MASK) {
 			MemBlock *next = NextBlock(s);
 			MemBlock temp;
-			SpriteID i;
 
 			/* Since free blocks are automatically coalesced, this should hold true. */
 			assert(!(next->size & S_FREE_MASK));
@@ -683,12 +757,11 @@ static void CompactSpriteCache()
 			/* If the next block is the sentinel block, we can safely return */
 			if (next->size == 0) break;
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+			/* The sprite belonging to the next pointer. */
+			SpriteCache *sc = GetSpriteCache((SpriteID)next->sprite);
+			assert(sc->ptr == next->data);
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
+			sc->ptr = s->data; // Adjust sprite array entry
 			/* Swap this and the next block */
 			temp = *s;
 			memmove(s, next, next->size);
@@ -718,7 +791,7 @@ static void DeleteEntryFromSpriteCache(uint item)
 	GetSpriteCache(item)->ptr = NULL;
 
 	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
+	for (s = _spritecache_shards[GetSpriteCacheShard(item)].ptr; s->size != 0; s = NextBlock(s)) {
 		if (s->size & S_FREE_MASK) {
 			while (NextBlock(s)->size & S_FREE_MASK) {
 				s->size += NextBlock(s)->size & ~S_FREE_MASK;
@@ -727,15 +800,19 @@ static void DeleteEntryFromSpriteCache(uint item)
 	}
 }
 
-static void DeleteEntryFromSpriteCache()
+/**
+ * Delete the least recently used entry from a part of the sprite cache.
+ * @param shard The part of the cache.
+ */
+static void DeleteEntryFromSpriteCacheShard(uint shard)
 {
 	uint best = UINT_MAX;
 	int cur_lru;
 
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, part %u, inuse=" PRINTF_SIZE, shard, GetSpriteCacheUsage(shard));
 
 	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
+	for (SpriteID i = shard; i < _spritecache_items; i += _spritecache_shard_count) {
 		SpriteCache *sc = GetSpriteCache(i);
 		if (sc->type != ST_RECOLOUR && sc->ptr != NULL && sc->lru < cur_lru) {
 			cur_lru = sc->lru;
@@ -750,43 +827,104 @@ static void DeleteEntryFromSpriteCache()
 	DeleteEntryFromSpriteCache(best);
 }
 
-static void *AllocSprite(size_t mem_req)
+/**
+ * Find a free block in a part of the sprite cache, without removing any sprite from it.
+ * @param shard The part of the cache.
+ * @param mem_req The size of the block, including the #MemBlock header and aligned.
+ * @return The data of the block, or \c NULL when there is no large enough free block.
+ */
+static void *FindFreeSpriteBlock(uint shard, size_t mem_req)
 {
-	mem_req += sizeof(MemBlock);
+	for (MemBlock *s = _spritecache_shards[shard].ptr; s->size != 0; s = NextBlock(s)) {
+		if (s->size & S_FREE_MASK) {
+			size_t cur_size = s->size & ~S_FREE_MASK;
+
+			/* Is the block exactly the size we need or
+			 * big enough for an additional free block? */
+			if (cur_size == mem_req ||
+					cur_size >= mem_req + sizeof(MemBlock)) {
+				/* Set size and in use */
+				s->size = mem_req;
+
+				/* Do we need to inject a free block too? */
+				if (cur_size != mem_req) {
+					NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
+				}
+
+				return s->data;
+			}
+		}
+	}
+	return NULL;
+}
 
+/**
+ * Get the size of the block in the sprite cache for some data.
+ * @param size The size of the data.
+ * @return The size of the block.
+ */
+static size_t GetSpriteBlockSize(size_t size)
+{
 	/* Align this to correct boundary. This also makes sure at least one
 	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
-
-	for (;;) {
-		MemBlock *s;
-
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
-
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
+	return Align(size + sizeof(MemBlock), S_FREE_MASK + 1);
+}
 
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
+/**
+ * Allocate a sprite in the part #_spritecache_alloc_shard of the sprite
+ * cache, removing the least recently used sprites of it when it is full.
+ * @param mem_req The size of the sprite.
+ * @return The memory for the sprite.
+ */
+static void *AllocSprite(size_t mem_req)
+{
+	mem_req = GetSpriteBlockSize(mem_req);
 
-					return s->data;
-				}
-			}
-		}
+	for (;;) {
+		void *data = FindFreeSpriteBlock(_spritecache_alloc_shard, mem_req);
+		if (data != NULL) return data;
 
 		/* Reached sentinel, but no block found yet. Delete some old entry. */
-		DeleteEntryFromSpriteCache();
+		DeleteEntryFromSpriteCacheShard(_spritecache_alloc_shard);
 	}
 }
 
+/**
+ * Allocate a sprite while the sprite cache is shared. Other threads may
+ * still use any sprite in the cache, so none is removed from it; when there
+ * is no room in the part #_spritecache_alloc_shard of the cache, the sprite
+ * is kept outside the cache until sharing ends.
+ * @param mem_req The size of the sprite.
+ * @return The memory for the sprite.
+ */
+static void *AllocSpriteShared(size_t mem_req)
+{
+	SpriteCacheShard *scs = &_spritecache_shards[_spritecache_alloc_shard];
+	scs->mutex->BeginCritical();
+	void *data = FindFreeSpriteBlock(_spritecache_alloc_shard, GetSpriteBlockSize(mem_req));
+	scs->mutex->EndCritical();
+	if (data != NULL) return data;
+
+	data = MallocT<byte>(mem_req);
+	*_spritecache_overflow.Append() = data;
+	_spritecache_overflowed = true;
+	return data;
+}
+
+/**
+ * Allocate a sprite that is read in the background. It is a block like the
+ * ones in the sprite cache, so it can be copied into the cache as it is.
+ * @param mem_req The size of the sprite.
+ * @return The memory for the sprite.
+ */
+static void *AllocPrefetchedSprite(size_t mem_req)
+{
+	mem_req = GetSpriteBlockSize(mem_req);
+	MemBlock *block = (MemBlock *)MallocT<byte>(mem_req);
+	block->size = mem_req;
+	return block->data;
+}
+
 /**
  * Handles the case when a sprite of different type is requested than is present in the SpriteCache.
  * For ST_FONT sprites, it is normal. In other cases, default sprite is loaded instead.
@@ -856,22 +994,255 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 
 	if (sc->type != type) return HandleInvalidSpriteRequest(sprite, type, sc, allocator);
 
-	if (allocator == NULL) {
-		/* Load sprite into/from spritecache */
+	if (allocator != NULL) {
+		/* Do not use the spritecache, but a different allocator. */
+		FioLock();
+		void *ptr = ReadSprite(sc, sprite, type, allocator, BlitterFactory::GetCurrentBlitter());
+		FioUnlock();
+		return ptr;
+	}
 
+	/* Load sprite into/from spritecache */
+	uint shard = GetSpriteCacheShard(sprite);
+	SpriteCacheShard *scs = &_spritecache_shards[shard];
+
+	if (!_spritecache_shared) {
 		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
+		sc->lru = ++scs->lru_counter;
 
 		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == NULL) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		if (sc->ptr == NULL) {
+			FioLock();
+			_spritecache_alloc_shard = shard;
+			sc->ptr = ReadSprite(sc, sprite, type, AllocSprite, BlitterFactory::GetCurrentBlitter());
+			FioUnlock();
+			if (sc->ptr != NULL) ((MemBlock *)sc->ptr - 1)->sprite = sprite;
+		}
 
 		return sc->ptr;
-	} else {
-		/* Do not use the spritecache, but a different allocator. */
-		return ReadSprite(sc, sprite, type, allocator);
 	}
+
+	/* Other threads use the cache too; only the part of the sprite is locked. */
+	scs->mutex->BeginCritical();
+	sc->lru = ++scs->lru_counter;
+	void *ptr = sc->ptr;
+	scs->mutex->EndCritical();
+	if (ptr != NULL) return ptr;
+
+	/* Sprites are only added to the cache with the files locked, so another
+	 * thread might have added it while this one waited for them. */
+	FioLock();
+	ptr = sc->ptr;
+	if (ptr == NULL) {
+		_spritecache_alloc_shard = shard;
+		_spritecache_overflowed = false;
+		ptr = ReadSprite(sc, sprite, type, AllocSpriteShared, BlitterFactory::GetCurrentBlitter());
+		if (ptr != NULL && !_spritecache_overflowed) {
+			scs->mutex->BeginCritical();
+			((MemBlock *)ptr - 1)->sprite = sprite;
+			sc->ptr = ptr;
+			scs->mutex->EndCritical();
+		}
+	}
+	FioUnlock();
+	return ptr;
+}
+
+/**
+ * Read a sprite from disk and encode it for a blitter other than the current
+ * one, bypassing the sprite cache; e.g. to compare blitters.
+ * @param sprite Sprite to read; it must be a normal sprite.
+ * @param blitter Blitter to encode the sprite for.
+ * @param allocator Allocator function to use.
+ * @return Sprite raw data.
+ */
+void *GetRawSpriteForBlitter(SpriteID sprite, Blitter *blitter, AllocatorProc *allocator)
+{
+	assert(SpriteExists(sprite) && GetSpriteType(sprite) == ST_NORMAL);
+
+	FioLock();
+	void *ptr = ReadSprite(GetSpriteCache(sprite), sprite, ST_NORMAL, allocator, blitter);
+	FioUnlock();
+	return ptr;
+}
+
+/**
+ * Start or stop sharing the sprite cache with other threads. While it is
+ * shared, any thread may read sprites and no sprite is removed from the
+ * cache, so the sprites a thread read stay valid until sharing stops.
+ * Only the main thread may start and stop sharing, while no other thread
+ * reads sprites.
+ * @param shared Whether the cache is shared from now on.
+ */
+void SetSpriteCacheShared(bool shared)
+{
+	if (shared == _spritecache_shared) return;
+
+	if (_spritecache_shards[0].mutex == NULL) {
+		for (uint shard = 0; shard < MAX_SPRITE_CACHE_SHARDS; shard++) {
+			_spritecache_shards[shard].mutex = ThreadMutex::New();
+		}
+		FioEnableLocking();
+	}
+	_spritecache_shared = shared;
+
+	if (!shared) {
+		/* The sprites that did not fit are not used anymore. */
+		for (void **data = _spritecache_overflow.Begin(); data != _spritecache_overflow.End(); data++) free(*data);
+		_spritecache_overflow.Clear();
+	}
+}
+
+/**
+ * Read the sprites of the prefetch queue in the background. The newest
+ * sprites are read first, as they are the most likely to be drawn soon.
+ * They are read into memory outside the sprite cache; the main thread adds
+ * them to the cache, see #AddPrefetchedSprites.
+ */
+static void SpritePrefetchThread(void *)
+{
+	for (;;) {
+		_sprite_prefetch_mutex->BeginCritical();
+		while (_sprite_prefetch_queue.Length() == 0 && !_sprite_prefetch_exit) _sprite_prefetch_mutex->WaitForSignal();
+		if (_sprite_prefetch_exit) {
+			_sprite_prefetch_mutex->EndCritical();
+			return;
+		}
+		SpriteID sprite = _sprite_prefetch_queue.End()[-1];
+		_sprite_prefetch_queue.Resize(_sprite_prefetch_queue.Length() - 1);
+		uint generation = _sprite_prefetch_generation;
+		_sprite_prefetch_mutex->EndCritical();
+
+		FioLock();
+		/* The sprites may have been reloaded while waiting for the files. */
+		if (generation == _sprite_prefetch_generation) {
+			MemBlock *block = (MemBlock *)ReadSprite(GetSpriteCache(sprite), sprite, ST_NORMAL, AllocPrefetchedSprite, BlitterFactory::GetCurrentBlitter()) - 1;
+			block->sprite = sprite;
+
+			_sprite_prefetch_mutex->BeginCritical();
+			*_sprite_prefetch_done.Append() = block;
+			_sprite_prefetch_mutex->EndCritical();
+		}
+		FioUnlock();
+	}
+}
+
+/**
+ * Start reading sprites in the background, if there is a processor core to
+ * spare for it. Only the main thread may call this.
+ * @return Whether sprites are read in the background, see #PrefetchSprite.
+ */
+bool StartSpritePrefetching()
+{
+	if (_sprite_prefetch_mutex != NULL) return true;
+	if (_sprite_prefetch_failed) return false;
+
+	if (GetCPUCoreCount() > 1) {
+		FioEnableLocking();
+		_sprite_prefetch_mutex = ThreadMutex::New();
+		if (ThreadObject::New(&SpritePrefetchThread, NULL, &_sprite_prefetch_thread, "ottd:sprites")) return true;
+
+		delete _sprite_prefetch_mutex;
+		_sprite_prefetch_mutex = NULL;
+	}
+
+	DEBUG(sprite, 1, "Cannot read sprites in the background");
+	_sprite_prefetch_failed = true;
+	return false;
+}
+
+/** Stop reading sprites in the background and wait for the thread to finish, e.g. before shutting down. */
+void StopSpritePrefetching()
+{
+	if (_sprite_prefetch_mutex == NULL) return;
+
+	_sprite_prefetch_mutex->BeginCritical();
+	_sprite_prefetch_exit = true;
+	_sprite_prefetch_mutex->SendSignal();
+	_sprite_prefetch_mutex->EndCritical();
+
+	_sprite_prefetch_thread->Join();
+	delete _sprite_prefetch_thread;
+	_sprite_prefetch_thread = NULL;
+
+	ClearPrefetchedSprites();
+	delete _sprite_prefetch_mutex;
+	_sprite_prefetch_mutex = NULL;
+	_sprite_prefetch_exit = false;
 }
 
+/**
+ * Queue a sprite for reading it in the background, when it is not in the
+ * sprite cache yet, so it likely is by the time it is drawn. Only the main
+ * thread may prefetch sprites, after #StartSpritePrefetching succeeded.
+ * @param sprite The sprite, which is drawn as #ST_NORMAL sprite.
+ * @return Whether the sprite is in the cache.
+ */
+bool PrefetchSprite(SpriteID sprite)
+{
+	if (!SpriteExists(sprite)) return false;
+
+	SpriteCache *sc = GetSpriteCache(sprite);
+	if (sc->ptr != NULL) return true;
+	if (sc->type != ST_NORMAL || sc->prefetching) return false;
+
+	_sprite_prefetch_mutex->BeginCritical();
+	if (_sprite_prefetch_queue.Length() == SPRITE_PREFETCH_QUEUE_SIZE) {
+		/* The oldest sprite in the queue is the least likely to be drawn soon. */
+		GetSpriteCache(_sprite_prefetch_queue[0])->prefetching = false;
+		_sprite_prefetch_queue.ErasePreservingOrder(0);
+	}
+	*_sprite_prefetch_queue.Append() = sprite;
+	sc->prefetching = true;
+	_sprite_prefetch_mutex->SendSignal();
+	_sprite_prefetch_mutex->EndCritical();
+
+	return false;
+}
+
+/** Add the sprites that are read in the background to the sprite cache, unless they were read by the main thread meanwhile. */
+static void AddPrefetchedSprites()
+{
+	if (_sprite_prefetch_mutex == NULL) return;
+
+	_sprite_prefetch_mutex->BeginCritical();
+	for (MemBlock **it = _sprite_prefetch_done.Begin(); it != _sprite_prefetch_done.End(); it++) {
+		MemBlock *block = *it;
+		SpriteID sprite = (SpriteID)block->sprite;
+		SpriteCache *sc = GetSpriteCache(sprite);
+		sc->prefetching = false;
+
+		if (sc->ptr == NULL) {
+			uint shard = GetSpriteCacheShard(sprite);
+			size_t size = block->size - sizeof(MemBlock);
+			_spritecache_alloc_shard = shard;
+			sc->ptr = AllocSprite(size);
+			MemCpyT((byte *)sc->ptr, block->data, size);
+			((MemBlock *)sc->ptr - 1)->sprite = sprite;
+			sc->lru = ++_spritecache_shards[shard].lru_counter;
+		}
+		free(block);
+	}
+	_sprite_prefetch_done.Clear();
+	_sprite_prefetch_mutex->EndCritical();
+}
+
+/** Forget the sprites that are read in the background, as the sprites or the way they are read change. */
+static void ClearPrefetchedSprites()
+{
+	if (_sprite_prefetch_mutex == NULL) return;
+
+	FioLock();
+	_sprite_prefetch_mutex->BeginCritical();
+	_sprite_prefetch_generation++;
+	_sprite_prefetch_queue.Clear();
+	for (MemBlock **it = _sprite_prefetch_done.Begin(); it != _sprite_prefetch_done.End(); it++) free(*it);
+	_sprite_prefetch_done.Clear();
+	_sprite_prefetch_mutex->EndCritical();
+	FioUnlock();
+
+	for (uint i = 0; i != _spritecache_items; i++) GetSpriteCache(i)->prefetching = false;
+}
 
 static void GfxInitSpriteCache()
 {
@@ -918,14 +1289,23 @@ static void GfxInitSpriteCache()
 		}
 	}
 
-	/* A big free block */
-	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
-	/* Sentinel block (identified by size == 0) */
-	NextBlock(_spritecache_ptr)->size = 0;
+	/* Split the memory in equal parts, one for each part of the cache. */
+	_spritecache_shard_count = ClampU(_allocated_sprite_cache_size / MIN_SPRITE_CACHE_SHARD_SIZE, 1, MAX_SPRITE_CACHE_SHARDS);
+	_compact_cache_shard = 0;
+	size_t shard_size = (_allocated_sprite_cache_size / _spritecache_shard_count) & ~S_FREE_MASK;
+	for (uint shard = 0; shard < _spritecache_shard_count; shard++) {
+		MemBlock *ptr = (MemBlock *)((byte *)_spritecache_ptr + shard * shard_size);
+		_spritecache_shards[shard].ptr = ptr;
+		/* A big free block */
+		ptr->size = (shard_size - sizeof(MemBlock)) | S_FREE_MASK;
+		/* Sentinel block (identified by size == 0) */
+		NextBlock(ptr)->size = 0;
+	}
 }
 
 void GfxInitSpriteMem()
 {
+	ClearPrefetchedSprites();
 	GfxInitSpriteCache();
 
 	/* Reset the spritecache 'pool' */
@@ -942,6 +1322,8 @@ void GfxInitSpriteMem()
  */
 void GfxClearSpriteCache()
 {
+	ClearPrefetchedSprites();
+
 	/* Clear sprite ptr for all cached items */
 	for (uint i = 0; i != _spritecache_items; i++) {
 		SpriteCache *sc = GetSpriteCache(i);
@@ -28,6 +28,7 @@ extern uint _sprite_cache_size;
 typedef void *AllocatorProc(size_t size);
 
 void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator = NULL);
+void *GetRawSpriteForBlitter(SpriteID sprite, class Blitter *blitter, AllocatorProc *allocator);
 bool SpriteExists(SpriteID sprite);
 
 SpriteType GetSpriteType(SpriteID sprite);
@@ -48,6 +49,11 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 	return (byte*)GetRawSprite(sprite, type);
 }
 
+void SetSpriteCacheShared(bool shared);
+bool StartSpritePrefetching();
+void StopSpritePrefetching();
+bool PrefetchSprite(SpriteID sprite);
+
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
 void IncreaseSpriteLRU();
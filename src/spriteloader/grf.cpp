@@ -54,41 +54,69 @@ static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
 	return false;
 }
 
+/** Reader of the compressed data of a sprite from the current file. */
+struct FioSpriteReader {
+	/** Read a byte. */
+	inline byte ReadByte()
+	{
+		return FioReadByte();
+	}
+
+	/** Read \a size bytes into \a dest. */
+	inline void ReadBlock(byte *dest, uint size)
+	{
+		for (; size > 0; size--) *dest++ = FioReadByte();
+	}
+};
+
+/** Reader of the compressed data of a sprite straight from the memory mapping of the current file. */
+struct MappedSpriteReader {
+	const byte *pos; ///< Current position in the mapping.
+	const byte *end; ///< End of the mapping, i.e. of the file.
+
+	/** Read a byte; like #FioReadByte there are zeros after the end of the file. */
+	inline byte ReadByte()
+	{
+		return this->pos < this->end ? *this->pos++ : 0;
+	}
+
+	/** Read \a size bytes into \a dest. */
+	inline void ReadBlock(byte *dest, uint size)
+	{
+		uint n = (uint)min<size_t>(size, this->end - this->pos);
+		memcpy(dest, this->pos, n);
+		memset(dest + n, 0, size - n);
+		this->pos += n;
+	}
+};
+
 /**
- * Decode the image data of a single sprite.
- * @param[in,out] sprite Filled with the sprite image data.
- * @param file_slot File slot.
- * @param file_pos File position.
- * @param sprite_type Type of the sprite we're decoding.
- * @param num Size of the decompressed sprite.
- * @param type Type of the encoded sprite.
- * @param zoom_lvl Requested zoom level.
- * @param colour_fmt Colour format of the sprite.
- * @param container_format Container format of the GRF this sprite is in.
- * @return True if the sprite was successfully loaded.
+ * Decompress the data of a sprite.
+ * @param reader The reader of the compressed data.
+ * @param dest_orig Destination of the decompressed data.
+ * @param num Size of the decompressed data.
+ * @param file_slot File slot, for the warning about corrupt sprites.
+ * @param file_pos File position, for the warning about corrupt sprites.
+ * @return True if the data was successfully decompressed.
  */
-bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, int64 num, byte type, ZoomLevel zoom_lvl, byte colour_fmt, byte container_format)
+template <class Reader>
+static bool DecompressSprite(Reader &reader, byte *dest_orig, int64 num, uint8 file_slot, size_t file_pos)
 {
-	AutoFreePtr<byte> dest_orig(MallocT<byte>(num));
 	byte *dest = dest_orig;
-	const int64 dest_size = num;
 
-	/* Read the file, which has some kind of compression */
 	while (num > 0) {
-		int8 code = FioReadByte();
+		int8 code = reader.ReadByte();
 
 		if (code >= 0) {
 			/* Plain bytes to read */
 			int size = (code == 0) ? 0x80 : code;
 			num -= size;
 			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-			for (; size > 0; size--) {
-				*dest = FioReadByte();
-				dest++;
-			}
+			reader.ReadBlock(dest, size);
+			dest += size;
 		} else {
 			/* Copy bytes from earlier in the sprite */
-			const uint data_offset = ((code & 7) << 8) | FioReadByte();
+			const uint data_offset = ((code & 7) << 8) | reader.ReadByte();
 			if (dest - data_offset < dest_orig) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
 			int size = -(code >> 3);
 			num -= size;
@@ -101,6 +129,41 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 	}
 
 	if (num != 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+	return true;
+}
+
+/**
+ * Decode the image data of a single sprite.
+ * @param[in,out] sprite Filled with the sprite image data.
+ * @param file_slot File slot.
+ * @param file_pos File position.
+ * @param sprite_type Type of the sprite we're decoding.
+ * @param num Size of the decompressed sprite.
+ * @param type Type of the encoded sprite.
+ * @param zoom_lvl Requested zoom level.
+ * @param colour_fmt Colour format of the sprite.
+ * @param container_format Container format of the GRF this sprite is in.
+ * @return True if the sprite was successfully loaded.
+ */
+bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, int64 num, byte type, ZoomLevel zoom_lvl, byte colour_fmt, byte container_format)
+{
+	AutoFreePtr<byte> dest_orig(MallocT<byte>(num));
+	byte *dest = dest_orig;
+	const int64 dest_size = num;
+
+	/* Read the file, which has some kind of compression */
+	size_t mapped_size;
+	const byte *mapped = FioGetMappedData(&mapped_size);
+	if (mapped != NULL) {
+		MappedSpriteReader reader = { mapped, mapped + mapped_size };
+		bool valid = DecompressSprite(reader, dest_orig, num, file_slot, file_pos);
+		/* Continue in the file after the data that is read from the mapping. */
+		FioSkipBytes(reader.pos - mapped);
+		if (!valid) return false;
+	} else {
+		FioSpriteReader reader;
+		if (!DecompressSprite(reader, dest_orig, num, file_slot, file_pos)) return false;
+	}
 
 	sprite->AllocateData(zoom_lvl, sprite->width * sprite->height);
 
@@ -26,6 +26,7 @@
 #include "core/random_func.hpp"
 #include "linkgraph/linkgraph.h"
 #include "linkgraph/linkgraphschedule.h"
+#include "economy_func.h"
 
 #include "table/strings.h"
 
@@ -82,6 +83,8 @@ Station::~Station()
 		return;
 	}
 
+	CountStationForRating(this, -1);
+
 	while (!this->loading_vehicles.empty()) {
 		this->loading_vehicles.front()->LeaveStation();
 	}
@@ -190,8 +193,10 @@ void Station::AddFacility(StationFacility new_facility_bit, TileIndex facil_xy)
 		this->xy = facil_xy;
 		this->random_bits = Random();
 	}
+	CountStationForRating(this, -1);
 	this->facilities |= new_facility_bit;
 	this->owner = _current_company;
+	CountStationForRating(this, 1);
 	this->build_date = _date;
 }
 
@@ -26,6 +26,7 @@
 #include "newgrf_station.h"
 #include "newgrf_canal.h" /* For the buoy */
 #include "pathfinder/yapf/yapf_cache.h"
+#include "pathfinder/water_regions.h"
 #include "road_internal.h" /* For drawing catenary/checking road removal */
 #include "autoslope.h"
 #include "water.h"
@@ -45,6 +46,7 @@
 #include "debug.h"
 #include "core/random_func.hpp"
 #include "company_base.h"
+#include "economy_func.h"
 #include "table/airporttile_ids.h"
 #include "newgrf_airporttiles.h"
 #include "order_backup.h"
@@ -1558,7 +1560,9 @@ CommandCost RemoveFromRailBaseStation(TileArea ta, SmallVector<T *, 4> &affected
 
 		/* if we deleted the whole station, delete the train facility. */
 		if (st->train_station.tile == INVALID_TILE) {
+			CountStationForRating(st, -1);
 			st->facilities &= ~FACIL_TRAIN;
+			CountStationForRating(st, 1);
 			SetWindowWidgetDirty(WC_STATION_VIEW, st->index, WID_SV_TRAINS);
 			st->UpdateVirtCoord();
 			DeleteStationIfEmpty(st);
@@ -1866,6 +1870,7 @@ CommandCost CmdBuildRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 			DirtyCompanyInfrastructureWindows(st->owner);
 
 			MarkTileDirtyByTile(cur_tile);
+			YapfNotifyRoadLayoutChange(cur_tile);
 		}
 	}
 
@@ -1942,7 +1947,9 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags)
 			*primary_stop = cur_stop->next;
 			/* removed the only stop? */
 			if (*primary_stop == NULL) {
+				CountStationForRating(st, -1);
 				st->facilities &= (is_truck ? ~FACIL_TRUCK_STOP : ~FACIL_BUS_STOP);
+				CountStationForRating(st, 1);
 			}
 		} else {
 			/* tell the predecessor in the list to skip this stop */
@@ -1972,6 +1979,7 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags)
 
 		SetWindowWidgetDirty(WC_STATION_VIEW, st->index, WID_SV_ROADVEHS);
 		delete cur_stop;
+		YapfNotifyRoadLayoutChange(tile);
 
 		/* Make sure no vehicle is going to the old roadstop */
 		RoadVehicle *v;
@@ -2379,7 +2387,9 @@ static CommandCost RemoveAirport(TileIndex tile, DoCommandFlag flags)
 		st->rect.AfterRemoveRect(st, st->airport);
 
 		st->airport.Clear();
+		CountStationForRating(st, -1);
 		st->facilities &= ~FACIL_AIRPORT;
+		CountStationForRating(st, 1);
 
 		InvalidateWindowData(WC_STATION_VIEW, st->index, -1);
 
@@ -2539,6 +2549,8 @@ CommandCost CmdBuildDock(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 		DirtyCompanyInfrastructureWindows(st->owner);
 
 		MakeDock(tile, st->owner, st->index, direction, wc);
+		InvalidateWaterRegion(tile);
+		InvalidateWaterRegion(tile_cur);
 
 		st->UpdateVirtCoord();
 		UpdateStationAcceptance(st, false);
@@ -2581,7 +2593,9 @@ static CommandCost RemoveDock(TileIndex tile, DoCommandFlag flags)
 		st->rect.AfterRemoveTile(st, tile2);
 
 		st->dock_tile = INVALID_TILE;
+		CountStationForRating(st, -1);
 		st->facilities &= ~FACIL_DOCK;
+		CountStationForRating(st, 1);
 
 		Company::Get(st->owner)->infrastructure.station -= 2;
 		DirtyCompanyInfrastructureWindows(st->owner);
@@ -3263,8 +3277,10 @@ static void UpdateStationRating(Station *st)
 {
 	bool waiting_changed = false;
 
+	CountStationForRating(st, -1);
 	byte_inc_sat(&st->time_since_load);
 	byte_inc_sat(&st->time_since_unload);
+	CountStationForRating(st, 1);
 
 	const CargoSpec *cs;
 	FOR_ALL_CARGOSPECS(cs) {
@@ -3913,6 +3929,7 @@ void BuildOilRig(TileIndex tile)
 	assert(IsTileType(tile, MP_INDUSTRY));
 	DeleteAnimatedTile(tile);
 	MakeOilrig(tile, st->index, GetWaterClass(tile));
+	InvalidateWaterRegion(tile);
 
 	st->owner = OWNER_NONE;
 	st->airport.type = AT_OILRIG;
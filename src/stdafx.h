@@ -151,6 +151,7 @@
 	/* Warn about functions using 'printf' format syntax. First argument determines which parameter
 	 * is the format string, second argument is start of values passed to printf. */
 	#define WARN_FORMAT(string, args) __attribute__ ((format (printf, string, args)))
+	#define THREAD_LOCAL __thread
 	#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)
 		#define FINAL final
 	#else
@@ -246,6 +247,7 @@
 	#define GCC_PACK
 	#define WARN_FORMAT(string, args)
 	#define FINAL sealed
+	#define THREAD_LOCAL __declspec(thread)
 
 	/* fallthrough attribute, VS 2017 */
 	#if (_MSC_VER >= 1910)
@@ -308,6 +310,12 @@
 	#define stredup _stredup
 #endif /* WINCE */
 
+/* Compilers without thread local variables; everything that needs them is done by the main thread only. */
+#if !defined(THREAD_LOCAL)
+	#define THREAD_LOCAL
+	#define NO_THREAD_LOCAL
+#endif
+
 /* NOTE: the string returned by these functions is only valid until the next
  * call to the same function and is not thread- or reentrancy-safe */
 #if !defined(STRGEN) && !defined(SETTINGSGEN)
@@ -18,6 +18,8 @@
 #include "object_base.h"
 #include "company_base.h"
 #include "company_func.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 
@@ -322,6 +324,11 @@ CommandCost CmdTerraformLand(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 		for (TileIndexSet::const_iterator it = ts.dirty_tiles.begin(); it != ts.dirty_tiles.end(); it++) {
 			MarkTileDirtyByTile(*it);
 
+			/* Slopes are part of the path finder costs of tracks and roads, and decide where ships can go. */
+			YapfNotifyTrackLayoutChange(*it, INVALID_TRACK);
+			YapfNotifyRoadLayoutChange(*it);
+			InvalidateWaterRegion(*it);
+
 			int height = TerraformGetHeightOfTile(&ts, *it);
 
 			/* Now, if we alter the height of the map edge, we need to take care
@@ -0,0 +1,243 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_pool.cpp Implementation of the pool of worker threads. */
+
+#include "../stdafx.h"
+#include "../core/alloc_func.hpp"
+#include "../core/math_func.hpp"
+#include "../debug.h"
+#include "worker_pool.h"
+
+#include "../safeguards.h"
+
+/** Number of threads used for parallel work, including the main thread. 0 means one per processor core. */
+uint _worker_threads = 0;
+
+/* static */ WorkerPool *WorkerPool::instance = NULL;
+
+/** Create an empty job set. */
+WorkerJobSet::WorkerJobSet() : mutex(ThreadMutex::New()), pending(0)
+{
+}
+
+/** Destroy the job set. All jobs in it must have finished. */
+WorkerJobSet::~WorkerJobSet()
+{
+	assert(this->pending == 0);
+	delete this->mutex;
+}
+
+/**
+ * Check whether all jobs of this set are done, without blocking.
+ * @return True if no job of this set is queued or running.
+ */
+bool WorkerJobSet::IsFinished()
+{
+	ThreadMutexLocker lock(this->mutex);
+	return this->pending == 0;
+}
+
+/** Mark one job of this set as done, and wake up whoever waits for the set. */
+void WorkerJobSet::Finish()
+{
+	ThreadMutexLocker lock(this->mutex);
+	assert(this->pending > 0);
+	if (--this->pending == 0) this->mutex->SendSignal();
+}
+
+/**
+ * Start the worker threads.
+ * @param workers Number of threads to start. Fewer might be started if the OS does not let us.
+ */
+WorkerPool::WorkerPool(uint workers) : mutex(ThreadMutex::New()), exit(false)
+{
+	for (uint i = 0; i < workers; i++) {
+		ThreadObject *thread;
+		if (!ThreadObject::New(&WorkerPool::WorkerThreadProc, this, &thread, "ottd:worker")) break;
+		*this->threads.Append() = thread;
+	}
+	DEBUG(misc, 1, "Started %u worker threads", this->threads.Length());
+}
+
+/** Stop all worker threads after they finished the queued jobs. */
+WorkerPool::~WorkerPool()
+{
+	this->mutex->BeginCritical();
+	this->exit = true;
+	this->mutex->SendSignal();
+	this->mutex->EndCritical();
+
+	for (ThreadObject **thread = this->threads.Begin(); thread != this->threads.End(); thread++) {
+		(*thread)->Join();
+		delete *thread;
+	}
+	assert(this->queue.empty());
+	delete this->mutex;
+}
+
+/**
+ * Main loop of the worker threads.
+ * @param pool The pool the thread belongs to.
+ */
+/* static */ void WorkerPool::WorkerThreadProc(void *pool)
+{
+	WorkerPool *self = (WorkerPool *)pool;
+	for (;;) {
+		self->mutex->BeginCritical();
+		while (self->queue.empty() && !self->exit) self->mutex->WaitForSignal();
+		if (self->queue.empty()) {
+			/* Pass the exit request on to the next worker; a signal only wakes one thread. */
+			self->mutex->SendSignal();
+			self->mutex->EndCritical();
+			return;
+		}
+		Job job = self->queue.front();
+		self->queue.pop_front();
+		/* Signals might have been merged, so make sure the remaining jobs get picked up. */
+		if (!self->queue.empty()) self->mutex->SendSignal();
+		self->mutex->EndCritical();
+
+		RunJob(job);
+	}
+}
+
+/**
+ * Take a job from the queue.
+ * @param[out] job Job that was taken.
+ * @param set Only take jobs of this set, or any job if NULL.
+ * @return True if a job was taken.
+ */
+bool WorkerPool::PopJob(Job *job, const WorkerJobSet *set)
+{
+	ThreadMutexLocker lock(this->mutex);
+	for (std::deque<Job>::iterator it = this->queue.begin(); it != this->queue.end(); ++it) {
+		if (set != NULL && it->set != set) continue;
+		*job = *it;
+		this->queue.erase(it);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Execute a job and mark it as finished in its set.
+ * @param job Job to execute.
+ */
+/* static */ void WorkerPool::RunJob(const Job &job)
+{
+	job.proc(job.param);
+	if (job.set != NULL) job.set->Finish();
+}
+
+/**
+ * Queue a job for execution on one of the workers.
+ * @param proc Function to call.
+ * @param param Parameter for the function; must stay valid until the job finished.
+ * @param set Set to add the job to, so it can be waited for. When there are no
+ *            worker threads the job is only executed when waiting for this set.
+ */
+void WorkerPool::Enqueue(WorkerJobProc proc, void *param, WorkerJobSet *set)
+{
+	assert(set != NULL);
+	set->mutex->BeginCritical();
+	set->pending++;
+	set->mutex->EndCritical();
+
+	ThreadMutexLocker lock(this->mutex);
+	Job job = { proc, param, set };
+	this->queue.push_back(job);
+	this->mutex->SendSignal();
+}
+
+/**
+ * Wait until all jobs of a set have finished. Jobs of the set that did not
+ * start yet are run by the calling thread in the meantime.
+ * @param set Set to wait for.
+ */
+void WorkerPool::Wait(WorkerJobSet *set)
+{
+	Job job;
+	while (this->PopJob(&job, set)) RunJob(job);
+
+	/* All remaining jobs of the set are running on a worker. */
+	ThreadMutexLocker lock(set->mutex);
+	while (set->pending != 0) set->mutex->WaitForSignal();
+}
+
+/** Parameters of one part of a job split up by RunRange. */
+struct WorkerRange {
+	WorkerRangeProc proc; ///< Function to call.
+	void *param;          ///< Parameter for the function.
+	uint first;           ///< First index to process.
+	uint last;            ///< One past the last index to process.
+};
+
+/**
+ * Run one part of a job split up by RunRange.
+ * @param param The WorkerRange describing the part.
+ */
+static void RunWorkerRange(void *param)
+{
+	WorkerRange *range = (WorkerRange *)param;
+	range->proc(range->param, range->first, range->last);
+}
+
+/**
+ * Run a job over the indices [0, count) split over all workers and the calling
+ * thread, and wait for it to finish. The split does not depend on timing, but
+ * parts may run concurrently and in any order, so the job must not write to
+ * data that is shared between indices.
+ * @param proc Function to call for each part.
+ * @param param Parameter for the function.
+ * @param count Number of indices to process.
+ * @param min_chunk Minimum number of indices in a part, so small jobs are not split needlessly.
+ */
+void WorkerPool::RunRange(WorkerRangeProc proc, void *param, uint count, uint min_chunk)
+{
+	if (count == 0) return;
+
+	uint parts = min<uint>(count / max<uint>(min_chunk, 1), (this->GetWorkerCount() + 1) * 4);
+	if (this->GetWorkerCount() == 0 || parts <= 1) {
+		proc(param, 0, count);
+		return;
+	}
+
+	WorkerRange *ranges = AllocaM(WorkerRange, parts);
+	WorkerJobSet set;
+	for (uint i = 0; i < parts; i++) {
+		ranges[i].proc = proc;
+		ranges[i].param = param;
+		ranges[i].first = (uint)((uint64)count * i / parts);
+		ranges[i].last = (uint)((uint64)count * (i + 1) / parts);
+		this->Enqueue(&RunWorkerRange, &ranges[i], &set);
+	}
+	this->Wait(&set);
+}
+
+/**
+ * Get the shared worker pool, starting it if needed.
+ * @note The first call must be made from the main thread.
+ * @return The pool.
+ */
+/* static */ WorkerPool *WorkerPool::Get()
+{
+	if (WorkerPool::instance == NULL) {
+		uint threads = _worker_threads != 0 ? _worker_threads : GetCPUCoreCount();
+		WorkerPool::instance = new WorkerPool(max<uint>(threads, 1) - 1);
+	}
+	return WorkerPool::instance;
+}
+
+/** Stop the shared worker pool, if it was started. */
+/* static */ void WorkerPool::Uninitialize()
+{
+	delete WorkerPool::instance;
+	WorkerPool::instance = NULL;
+}
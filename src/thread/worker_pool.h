@@ -0,0 +1,92 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_pool.h Pool of persistent worker threads for running independent jobs. */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "thread.h"
+#include "../core/smallvec_type.hpp"
+#include <deque>
+
+/** Function executed for a single job on a worker. */
+typedef void (*WorkerJobProc)(void *param);
+
+/** Function executed for the range [first, last) of a split up job. */
+typedef void (*WorkerRangeProc)(void *param, uint first, uint last);
+
+/**
+ * A group of jobs that can be waited upon as a whole.
+ * The results of the jobs may only be used after the set has finished.
+ */
+class WorkerJobSet {
+	friend class WorkerPool;
+
+	ThreadMutex *mutex; ///< Mutex protecting the pending count.
+	uint pending;       ///< Number of jobs that did not finish yet.
+
+	void Finish();
+
+public:
+	WorkerJobSet();
+	~WorkerJobSet();
+
+	bool IsFinished();
+};
+
+/**
+ * Pool of worker threads. Jobs are started in the order they are enqueued,
+ * but may finish in any order. Anything that has to be deterministic must
+ * therefore only depend on the data a job was given and not on the order
+ * in which jobs are executed.
+ * When no threads can be started all jobs are run by the thread that
+ * waits for them, so the results are the same either way.
+ */
+class WorkerPool {
+private:
+	/** A single unit of work. */
+	struct Job {
+		WorkerJobProc proc; ///< Function to call.
+		void *param;        ///< Parameter for the function.
+		WorkerJobSet *set;  ///< Set this job belongs to.
+	};
+
+	ThreadMutex *mutex;                  ///< Mutex protecting the queue; idle workers wait on it.
+	std::deque<Job> queue;               ///< Jobs that have not been started yet.
+	SmallVector<ThreadObject *, 8> threads; ///< The worker threads.
+	bool exit;                           ///< Whether the workers should stop.
+
+	static WorkerPool *instance;         ///< The shared pool.
+
+	static void WorkerThreadProc(void *pool);
+	bool PopJob(Job *job, const WorkerJobSet *set);
+	static void RunJob(const Job &job);
+
+public:
+	WorkerPool(uint workers);
+	~WorkerPool();
+
+	/**
+	 * Get the number of threads running jobs, excluding the thread waiting for them.
+	 * @return The number of worker threads.
+	 */
+	inline uint GetWorkerCount() const { return this->threads.Length(); }
+
+	void Enqueue(WorkerJobProc proc, void *param, WorkerJobSet *set);
+	void Wait(WorkerJobSet *set);
+	void RunRange(WorkerRangeProc proc, void *param, uint count, uint min_chunk);
+
+	static WorkerPool *Get();
+	static void Uninitialize();
+};
+
+extern uint _worker_threads;
+
+#endif /* WORKER_POOL_H */
@@ -0,0 +1,166 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file tick_profiler.cpp Measuring the time spent in the parts of the game loop. */
+
+#include "stdafx.h"
+#include "tick_profiler.h"
+#include "core/bitmath_func.hpp"
+#include "core/math_func.hpp"
+
+#if defined(WIN32)
+#	include <windows.h>
+#else
+#	include <sys/time.h>
+#endif
+
+#include "safeguards.h"
+
+/** Timings of a single tick, in microseconds. */
+struct TickProfile {
+	uint32 phase[TP_END];                     ///< Time spent per phase.
+	uint32 total;                             ///< Time spent in the whole game loop.
+	uint32 script_time[TICK_PROFILE_SCRIPTS]; ///< Time spent per script.
+	uint32 script_ops[TICK_PROFILE_SCRIPTS];  ///< Opcodes executed per script.
+	uint16 script_ran;                        ///< Bitmask of the scripts that ran in this tick.
+};
+assert_compile(TICK_PROFILE_SCRIPTS <= 16);
+
+static TickProfile _tick_profiles[TICK_PROFILE_LENGTH]; ///< Ring buffer with the timings of the last ticks.
+static uint _tick_profile_pos = 0;   ///< Position in the ring buffer of the current tick.
+static uint _tick_profile_count = 0; ///< Number of finished ticks in the ring buffer.
+static uint64 _tick_start = 0;       ///< Time the current tick started.
+
+/** Names of the phases, for printing. */
+static const char * const _tick_phase_names[] = {
+	"animated tiles",
+	"date",
+	"tile loop",
+	"vehicles",
+	"landscape",
+	"ai",
+	"game script",
+};
+assert_compile(lengthof(_tick_phase_names) == TP_END);
+
+/**
+ * Get a high resolution timestamp.
+ * @return Time in microseconds since some arbitrary moment.
+ */
+uint64 GetProfilerTime()
+{
+#if defined(WIN32)
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (uint64)(counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timeval tim;
+	gettimeofday(&tim, NULL);
+	return (uint64)tim.tv_sec * 1000000 + tim.tv_usec;
+#endif
+}
+
+/** Start measuring a new tick; clears the oldest entry of the ring buffer. */
+void TickProfilerBeginTick()
+{
+	memset(&_tick_profiles[_tick_profile_pos], 0, sizeof(_tick_profiles[_tick_profile_pos]));
+	_tick_start = GetProfilerTime();
+}
+
+/** Finish measuring the current tick and make it part of the statistics. */
+void TickProfilerEndTick()
+{
+	_tick_profiles[_tick_profile_pos].total = (uint32)min<uint64>(GetProfilerTime() - _tick_start, UINT32_MAX);
+	_tick_profile_pos = (_tick_profile_pos + 1) % TICK_PROFILE_LENGTH;
+	if (_tick_profile_count < TICK_PROFILE_LENGTH) _tick_profile_count++;
+}
+
+/**
+ * Add time to a phase of the current tick.
+ * @param phase The phase.
+ * @param time Time in microseconds.
+ */
+void TickProfilerAddPhase(TickPhase phase, uint64 time)
+{
+	assert(phase < TP_END);
+	uint32 &t = _tick_profiles[_tick_profile_pos].phase[phase];
+	t = (uint32)min<uint64>(t + time, UINT32_MAX);
+}
+
+/**
+ * Record that a script ran in the current tick.
+ * @param slot The company of the AI, or #TICK_PROFILE_GAMESCRIPT.
+ * @param time Time in microseconds the script ran.
+ * @param ops Number of opcodes the script executed.
+ */
+void TickProfilerAddScript(uint slot, uint64 time, uint32 ops)
+{
+	assert(slot < TICK_PROFILE_SCRIPTS);
+	TickProfile &tp = _tick_profiles[_tick_profile_pos];
+	tp.script_time[slot] = (uint32)min<uint64>(tp.script_time[slot] + time, UINT32_MAX);
+	tp.script_ops[slot] += ops;
+	SetBit(tp.script_ran, slot);
+}
+
+/**
+ * Summarise the timings of the last ticks.
+ * @param[out] summary The summary.
+ * @param ticks Number of ticks to summarise; less if not that many ticks have been measured yet.
+ */
+void GetTickProfileSummary(TickProfileSummary *summary, uint ticks)
+{
+	memset(summary, 0, sizeof(*summary));
+	summary->ticks = min(ticks, _tick_profile_count);
+	if (summary->ticks == 0) return;
+
+	uint64 phase_sum[TP_END] = { 0 };
+	uint64 total_sum = 0;
+	uint64 script_time_sum[TICK_PROFILE_SCRIPTS] = { 0 };
+	uint64 script_ops_sum[TICK_PROFILE_SCRIPTS] = { 0 };
+
+	for (uint i = 1; i <= summary->ticks; i++) {
+		const TickProfile &tp = _tick_profiles[(_tick_profile_pos + TICK_PROFILE_LENGTH - i) % TICK_PROFILE_LENGTH];
+		for (TickPhase p = TP_BEGIN; p < TP_END; p++) {
+			phase_sum[p] += tp.phase[p];
+			summary->phase_max[p] = max(summary->phase_max[p], tp.phase[p]);
+		}
+		total_sum += tp.total;
+		summary->total_max = max(summary->total_max, tp.total);
+
+		for (uint s = 0; s < TICK_PROFILE_SCRIPTS; s++) {
+			if (!HasBit(tp.script_ran, s)) continue;
+			summary->script_active[s] = true;
+			script_time_sum[s] += tp.script_time[s];
+			script_ops_sum[s] += tp.script_ops[s];
+		}
+	}
+
+	for (TickPhase p = TP_BEGIN; p < TP_END; p++) {
+		summary->phase_avg[p] = (uint32)(phase_sum[p] / summary->ticks);
+	}
+	summary->total_avg = (uint32)(total_sum / summary->ticks);
+	for (uint s = 0; s < TICK_PROFILE_SCRIPTS; s++) {
+		summary->script_time[s] = (uint32)(script_time_sum[s] / summary->ticks);
+		summary->script_ops[s] = (uint32)(script_ops_sum[s] / summary->ticks);
+	}
+}
+
+/**
+ * Get the name of a phase of the game loop.
+ * @param phase The phase.
+ * @return The name.
+ */
+const char *GetTickPhaseName(TickPhase phase)
+{
+	assert(phase < TP_END);
+	return _tick_phase_names[phase];
+}
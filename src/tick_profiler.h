@@ -0,0 +1,84 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file tick_profiler.h Measuring the time spent in the parts of the game loop. */
+
+#ifndef TICK_PROFILER_H
+#define TICK_PROFILER_H
+
+#include "core/enum_type.hpp"
+#include "company_type.h"
+
+/** Parts of the game loop that are timed separately. */
+enum TickPhase {
+	TP_BEGIN = 0,
+	TP_ANIMATED_TILES = 0, ///< Animating the animated tiles.
+	TP_DATE,               ///< Increasing the date, including the daily, monthly and yearly loops.
+	TP_TILE_LOOP,          ///< The tile loop.
+	TP_VEHICLES,           ///< Ticking the vehicles.
+	TP_LANDSCAPE,          ///< The landscape tick; towns, industries, disasters and the like.
+	TP_AI,                 ///< Running the AIs.
+	TP_GAMESCRIPT,         ///< Running the game script.
+	TP_END,                ///< End marker.
+};
+DECLARE_POSTFIX_INCREMENT(TickPhase)
+
+/** Number of ticks of which the timings are kept. */
+static const uint TICK_PROFILE_LENGTH = 256;
+
+/** Slots for the script timings; one for each company and one for the game script. */
+static const uint TICK_PROFILE_SCRIPTS = MAX_COMPANIES + 1;
+
+/** Slot for the game script timings. */
+static const uint TICK_PROFILE_GAMESCRIPT = MAX_COMPANIES;
+
+/** Timings of the game loop averaged over a number of ticks; times are in microseconds. */
+struct TickProfileSummary {
+	uint ticks;                                 ///< Number of ticks the summary is made of.
+	uint32 phase_avg[TP_END];                   ///< Average time per phase.
+	uint32 phase_max[TP_END];                   ///< Maximum time per phase.
+	uint32 total_avg;                           ///< Average time of the whole game loop.
+	uint32 total_max;                           ///< Maximum time of the whole game loop.
+	bool script_active[TICK_PROFILE_SCRIPTS];   ///< Whether the script ran during these ticks.
+	uint32 script_time[TICK_PROFILE_SCRIPTS];   ///< Average time per tick of the script.
+	uint32 script_ops[TICK_PROFILE_SCRIPTS];    ///< Average opcodes executed per tick by the script.
+};
+
+uint64 GetProfilerTime();
+
+void TickProfilerBeginTick();
+void TickProfilerEndTick();
+void TickProfilerAddPhase(TickPhase phase, uint64 time);
+void TickProfilerAddScript(uint slot, uint64 time, uint32 ops);
+void GetTickProfileSummary(TickProfileSummary *summary, uint ticks);
+const char *GetTickPhaseName(TickPhase phase);
+
+/**
+ * Measures the time between its construction and destruction and adds it
+ * to the given phase of the current tick.
+ */
+class TickPhaseTimer {
+	TickPhase phase; ///< Phase the time is added to.
+	uint64 start;    ///< Time the measurement started.
+
+public:
+	/**
+	 * Start measuring.
+	 * @param phase The phase that is measured.
+	 */
+	TickPhaseTimer(TickPhase phase) : phase(phase), start(GetProfilerTime()) {}
+
+	/** Stop measuring and record the time. */
+	~TickPhaseTimer()
+	{
+		TickProfilerAddPhase(this->phase, GetProfilerTime() - this->start);
+	}
+};
+
+#endif /* TICK_PROFILER_H */
@@ -15,6 +15,8 @@
 #include "command_func.h"
 #include "pathfinder/npf/npf_func.h"
 #include "pathfinder/yapf/yapf.hpp"
+#include "pathfinder/pf_record.h"
+#include "pathfinder/pf_budget.h"
 #include "news_func.h"
 #include "company_func.h"
 #include "newgrf_sound.h"
@@ -2334,12 +2336,19 @@ static const byte _initial_tile_subcoord[6][4][3] = {
  */
 static Track DoTrainPathfind(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool do_track_reservation, PBSTileInfo *dest)
 {
+	/* Lost trains rarely find anything; don't let them take long once the budget of the tick is used up. */
+	NonCriticalPathfinderSearch search(HasBit(v->vehicle_flags, VF_PATHFINDER_LOST), true);
+
+	Track track;
 	switch (_settings_game.pf.pathfinder_for_trains) {
-		case VPF_NPF: return NPFTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest);
-		case VPF_YAPF: return YapfTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest);
+		case VPF_NPF: track = NPFTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest); break;
+		case VPF_YAPF: track = YapfTrainChooseTrack(v, tile, enterdir, tracks, path_found, do_track_reservation, dest); break;
 
 		default: NOT_REACHED();
 	}
+
+	RecordPathfinderQuery(v, tile, enterdir, tracks, (VehiclePathFinders)_settings_game.pf.pathfinder_for_trains, track, path_found);
+	return track;
 }
 
 /**
@@ -3963,6 +3972,10 @@ static void CheckIfTrainNeedsService(Train *v)
 		default: NOT_REACHED();
 	}
 
+	/* Servicing can wait a day when the searches of this tick took long already. */
+	if (!HasPathfinderBudget() && (_date + v->index) % PATHFINDER_SERVICE_SEARCH_INTERVAL != 0) return;
+	NonCriticalPathfinderSearch search(true, false);
+
 	FindDepotData tfdd = FindClosestTrainDepot(v, max_penalty);
 	/* Only go to the depot if it is not too far out of our way. */
 	if (tfdd.best_length == UINT_MAX || tfdd.best_length > max_penalty) {
@@ -24,6 +24,7 @@
 #include "company_base.h"
 #include "core/random_func.hpp"
 #include "newgrf_generic.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 #include "table/tree_land.h"
@@ -720,7 +721,11 @@ static void TileLoop_Trees(TileIndex tile)
 			} else {
 				/* just one tree, change type into MP_CLEAR */
 				switch (GetTreeGround(tile)) {
-					case TREE_GROUND_SHORE: MakeShore(tile); break;
+					case TREE_GROUND_SHORE:
+						MakeShore(tile);
+						InvalidateWaterRegion(tile);
+						break;
+
 					case TREE_GROUND_GRASS: MakeClear(tile, CLEAR_GRASS, GetTreeDensity(tile)); break;
 					case TREE_GROUND_ROUGH: MakeClear(tile, CLEAR_ROUGH, 3); break;
 					case TREE_GROUND_ROUGH_SNOW: {
@@ -37,6 +37,7 @@
 #include "network/network.h"
 #include "core/pool_func.hpp"
 #include "economy_base.h"
+#include "economy_func.h"
 #include "articulated_vehicles.h"
 #include "roadstop_base.h"
 #include "core/random_func.hpp"
@@ -939,6 +940,12 @@ static void RunVehicleDayProc()
 	}
 }
 
+/**
+ * Tick all vehicles, one by one in pool order.
+ * A tick changes the map, stations, companies and the random state that the
+ * ticks of the next vehicles read, so they can't be run in parallel without
+ * changing the outcome and desyncing clients.
+ */
 void CallVehicleTicks()
 {
 	_vehicles_to_autoreplace.Clear();
@@ -1321,7 +1328,10 @@ void AgeVehicle(Vehicle *v)
 {
 	if (v->age < MAX_DAY) {
 		v->age++;
-		if (v->IsPrimaryVehicle() && v->age == VEHICLE_PROFIT_MIN_AGE + 1) GroupStatistics::VehicleReachedProfitAge(v);
+		if (v->IsPrimaryVehicle() && v->age == VEHICLE_PROFIT_MIN_AGE + 1) {
+			GroupStatistics::VehicleReachedProfitAge(v);
+			VehicleReachedRatingAge(v);
+		}
 	}
 
 	if (!v->IsPrimaryVehicle() && (v->type != VEH_TRAIN || !Train::From(v)->IsEngine())) return;
@@ -2733,6 +2743,7 @@ void VehiclesYearlyLoop()
 		}
 	}
 	GroupStatistics::UpdateProfits();
+	RebuildCompanyRatingCaches();
 	SetWindowClassesDirty(WC_TRAINS_LIST);
 	SetWindowClassesDirty(WC_SHIPS_LIST);
 	SetWindowClassesDirty(WC_ROADVEH_LIST);
@@ -12,6 +12,7 @@
 #include "../stdafx.h"
 #include "../gfx_func.h"
 #include "../blitter/factory.hpp"
+#include "../benchmark.h"
 #include "null_v.h"
 
 #include "../safeguards.h"
@@ -27,6 +28,7 @@ const char *VideoDriver_Null::Start(const char * const *parm)
 #endif
 
 	this->ticks = GetDriverParamInt(parm, "ticks", 1000);
+	this->benchmark = GetDriverParamBool(parm, "benchmark");
 	_screen.width  = _screen.pitch = _cur_resolution.width;
 	_screen.height = _cur_resolution.height;
 	_screen.dst_ptr = NULL;
@@ -44,6 +46,11 @@ void VideoDriver_Null::MakeDirty(int left, int top, int width, int height) {}
 
 void VideoDriver_Null::MainLoop()
 {
+	if (this->benchmark) {
+		RunBenchmark(this->ticks);
+		return;
+	}
+
 	uint i;
 
 	for (i = 0; i < this->ticks; i++) {
@@ -17,7 +17,8 @@
 /** The null video driver. */
 class VideoDriver_Null : public VideoDriver {
 private:
-	uint ticks; ///< Amount of ticks to run.
+	uint ticks;     ///< Amount of ticks to run.
+	bool benchmark; ///< Whether to time the ticks and print a report instead of just running them.
 
 public:
 	/* virtual */ const char *Start(const char * const *param);
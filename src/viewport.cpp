@@ -84,6 +84,11 @@
 #include "linkgraph/linkgraph_gui.h"
 #include "viewport_sprite_sorter.h"
 #include "bridge_map.h"
+#include "fileio_func.h"
+#include "debug.h"
+#include "spritecache.h"
+#include "newgrf_debug.h"
+#include "thread/worker_pool.h"
 
 #include <map>
 
@@ -167,11 +172,17 @@ struct ViewportDrawer {
 	FoundationPart foundation_part;                  ///< Currently active foundation for ground sprite drawing.
 	int *last_foundation_child[FOUNDATION_PART_END]; ///< Tail of ChildSprite list of the foundations. (index into child_screen_sprites_to_draw)
 	Point foundation_offset[FOUNDATION_PART_END];    ///< Pixel offset for ground sprites on the foundations.
+
+	Point window_pos;                                ///< Top left corner of the drawn area in the window, for the link graph overlay.
+	bool prefetch;                                   ///< Whether the sprites are only collected to prefetch the ones that are not in the sprite cache.
 };
 
 static void MarkViewportDirty(const ViewPort *vp, int left, int top, int right, int bottom);
+static void ViewportPrefetchAhead(const ViewPort *vp, int delta_x, int delta_y);
 
-static ViewportDrawer _vd;
+static ViewportDrawer _vd_main;       ///< The drawer for drawing on the main thread only.
+static ViewportDrawer _vd_prefetch;   ///< The drawer for prefetching sprites, see #ViewportPrefetchSprites.
+static ViewportDrawer *_vd = &_vd_main; ///< The drawer sprites are added to.
 
 TileHighlightData _thd;
 static TileInfo *_cur_ti;
@@ -179,6 +190,8 @@ bool _draw_bounding_boxes = false;
 bool _draw_dirty_blocks = false;
 uint _dirty_block_colour = 0;
 static VpSpriteSorter _vp_sprite_sorter = NULL;
+static FILE *_parent_sprites_capture_file = NULL; ///< The file parent sprites are captured to, or \c NULL when not capturing.
+static uint _parent_sprites_capture_lists;        ///< Number of lists of parent sprites that are still to be captured.
 
 static Point MapXYZToViewport(const ViewPort *vp, int x, int y, int z)
 {
@@ -332,6 +345,8 @@ static void SetViewportPosition(Window *w, int x, int y)
 	vp->virtual_left = x;
 	vp->virtual_top = y;
 
+	if (x != old_left || y != old_top) ViewportPrefetchAhead(vp, x - old_left, y - old_top);
+
 	/* Viewport is bound to its left top corner, so it must be rounded down (UnScaleByZoomLower)
 	 * else glitch described in FS#1412 will happen (offset by 1 pixel with zoom level > NORMAL)
 	 */
@@ -528,7 +543,7 @@ static void AddTileSpriteToDraw(SpriteID image, PaletteID pal, int32 x, int32 y,
 {
 	assert((image & SPRITE_MASK) < MAX_SPRITES);
 
-	TileSpriteToDraw *ts = _vd.tile_sprites_to_draw.Append();
+	TileSpriteToDraw *ts = _vd->tile_sprites_to_draw.Append();
 	ts->image = image;
 	ts->pal = pal;
 	ts->sub = sub;
@@ -552,17 +567,17 @@ static void AddTileSpriteToDraw(SpriteID image, PaletteID pal, int32 x, int32 y,
 static void AddChildSpriteToFoundation(SpriteID image, PaletteID pal, const SubSprite *sub, FoundationPart foundation_part, int extra_offs_x, int extra_offs_y)
 {
 	assert(IsInsideMM(foundation_part, 0, FOUNDATION_PART_END));
-	assert(_vd.foundation[foundation_part] != -1);
-	Point offs = _vd.foundation_offset[foundation_part];
+	assert(_vd->foundation[foundation_part] != -1);
+	Point offs = _vd->foundation_offset[foundation_part];
 
 	/* Change the active ChildSprite list to the one of the foundation */
-	int *old_child = _vd.last_child;
-	_vd.last_child = _vd.last_foundation_child[foundation_part];
+	int *old_child = _vd->last_child;
+	_vd->last_child = _vd->last_foundation_child[foundation_part];
 
 	AddChildSpriteScreen(image, pal, offs.x + extra_offs_x, offs.y + extra_offs_y, false, sub, false);
 
 	/* Switch back to last ChildSprite list */
-	_vd.last_child = old_child;
+	_vd->last_child = old_child;
 }
 
 /**
@@ -581,11 +596,11 @@ static void AddChildSpriteToFoundation(SpriteID image, PaletteID pal, const SubS
 void DrawGroundSpriteAt(SpriteID image, PaletteID pal, int32 x, int32 y, int z, const SubSprite *sub, int extra_offs_x, int extra_offs_y)
 {
 	/* Switch to first foundation part, if no foundation was drawn */
-	if (_vd.foundation_part == FOUNDATION_PART_NONE) _vd.foundation_part = FOUNDATION_PART_NORMAL;
+	if (_vd->foundation_part == FOUNDATION_PART_NONE) _vd->foundation_part = FOUNDATION_PART_NORMAL;
 
-	if (_vd.foundation[_vd.foundation_part] != -1) {
+	if (_vd->foundation[_vd->foundation_part] != -1) {
 		Point pt = RemapCoords(x, y, z);
-		AddChildSpriteToFoundation(image, pal, sub, _vd.foundation_part, pt.x + extra_offs_x * ZOOM_LVL_BASE, pt.y + extra_offs_y * ZOOM_LVL_BASE);
+		AddChildSpriteToFoundation(image, pal, sub, _vd->foundation_part, pt.x + extra_offs_x * ZOOM_LVL_BASE, pt.y + extra_offs_y * ZOOM_LVL_BASE);
 	} else {
 		AddTileSpriteToDraw(image, pal, _cur_ti->x + x, _cur_ti->y + y, _cur_ti->z + z, sub, extra_offs_x * ZOOM_LVL_BASE, extra_offs_y * ZOOM_LVL_BASE);
 	}
@@ -616,22 +631,22 @@ void DrawGroundSprite(SpriteID image, PaletteID pal, const SubSprite *sub, int e
 void OffsetGroundSprite(int x, int y)
 {
 	/* Switch to next foundation part */
-	switch (_vd.foundation_part) {
+	switch (_vd->foundation_part) {
 		case FOUNDATION_PART_NONE:
-			_vd.foundation_part = FOUNDATION_PART_NORMAL;
+			_vd->foundation_part = FOUNDATION_PART_NORMAL;
 			break;
 		case FOUNDATION_PART_NORMAL:
-			_vd.foundation_part = FOUNDATION_PART_HALFTILE;
+			_vd->foundation_part = FOUNDATION_PART_HALFTILE;
 			break;
 		default: NOT_REACHED();
 	}
 
-	/* _vd.last_child == NULL if foundation sprite was clipped by the viewport bounds */
-	if (_vd.last_child != NULL) _vd.foundation[_vd.foundation_part] = _vd.parent_sprites_to_draw.Length() - 1;
+	/* _vd->last_child == NULL if foundation sprite was clipped by the viewport bounds */
+	if (_vd->last_child != NULL) _vd->foundation[_vd->foundation_part] = _vd->parent_sprites_to_draw.Length() - 1;
 
-	_vd.foundation_offset[_vd.foundation_part].x = x * ZOOM_LVL_BASE;
-	_vd.foundation_offset[_vd.foundation_part].y = y * ZOOM_LVL_BASE;
-	_vd.last_foundation_child[_vd.foundation_part] = _vd.last_child;
+	_vd->foundation_offset[_vd->foundation_part].x = x * ZOOM_LVL_BASE;
+	_vd->foundation_offset[_vd->foundation_part].y = y * ZOOM_LVL_BASE;
+	_vd->last_foundation_child[_vd->foundation_part] = _vd->last_child;
 }
 
 /**
@@ -647,16 +662,19 @@ void OffsetGroundSprite(int x, int y)
  */
 static void AddCombinedSprite(SpriteID image, PaletteID pal, int x, int y, int z, const SubSprite *sub)
 {
+	/* Sprites that are not in the cache are not read while prefetching; they are skipped like clipped ones. */
+	if (_vd->prefetch && !PrefetchSprite(image & SPRITE_MASK)) return;
+
 	Point pt = RemapCoords(x, y, z);
 	const Sprite *spr = GetSprite(image & SPRITE_MASK, ST_NORMAL);
 
-	if (pt.x + spr->x_offs >= _vd.dpi.left + _vd.dpi.width ||
-			pt.x + spr->x_offs + spr->width <= _vd.dpi.left ||
-			pt.y + spr->y_offs >= _vd.dpi.top + _vd.dpi.height ||
-			pt.y + spr->y_offs + spr->height <= _vd.dpi.top)
+	if (pt.x + spr->x_offs >= _vd->dpi.left + _vd->dpi.width ||
+			pt.x + spr->x_offs + spr->width <= _vd->dpi.left ||
+			pt.y + spr->y_offs >= _vd->dpi.top + _vd->dpi.height ||
+			pt.y + spr->y_offs + spr->height <= _vd->dpi.top)
 		return;
 
-	const ParentSpriteToDraw *pstd = _vd.parent_sprites_to_draw.End() - 1;
+	const ParentSpriteToDraw *pstd = _vd->parent_sprites_to_draw.End() - 1;
 	AddChildSpriteScreen(image, pal, pt.x - pstd->left, pt.y - pstd->top, false, sub, false);
 }
 
@@ -697,12 +715,12 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 		pal = PALETTE_TO_TRANSPARENT;
 	}
 
-	if (_vd.combine_sprites == SPRITE_COMBINE_ACTIVE) {
+	if (_vd->combine_sprites == SPRITE_COMBINE_ACTIVE) {
 		AddCombinedSprite(image, pal, x, y, z, sub);
 		return;
 	}
 
-	_vd.last_child = NULL;
+	_vd->last_child = NULL;
 
 	Point pt = RemapCoords(x, y, z);
 	int tmp_left, tmp_top, tmp_x = pt.x, tmp_y = pt.y;
@@ -714,6 +732,9 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 		top  = tmp_top  = RemapCoords(x + bb_offset_x, y + bb_offset_y, z + dz         ).y;
 		bottom          = RemapCoords(x + w          , y + h          , z + bb_offset_z).y + 1;
 	} else {
+		/* Sprites that are not in the cache are not read while prefetching; they are skipped like clipped ones. */
+		if (_vd->prefetch && !PrefetchSprite(image & SPRITE_MASK)) return;
+
 		const Sprite *spr = GetSprite(image & SPRITE_MASK, ST_NORMAL);
 		left = tmp_left = (pt.x += spr->x_offs);
 		right           = (pt.x +  spr->width );
@@ -730,14 +751,14 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 	}
 
 	/* Do not add the sprite to the viewport, if it is outside */
-	if (left   >= _vd.dpi.left + _vd.dpi.width ||
-	    right  <= _vd.dpi.left                 ||
-	    top    >= _vd.dpi.top + _vd.dpi.height ||
-	    bottom <= _vd.dpi.top) {
+	if (left   >= _vd->dpi.left + _vd->dpi.width ||
+	    right  <= _vd->dpi.left                 ||
+	    top    >= _vd->dpi.top + _vd->dpi.height ||
+	    bottom <= _vd->dpi.top) {
 		return;
 	}
 
-	ParentSpriteToDraw *ps = _vd.parent_sprites_to_draw.Append();
+	ParentSpriteToDraw *ps = _vd->parent_sprites_to_draw.Append();
 	ps->x = tmp_x;
 	ps->y = tmp_y;
 
@@ -759,9 +780,9 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
 	ps->comparison_done = false;
 	ps->first_child = -1;
 
-	_vd.last_child = &ps->first_child;
+	_vd->last_child = &ps->first_child;
 
-	if (_vd.combine_sprites == SPRITE_COMBINE_PENDING) _vd.combine_sprites = SPRITE_COMBINE_ACTIVE;
+	if (_vd->combine_sprites == SPRITE_COMBINE_PENDING) _vd->combine_sprites = SPRITE_COMBINE_ACTIVE;
 }
 
 /**
@@ -784,8 +805,8 @@ void AddSortableSpriteToDraw(SpriteID image, PaletteID pal, int x, int y, int w,
  */
 void StartSpriteCombine()
 {
-	assert(_vd.combine_sprites == SPRITE_COMBINE_NONE);
-	_vd.combine_sprites = SPRITE_COMBINE_PENDING;
+	assert(_vd->combine_sprites == SPRITE_COMBINE_NONE);
+	_vd->combine_sprites = SPRITE_COMBINE_PENDING;
 }
 
 /**
@@ -794,8 +815,8 @@ void StartSpriteCombine()
  */
 void EndSpriteCombine()
 {
-	assert(_vd.combine_sprites != SPRITE_COMBINE_NONE);
-	_vd.combine_sprites = SPRITE_COMBINE_NONE;
+	assert(_vd->combine_sprites != SPRITE_COMBINE_NONE);
+	_vd->combine_sprites = SPRITE_COMBINE_NONE;
 }
 
 /**
@@ -845,7 +866,7 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 	assert((image & SPRITE_MASK) < MAX_SPRITES);
 
 	/* If the ParentSprite was clipped by the viewport bounds, do not draw the ChildSprites either */
-	if (_vd.last_child == NULL) return;
+	if (_vd->last_child == NULL) return;
 
 	/* make the sprites transparent with the right palette */
 	if (transparent) {
@@ -853,9 +874,9 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 		pal = PALETTE_TO_TRANSPARENT;
 	}
 
-	*_vd.last_child = _vd.child_screen_sprites_to_draw.Length();
+	*_vd->last_child = _vd->child_screen_sprites_to_draw.Length();
 
-	ChildScreenSpriteToDraw *cs = _vd.child_screen_sprites_to_draw.Append();
+	ChildScreenSpriteToDraw *cs = _vd->child_screen_sprites_to_draw.Append();
 	cs->image = image;
 	cs->pal = pal;
 	cs->sub = sub;
@@ -866,15 +887,15 @@ void AddChildSpriteScreen(SpriteID image, PaletteID pal, int x, int y, bool tran
 	/* Append the sprite to the active ChildSprite list.
 	 * If the active ParentSprite is a foundation, update last_foundation_child as well.
 	 * Note: ChildSprites of foundations are NOT sequential in the vector, as selection sprites are added at last. */
-	if (_vd.last_foundation_child[0] == _vd.last_child) _vd.last_foundation_child[0] = &cs->next;
-	if (_vd.last_foundation_child[1] == _vd.last_child) _vd.last_foundation_child[1] = &cs->next;
-	_vd.last_child = &cs->next;
+	if (_vd->last_foundation_child[0] == _vd->last_child) _vd->last_foundation_child[0] = &cs->next;
+	if (_vd->last_foundation_child[1] == _vd->last_child) _vd->last_foundation_child[1] = &cs->next;
+	_vd->last_child = &cs->next;
 }
 
 static void AddStringToDraw(int x, int y, StringID string, uint64 params_1, uint64 params_2, Colours colour, uint16 width)
 {
 	assert(width != 0);
-	StringSpriteToDraw *ss = _vd.string_sprites_to_draw.Append();
+	StringSpriteToDraw *ss = _vd->string_sprites_to_draw.Append();
 	ss->string = string;
 	ss->x = x;
 	ss->y = y;
@@ -899,7 +920,7 @@ static void AddStringToDraw(int x, int y, StringID string, uint64 params_1, uint
 static void DrawSelectionSprite(SpriteID image, PaletteID pal, const TileInfo *ti, int z_offset, FoundationPart foundation_part)
 {
 	/* FIXME: This is not totally valid for some autorail highlights that extend over the edges of the tile. */
-	if (_vd.foundation[foundation_part] == -1) {
+	if (_vd->foundation[foundation_part] == -1) {
 		/* draw on real ground */
 		AddTileSpriteToDraw(image, pal, ti->x, ti->y, ti->z + z_offset);
 	} else {
@@ -1094,11 +1115,11 @@ static int GetViewportY(Point tile)
  */
 static void ViewportAddLandscape()
 {
-	assert(_vd.dpi.top <= _vd.dpi.top + _vd.dpi.height);
-	assert(_vd.dpi.left <= _vd.dpi.left + _vd.dpi.width);
+	assert(_vd->dpi.top <= _vd->dpi.top + _vd->dpi.height);
+	assert(_vd->dpi.left <= _vd->dpi.left + _vd->dpi.width);
 
-	Point upper_left = InverseRemapCoords(_vd.dpi.left, _vd.dpi.top);
-	Point upper_right = InverseRemapCoords(_vd.dpi.left + _vd.dpi.width, _vd.dpi.top);
+	Point upper_left = InverseRemapCoords(_vd->dpi.left, _vd->dpi.top);
+	Point upper_right = InverseRemapCoords(_vd->dpi.left + _vd->dpi.width, _vd->dpi.top);
 
 	/* Transformations between tile coordinates and viewport rows/columns: See vp_column_row
 	 *   column = y - x
@@ -1161,14 +1182,14 @@ static void ViewportAddLandscape()
 
 			int viewport_y = GetViewportY(tilecoord);
 
-			if (viewport_y + MAX_TILE_EXTENT_BOTTOM < _vd.dpi.top) {
+			if (viewport_y + MAX_TILE_EXTENT_BOTTOM < _vd->dpi.top) {
 				/* The tile in this column is not visible yet.
 				 * Tiles in other columns may be visible, but we need more rows in any case. */
 				last_row = false;
 				continue;
 			}
 
-			int min_visible_height = viewport_y - (_vd.dpi.top + _vd.dpi.height);
+			int min_visible_height = viewport_y - (_vd->dpi.top + _vd->dpi.height);
 			bool tile_visible = min_visible_height <= 0;
 
 			if (tile_type != MP_VOID) {
@@ -1193,11 +1214,11 @@ static void ViewportAddLandscape()
 
 			if (tile_visible) {
 				last_row = false;
-				_vd.foundation_part = FOUNDATION_PART_NONE;
-				_vd.foundation[0] = -1;
-				_vd.foundation[1] = -1;
-				_vd.last_foundation_child[0] = NULL;
-				_vd.last_foundation_child[1] = NULL;
+				_vd->foundation_part = FOUNDATION_PART_NONE;
+				_vd->foundation[0] = -1;
+				_vd->foundation[1] = -1;
+				_vd->last_foundation_child[0] = NULL;
+				_vd->last_foundation_child[1] = NULL;
 
 				_tile_type_procs[tile_type]->draw_tile_proc(&tile_info);
 				if (tile_info.tile != INVALID_TILE) DrawTileSelection(&tile_info);
@@ -1376,7 +1397,7 @@ static bool ViewportSortParentSpritesChecker()
 }
 
 /** Sort parent sprites pointer array */
-static void ViewportSortParentSprites(ParentSpriteToSortVector *psdv)
+void ViewportSortParentSprites(ParentSpriteToSortVector *psdv)
 {
 	ParentSpriteToDraw **psdvend = psdv->End();
 	ParentSpriteToDraw **psd = psdv->Begin();
@@ -1433,6 +1454,93 @@ static void ViewportSortParentSprites(ParentSpriteToSortVector *psdv)
 	}
 }
 
+/** Line at the start of a file with captured parent sprites, describing the columns. */
+static const char * const PARENT_SPRITES_HEADER = "# OpenTTD parent sprites: 'list <count>', then xmin ymin zmin xmax ymax zmax of every sprite in drawing order before sorting\n";
+
+/**
+ * Start capturing the bounding boxes of the parent sprites of the next
+ * drawn viewport areas, before they are sorted.
+ * @param filename The file in the autosave directory to write them to.
+ * @param lists The number of lists of parent sprites, i.e. drawn areas, to capture.
+ * @return Whether the file could be opened.
+ */
+bool StartCapturingParentSprites(const char *filename, uint lists)
+{
+	if (_parent_sprites_capture_file != NULL) FioFCloseFile(_parent_sprites_capture_file);
+
+	_parent_sprites_capture_file = FioFOpenFile(filename, "w", AUTOSAVE_DIR);
+	if (_parent_sprites_capture_file == NULL) return false;
+
+	fputs(PARENT_SPRITES_HEADER, _parent_sprites_capture_file);
+	_parent_sprites_capture_lists = lists;
+	return true;
+}
+
+/**
+ * Write the bounding boxes of a list of parent sprites to the capture file,
+ * and stop capturing when enough lists are captured.
+ * @param psdv The parent sprites.
+ */
+static void CaptureParentSprites(const ParentSpriteToSortVector *psdv)
+{
+	fprintf(_parent_sprites_capture_file, "list %u\n", psdv->Length());
+	for (const ParentSpriteToDraw * const *it = psdv->Begin(); it != psdv->End(); it++) {
+		const ParentSpriteToDraw *ps = *it;
+		fprintf(_parent_sprites_capture_file, "%d %d %d %d %d %d\n", ps->xmin, ps->ymin, ps->zmin, ps->xmax, ps->ymax, ps->zmax);
+	}
+
+	if (--_parent_sprites_capture_lists == 0) {
+		FioFCloseFile(_parent_sprites_capture_file);
+		_parent_sprites_capture_file = NULL;
+	}
+}
+
+/**
+ * Load parent sprites captured with #StartCapturingParentSprites.
+ * @param filename The file in the autosave directory to read them from.
+ * @param[out] captured The captured sprites.
+ * @return Whether the file could be read; lines that are not sprites are skipped.
+ */
+bool LoadCapturedParentSprites(const char *filename, CapturedParentSprites &captured)
+{
+	captured.sprites.Clear();
+	captured.lengths.Clear();
+
+	FILE *f = FioFOpenFile(filename, "r", AUTOSAVE_DIR);
+	if (f == NULL) return false;
+
+	char line[256];
+	uint skipped = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (line[0] == '#') continue;
+
+		if (strncmp(line, "list ", 5) == 0) {
+			*captured.lengths.Append() = 0;
+			continue;
+		}
+
+		int xmin, ymin, zmin, xmax, ymax, zmax;
+		if (captured.lengths.Length() == 0 || sscanf(line, "%d %d %d %d %d %d", &xmin, &ymin, &zmin, &xmax, &ymax, &zmax) != 6) {
+			skipped++;
+			continue;
+		}
+
+		ParentSpriteToDraw *ps = captured.sprites.Append();
+		MemSetT(ps, 0);
+		ps->xmin = xmin;
+		ps->ymin = ymin;
+		ps->zmin = zmin;
+		ps->xmax = xmax;
+		ps->ymax = ymax;
+		ps->zmax = zmax;
+		captured.lengths.End()[-1]++;
+	}
+	FioFCloseFile(f);
+
+	if (skipped != 0) DEBUG(misc, 0, "Skipped %u invalid parent sprites in %s", skipped, filename);
+	return true;
+}
+
 static void ViewportDrawParentSprites(const ParentSpriteToSortVector *psd, const ChildScreenSpriteToDrawVector *csstdv)
 {
 	const ParentSpriteToDraw * const *psd_end = psd->End();
@@ -1529,52 +1637,216 @@ static void ViewportDrawStrings(ZoomLevel zoom, const StringSpriteToDrawVector *
 	}
 }
 
-void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+/**
+ * Set the area of a viewport a drawer collects the sprites of, and start with no sprites.
+ * @param vd The drawer.
+ * @param vp The viewport.
+ * @param left Left of the area, in world coordinates.
+ * @param top Top of the area, in world coordinates.
+ * @param right Right of the area, in world coordinates.
+ * @param bottom Bottom of the area, in world coordinates.
+ */
+static void ViewportInitDrawer(ViewportDrawer *vd, const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	vd->dpi.zoom = vp->zoom;
+	int mask = ScaleByZoom(-1, vp->zoom);
+
+	vd->combine_sprites = SPRITE_COMBINE_NONE;
+
+	vd->dpi.width = (right - left) & mask;
+	vd->dpi.height = (bottom - top) & mask;
+	vd->dpi.left = left & mask;
+	vd->dpi.top = top & mask;
+	vd->last_child = NULL;
+
+	vd->window_pos.x = UnScaleByZoom(vd->dpi.left - (vp->virtual_left & mask), vp->zoom) + vp->left;
+	vd->window_pos.y = UnScaleByZoom(vd->dpi.top - (vp->virtual_top & mask), vp->zoom) + vp->top;
+}
+
+/**
+ * Collect the sprites of an area of a viewport.
+ * @param vd The drawer to add the sprites to.
+ * @param vp The viewport.
+ * @param left Left of the area, in world coordinates.
+ * @param top Top of the area, in world coordinates.
+ * @param right Right of the area, in world coordinates.
+ * @param bottom Bottom of the area, in world coordinates.
+ */
+static void ViewportAddSprites(ViewportDrawer *vd, const ViewPort *vp, int left, int top, int right, int bottom)
 {
 	DrawPixelInfo *old_dpi = _cur_dpi;
-	_cur_dpi = &_vd.dpi;
+	_vd = vd;
+	_cur_dpi = &_vd->dpi;
 
-	_vd.dpi.zoom = vp->zoom;
-	int mask = ScaleByZoom(-1, vp->zoom);
+	ViewportInitDrawer(_vd, vp, left, top, right, bottom);
+	_vd->dpi.pitch = old_dpi->pitch;
+	_vd->dpi.dst_ptr = BlitterFactory::GetCurrentBlitter()->MoveTo(old_dpi->dst_ptr, _vd->window_pos.x - old_dpi->left, _vd->window_pos.y - old_dpi->top);
 
-	_vd.combine_sprites = SPRITE_COMBINE_NONE;
+	ViewportAddLandscape();
+	ViewportAddVehicles(&_vd->dpi);
+
+	ViewportAddTownNames(&_vd->dpi);
+	ViewportAddStationNames(&_vd->dpi);
+	ViewportAddSigns(&_vd->dpi);
 
-	_vd.dpi.width = (right - left) & mask;
-	_vd.dpi.height = (bottom - top) & mask;
-	_vd.dpi.left = left & mask;
-	_vd.dpi.top = top & mask;
-	_vd.dpi.pitch = old_dpi->pitch;
-	_vd.last_child = NULL;
+	DrawTextEffects(&_vd->dpi);
 
-	int x = UnScaleByZoom(_vd.dpi.left - (vp->virtual_left & mask), vp->zoom) + vp->left;
-	int y = UnScaleByZoom(_vd.dpi.top - (vp->virtual_top & mask), vp->zoom) + vp->top;
+	ParentSpriteToDraw *psd_end = _vd->parent_sprites_to_draw.End();
+	for (ParentSpriteToDraw *it = _vd->parent_sprites_to_draw.Begin(); it != psd_end; it++) {
+		*_vd->parent_sprites_to_sort.Append() = it;
+	}
 
-	_vd.dpi.dst_ptr = BlitterFactory::GetCurrentBlitter()->MoveTo(old_dpi->dst_ptr, x - old_dpi->left, y - old_dpi->top);
+	if (_parent_sprites_capture_file != NULL) CaptureParentSprites(&_vd->parent_sprites_to_sort);
+
+	_vd = &_vd_main;
+	_cur_dpi = old_dpi;
+}
+
+/**
+ * Prefetch the sprites of an area of a viewport that are not in the sprite
+ * cache, so they are read in the background before the area is drawn.
+ * @param vp The viewport.
+ * @param left Left of the area, in world coordinates.
+ * @param top Top of the area, in world coordinates.
+ * @param right Right of the area, in world coordinates.
+ * @param bottom Bottom of the area, in world coordinates.
+ */
+static void ViewportPrefetchSprites(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_vd = &_vd_prefetch;
+	_cur_dpi = &_vd->dpi;
+
+	ViewportInitDrawer(_vd, vp, left, top, right, bottom);
+	_vd->dpi.pitch = 0;
+	_vd->dpi.dst_ptr = NULL;
+	_vd->prefetch = true;
 
 	ViewportAddLandscape();
-	ViewportAddVehicles(&_vd.dpi);
+	ViewportAddVehicles(&_vd->dpi);
+
+	/* Only the parent sprites were prefetched while adding them. */
+	for (const TileSpriteToDraw *ts = _vd->tile_sprites_to_draw.Begin(); ts != _vd->tile_sprites_to_draw.End(); ts++) {
+		PrefetchSprite(ts->image & SPRITE_MASK);
+	}
+	for (const ChildScreenSpriteToDraw *cs = _vd->child_screen_sprites_to_draw.Begin(); cs != _vd->child_screen_sprites_to_draw.End(); cs++) {
+		PrefetchSprite(cs->image & SPRITE_MASK);
+	}
+
+	_vd->string_sprites_to_draw.Clear();
+	_vd->tile_sprites_to_draw.Clear();
+	_vd->parent_sprites_to_draw.Clear();
+	_vd->child_screen_sprites_to_draw.Clear();
+
+	_vd = &_vd_main;
+	_cur_dpi = old_dpi;
+}
 
-	ViewportAddTownNames(&_vd.dpi);
-	ViewportAddStationNames(&_vd.dpi);
-	ViewportAddSigns(&_vd.dpi);
+/** Number of ticks a scrolling viewport looks ahead for sprites to prefetch. */
+static const int VIEWPORT_PREFETCH_TICKS = 8;
 
-	DrawTextEffects(&_vd.dpi);
+static const ViewPort *_viewport_prefetch_vp = NULL; ///< The viewport the sprites ahead of were prefetched last.
+static ZoomLevel _viewport_prefetch_zoom;            ///< The zoom level of that viewport.
+static Point _viewport_prefetch_edge;                ///< The coordinates up to which the sprites ahead of that viewport were prefetched.
 
-	if (_vd.tile_sprites_to_draw.Length() != 0) ViewportDrawTileSprites(&_vd.tile_sprites_to_draw);
+/**
+ * Get the range along one axis to prefetch the sprites of, when a viewport
+ * scrolls along it. The range lies ahead of the viewport, as far as it
+ * scrolls in a few ticks at its current speed, but only the part that was not
+ * prefetched before is returned.
+ * @param delta Distance the viewport scrolled, in world coordinates.
+ * @param low Lowest coordinate of the viewport.
+ * @param high Highest coordinate of the viewport.
+ * @param limit Maximum distance to look ahead.
+ * @param[in,out] edge Coordinate up to which the sprites ahead were prefetched.
+ * @param[out] from Start of the range.
+ * @param[out] to End of the range.
+ * @return Whether the range is not empty.
+ */
+static bool GetViewportPrefetchRange(int delta, int low, int high, int limit, int &edge, int &from, int &to)
+{
+	int ahead = Clamp(delta * VIEWPORT_PREFETCH_TICKS, -limit, limit);
+	if (ahead > 0) {
+		from = (edge > high && edge <= high + ahead) ? edge : high;
+		to = high + ahead;
+		edge = to;
+	} else if (ahead < 0) {
+		from = low + ahead;
+		to = (edge < low && edge >= low + ahead) ? edge : low;
+		edge = from;
+	} else {
+		return false;
+	}
+	return from < to;
+}
+
+/**
+ * Prefetch the sprites a scrolling viewport is going to show soon.
+ * @param vp The viewport, at its new position.
+ * @param delta_x Distance it scrolled to the right, in world coordinates.
+ * @param delta_y Distance it scrolled down, in world coordinates.
+ */
+static void ViewportPrefetchAhead(const ViewPort *vp, int delta_x, int delta_y)
+{
+	if (!StartSpritePrefetching()) return;
 
-	ParentSpriteToDraw *psd_end = _vd.parent_sprites_to_draw.End();
-	for (ParentSpriteToDraw *it = _vd.parent_sprites_to_draw.Begin(); it != psd_end; it++) {
-		*_vd.parent_sprites_to_sort.Append() = it;
+	if (vp != _viewport_prefetch_vp || vp->zoom != _viewport_prefetch_zoom) {
+		_viewport_prefetch_vp = vp;
+		_viewport_prefetch_zoom = vp->zoom;
+		_viewport_prefetch_edge.x = vp->virtual_left;
+		_viewport_prefetch_edge.y = vp->virtual_top;
 	}
 
-	_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
-	ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
+	int left = vp->virtual_left;
+	int top = vp->virtual_top;
+	int right = left + vp->virtual_width;
+	int bottom = top + vp->virtual_height;
+
+	int from, to;
+	if (GetViewportPrefetchRange(delta_x, left, right, vp->virtual_width / 2, _viewport_prefetch_edge.x, from, to)) {
+		ViewportPrefetchSprites(vp, from, top, to, bottom);
+	}
+	if (GetViewportPrefetchRange(delta_y, top, bottom, vp->virtual_height / 2, _viewport_prefetch_edge.y, from, to)) {
+		ViewportPrefetchSprites(vp, left, from, right, to);
+	}
+}
+
+/**
+ * Sort and draw the collected sprites of an area of a viewport. This does
+ * not use any global state but the sprite cache and the blitter, so the
+ * sprites of different areas can be drawn by different threads.
+ * @param vd The drawer with the sprites.
+ */
+static void ViewportDrawSprites(ViewportDrawer *vd)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &vd->dpi;
+
+	if (vd->tile_sprites_to_draw.Length() != 0) ViewportDrawTileSprites(&vd->tile_sprites_to_draw);
+
+	_vp_sprite_sorter(&vd->parent_sprites_to_sort);
+	ViewportDrawParentSprites(&vd->parent_sprites_to_sort, &vd->child_screen_sprites_to_draw);
+
+	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&vd->parent_sprites_to_sort);
+
+	_cur_dpi = old_dpi;
+}
+
+/**
+ * Draw the strings and the link graph overlay of an area of a viewport,
+ * on top of its sprites, and forget the sprites.
+ * @param vd The drawer with the sprites.
+ * @param vp The viewport.
+ */
+static void ViewportDrawOverlays(ViewportDrawer *vd, const ViewPort *vp)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	_cur_dpi = &vd->dpi;
 
-	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
 	if (_draw_dirty_blocks) ViewportDrawDirtyBlocks();
 
-	DrawPixelInfo dp = _vd.dpi;
-	ZoomLevel zoom = _vd.dpi.zoom;
+	DrawPixelInfo dp = vd->dpi;
+	ZoomLevel zoom = vd->dpi.zoom;
 	dp.zoom = ZOOM_LVL_NORMAL;
 	dp.width = UnScaleByZoom(dp.width, zoom);
 	dp.height = UnScaleByZoom(dp.height, zoom);
@@ -1582,53 +1854,145 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 
 	if (vp->overlay != NULL && vp->overlay->GetCargoMask() != 0 && vp->overlay->GetCompanyMask() != 0) {
 		/* translate to window coordinates */
-		dp.left = x;
-		dp.top = y;
+		dp.left = vd->window_pos.x;
+		dp.top = vd->window_pos.y;
 		vp->overlay->Draw(&dp);
 	}
 
-	if (_vd.string_sprites_to_draw.Length() != 0) {
+	if (vd->string_sprites_to_draw.Length() != 0) {
 		/* translate to world coordinates */
-		dp.left = UnScaleByZoom(_vd.dpi.left, zoom);
-		dp.top = UnScaleByZoom(_vd.dpi.top, zoom);
-		ViewportDrawStrings(zoom, &_vd.string_sprites_to_draw);
+		dp.left = UnScaleByZoom(vd->dpi.left, zoom);
+		dp.top = UnScaleByZoom(vd->dpi.top, zoom);
+		ViewportDrawStrings(zoom, &vd->string_sprites_to_draw);
 	}
 
 	_cur_dpi = old_dpi;
 
-	_vd.string_sprites_to_draw.Clear();
-	_vd.tile_sprites_to_draw.Clear();
-	_vd.parent_sprites_to_draw.Clear();
-	_vd.parent_sprites_to_sort.Clear();
-	_vd.child_screen_sprites_to_draw.Clear();
+	vd->string_sprites_to_draw.Clear();
+	vd->tile_sprites_to_draw.Clear();
+	vd->parent_sprites_to_draw.Clear();
+	vd->parent_sprites_to_sort.Clear();
+	vd->child_screen_sprites_to_draw.Clear();
+}
+
+void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	ViewportAddSprites(&_vd_main, vp, left, top, right, bottom);
+	ViewportDrawSprites(&_vd_main);
+	ViewportDrawOverlays(&_vd_main, vp);
+}
+
+/** Width and height in pixels of the parts of a viewport that are drawn by different threads. */
+static const int VIEWPORT_DRAW_THREAD_AREA = 256;
+
+static AutoDeleteSmallVector<ViewportDrawer *, 16> _viewport_draw_areas; ///< Drawers of the areas of the viewport that is drawn; they are reused.
+static uint _viewport_draw_area_count;                                   ///< Number of used drawers in #_viewport_draw_areas.
+
+/**
+ * Job of the worker pool that draws the sprites of an area of a viewport.
+ * @param param The drawer with the sprites.
+ */
+static void ViewportDrawSpritesJob(void *param)
+{
+	ViewportDrawSprites((ViewportDrawer *)param);
+}
+
+/**
+ * Check whether the sprites of the viewports can be drawn by the worker pool.
+ * The threads need their own #_cur_dpi to draw.
+ * @return True if there are worker threads to draw with.
+ */
+static bool CanDrawViewportThreaded()
+{
+#if defined(NO_THREAD_LOCAL)
+	return false;
+#else
+	return WorkerPool::Get()->GetWorkerCount() != 0;
+#endif
+}
+
+/**
+ * Collect the sprites of an area of a viewport and let the worker pool draw them.
+ * @param vp The viewport.
+ * @param left Left of the area, in world coordinates.
+ * @param top Top of the area, in world coordinates.
+ * @param right Right of the area, in world coordinates.
+ * @param bottom Bottom of the area, in world coordinates.
+ * @param set The set to add the job that draws the sprites to.
+ */
+static void ViewportQueueDraw(const ViewPort *vp, int left, int top, int right, int bottom, WorkerJobSet *set)
+{
+	if (_viewport_draw_area_count == _viewport_draw_areas.Length()) *_viewport_draw_areas.Append() = new ViewportDrawer();
+	ViewportDrawer *vd = _viewport_draw_areas[_viewport_draw_area_count++];
+
+	ViewportAddSprites(vd, vp, left, top, right, bottom);
+	WorkerPool::Get()->Enqueue(&ViewportDrawSpritesJob, vd, set);
 }
 
 /**
  * Make sure we don't draw a too big area at a time.
  * If we do, the sprite memory will overflow.
+ * @param vp The viewport.
+ * @param left Left of the area, in screen coordinates.
+ * @param top Top of the area, in screen coordinates.
+ * @param right Right of the area, in screen coordinates.
+ * @param bottom Bottom of the area, in screen coordinates.
+ * @param set The set of jobs that draw the sprites on the worker pool, or \c NULL to draw them right away.
  */
-static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom)
+static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom, WorkerJobSet *set)
 {
 	if (ScaleByZoom(bottom - top, vp->zoom) * ScaleByZoom(right - left, vp->zoom) > 180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE) {
 		if ((bottom - top) > (right - left)) {
 			int t = (top + bottom) >> 1;
-			ViewportDrawChk(vp, left, top, right, t);
-			ViewportDrawChk(vp, left, t, right, bottom);
+			ViewportDrawChk(vp, left, top, right, t, set);
+			ViewportDrawChk(vp, left, t, right, bottom, set);
 		} else {
 			int t = (left + right) >> 1;
-			ViewportDrawChk(vp, left, top, t, bottom);
-			ViewportDrawChk(vp, t, top, right, bottom);
+			ViewportDrawChk(vp, left, top, t, bottom, set);
+			ViewportDrawChk(vp, t, top, right, bottom, set);
 		}
 	} else {
-		ViewportDoDraw(vp,
-			ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left,
-			ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top,
-			ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left,
-			ScaleByZoom(bottom - vp->top, vp->zoom) + vp->virtual_top
-		);
+		int world_left = ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left;
+		int world_top = ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top;
+		int world_right = ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left;
+		int world_bottom = ScaleByZoom(bottom - vp->top, vp->zoom) + vp->virtual_top;
+		if (set != NULL) {
+			ViewportQueueDraw(vp, world_left, world_top, world_right, world_bottom, set);
+		} else {
+			ViewportDoDraw(vp, world_left, world_top, world_right, world_bottom);
+		}
 	}
 }
 
+/**
+ * Draw an area of a viewport in parts, whose sprites are drawn by the worker
+ * pool at the same time. The main thread collects the sprites of the parts
+ * and draws the strings on top of them afterwards; it also draws sprites
+ * while there are parts left.
+ * @param vp The viewport.
+ * @param left Left of the area, in screen coordinates.
+ * @param top Top of the area, in screen coordinates.
+ * @param right Right of the area, in screen coordinates.
+ * @param bottom Bottom of the area, in screen coordinates.
+ */
+static void ViewportDrawThreaded(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	SetSpriteCacheShared(true);
+
+	WorkerJobSet set;
+	_viewport_draw_area_count = 0;
+	for (int y = top; y < bottom; y += VIEWPORT_DRAW_THREAD_AREA) {
+		for (int x = left; x < right; x += VIEWPORT_DRAW_THREAD_AREA) {
+			ViewportDrawChk(vp, x, y, min(x + VIEWPORT_DRAW_THREAD_AREA, right), min(y + VIEWPORT_DRAW_THREAD_AREA, bottom), &set);
+		}
+	}
+	WorkerPool::Get()->Wait(&set);
+
+	SetSpriteCacheShared(false);
+
+	for (uint i = 0; i < _viewport_draw_area_count; i++) ViewportDrawOverlays(_viewport_draw_areas[i], vp);
+}
+
 static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right, int bottom)
 {
 	if (right <= vp->left || bottom <= vp->top) return;
@@ -1643,7 +2007,13 @@ static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right
 	if (top < vp->top) top = vp->top;
 	if (bottom > vp->top + vp->height) bottom = vp->top + vp->height;
 
-	ViewportDrawChk(vp, left, top, right, bottom);
+	/* Small areas are not worth the trouble of other threads; the sprite picker needs to see all drawn sprites. */
+	if ((right - left) * (bottom - top) >= 2 * VIEWPORT_DRAW_THREAD_AREA * VIEWPORT_DRAW_THREAD_AREA &&
+			_newgrf_debug_sprite_picker.mode != SPM_REDRAW && CanDrawViewportThreaded()) {
+		ViewportDrawThreaded(vp, left, top, right, bottom);
+	} else {
+		ViewportDrawChk(vp, left, top, right, bottom, NULL);
+	}
 }
 
 /**
@@ -3233,6 +3603,7 @@ struct ViewportSSCSS {
 
 /** List of sorters ordered from best to worst. */
 static ViewportSSCSS _vp_sprite_sorters[] = {
+	{ &ViewportSortParentSpritesGraphChecker, &ViewportSortParentSpritesGraph },
 #ifdef WITH_SSE
 	{ &ViewportSortParentSpritesSSE41Checker, &ViewportSortParentSpritesSSE41 },
 #endif
@@ -48,6 +48,11 @@ typedef bool (*VpSorterChecker)();
 /** Type for the actual viewport sprite sorter. */
 typedef void (*VpSpriteSorter)(ParentSpriteToSortVector *psd);
 
+void ViewportSortParentSprites(ParentSpriteToSortVector *psdv);
+
+bool ViewportSortParentSpritesGraphChecker();
+void ViewportSortParentSpritesGraph(ParentSpriteToSortVector *psdv);
+
 #ifdef WITH_SSE
 bool ViewportSortParentSpritesSSE41Checker();
 void ViewportSortParentSpritesSSE41(ParentSpriteToSortVector *psdv);
@@ -55,4 +60,13 @@ void ViewportSortParentSpritesSSE41(ParentSpriteToSortVector *psdv);
 
 void InitializeSpriteSorter();
 
+/** Bounding boxes of parent sprites captured while drawing the viewports, to benchmark the sprite sorters with. */
+struct CapturedParentSprites {
+	SmallVector<ParentSpriteToDraw, 64> sprites; ///< The sprites of all lists, one list after the other; only the bounding boxes are set.
+	SmallVector<uint, 16> lengths;               ///< Number of sprites of every list.
+};
+
+bool StartCapturingParentSprites(const char *filename, uint lists);
+bool LoadCapturedParentSprites(const char *filename, CapturedParentSprites &captured);
+
 #endif /* VIEWPORT_SPRITE_SORTER_H */
@@ -0,0 +1,237 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file viewport_sprite_sorter_graph.cpp Sprite sorter that only compares sprites whose bounding boxes are close to each other. */
+
+#include "stdafx.h"
+#include "core/math_func.hpp"
+#include "core/mem_func.hpp"
+#include "core/sort_func.hpp"
+#include "viewport_sprite_sorter.h"
+
+#include "safeguards.h"
+
+/** State of a sprite during sorting. */
+enum SortSpriteState {
+	SSS_OPEN,     ///< Not compared with the other sprites yet.
+	SSS_COMPARED, ///< Compared with the other sprites; it is drawn once the sprites that are drawn before it are.
+	SSS_RETURNED, ///< In the sorted list.
+};
+
+/** Information about a sprite that is being sorted. */
+struct SortSprite {
+	uint32 order;          ///< Position in the list the old sorter would have; the higher, the closer to the front.
+	uint cell;             ///< The cell of the grid the sprite is in.
+	uint pos;              ///< Position of the sprite in the list of sprites of its grid cell.
+	SortSpriteState state; ///< State of the sprite.
+};
+
+/** A sprite that must be drawn before the sprite that is compared. */
+struct PrecedingSprite {
+	uint32 order; ///< #SortSprite::order of the sprite.
+	uint index;   ///< Index of the sprite.
+};
+
+/** Sort the preceding sprites so the one closest to the front comes first. */
+static int CDECL PrecedingSpriteSorter(const PrecedingSprite *a, const PrecedingSprite *b)
+{
+	return (a->order < b->order) - (a->order > b->order);
+}
+
+/**
+ * Check whether a sprite has to be drawn before another one, according to
+ * ViewportSortParentSprites.
+ * @param ps The sprite that is compared.
+ * @param ps2 The other sprite.
+ * @return True iff \a ps2 has to be drawn before \a ps.
+ */
+static inline bool IsDrawnBefore(const ParentSpriteToDraw *ps, const ParentSpriteToDraw *ps2)
+{
+	if (ps->xmax < ps2->xmin || ps->ymax < ps2->ymin || ps->zmax < ps2->zmin) return false;
+	if (ps2->xmax < ps->xmin || ps2->ymax < ps->ymin || ps2->zmax < ps->zmin) return true;
+	return ps->xmin + ps->xmax + ps->ymin + ps->ymax + ps->zmin + ps->zmax >
+			ps2->xmin + ps2->xmax + ps2->ymin + ps2->ymax + ps2->zmin + ps2->zmax;
+}
+
+/**
+ * Sort parent sprites pointer array in the same order as
+ * ViewportSortParentSprites, without comparing every sprite with every
+ * other sprite.
+ *
+ * The old sorter takes the first sprite of the list, moves all sprites
+ * that have to be drawn before it to the front of the list, and then
+ * continues with the (new) first sprite. This is a depth first search in
+ * the graph of the sprites that have to be drawn before each other, with a
+ * stack instead of moving sprites around in the list.
+ *
+ * A sprite can only have to be drawn before another one when its minimal
+ * X and Y coordinates are not larger than the maximal ones of the other
+ * sprite. So the sprites are put in a grid of their X+Y and X-Y, and only
+ * the sprites in the cells where these coordinates can be small enough are
+ * compared. Sprites that are in the sorted list are removed from the grid.
+ * @param psdv The sprites to sort.
+ */
+void ViewportSortParentSpritesGraph(ParentSpriteToSortVector *psdv)
+{
+	const uint count = psdv->Length();
+	if (count < 2) return;
+	ParentSpriteToDraw **psd = psdv->Begin();
+
+	/* The range of the X+Y and X-Y of the sprites. */
+	int sum_min = INT_MAX;
+	int sum_max = INT_MIN;
+	int diff_min = INT_MAX;
+	int diff_max = INT_MIN;
+	for (uint i = 0; i < count; i++) {
+		int sum = psd[i]->xmin + psd[i]->ymin;
+		int diff = psd[i]->xmin - psd[i]->ymin;
+		sum_min = min(sum_min, sum);
+		sum_max = max(sum_max, sum);
+		diff_min = min(diff_min, diff);
+		diff_max = max(diff_max, diff);
+	}
+
+	/* Make the grid about as large as the number of sprites, with cells of at least a tile. */
+	uint64 area = (uint64)(sum_max - sum_min + 1) * (diff_max - diff_min + 1) / count;
+	uint shift = 4;
+	while ((uint64)1 << (2 * shift) < area) shift++;
+	const uint rows = ((sum_max - sum_min) >> shift) + 1;
+	const uint cols = ((diff_max - diff_min) >> shift) + 1;
+
+	SmallVector<SortSprite, 64> sprites;
+	SmallVector<uint, 64> cell_first;
+	SmallVector<uint, 64> cell_count;
+	SmallVector<uint, 64> row_count;
+	SmallVector<uint, 64> row_first_col;
+	SmallVector<uint, 64> row_last_col;
+	SmallVector<uint, 64> grid;
+	sprites.Resize(count);
+	cell_first.Resize(rows * cols + 1);
+	cell_count.Resize(rows * cols);
+	row_count.Resize(rows);
+	row_first_col.Resize(rows);
+	row_last_col.Resize(rows);
+	grid.Resize(count);
+	MemSetT(cell_count.Begin(), 0, cell_count.Length());
+	MemSetT(row_count.Begin(), 0, row_count.Length());
+
+	/* Put the sprites in the grid; the sprites of a cell are next to each other. */
+	for (uint i = 0; i < count; i++) {
+		uint row = (psd[i]->xmin + psd[i]->ymin - sum_min) >> shift;
+		uint col = (psd[i]->xmin - psd[i]->ymin - diff_min) >> shift;
+		sprites[i].cell = row * cols + col;
+		sprites[i].state = SSS_OPEN;
+		cell_count[sprites[i].cell]++;
+		row_count[row]++;
+	}
+	cell_first[0] = 0;
+	for (uint c = 0; c < rows * cols; c++) {
+		cell_first[c + 1] = cell_first[c] + cell_count[c];
+		cell_count[c] = 0;
+	}
+	for (uint row = 0; row < rows; row++) {
+		row_first_col[row] = 0;
+		row_last_col[row] = cols - 1;
+	}
+	for (uint i = 0; i < count; i++) {
+		uint cell = sprites[i].cell;
+		sprites[i].pos = cell_first[cell] + cell_count[cell]++;
+		grid[sprites[i].pos] = i;
+	}
+
+	/* The first sprite of the list is on the top of the stack. */
+	SmallVector<uint, 64> stack;
+	uint32 next_order = 0;
+	for (uint i = count; i-- > 0;) {
+		sprites[i].order = next_order++;
+		*stack.Append() = i;
+	}
+
+	SmallVector<PrecedingSprite, 16> preceding;
+	SmallVector<ParentSpriteToDraw *, 64> sorted;
+	uint first_row = 0;
+
+	while (stack.Length() != 0) {
+		uint i = stack.End()[-1];
+		stack.Resize(stack.Length() - 1);
+		SortSprite &s = sprites[i];
+
+		/* Sprites that were moved to the front later in the search are on the stack more than once. */
+		if (s.state == SSS_RETURNED) continue;
+		if (s.state == SSS_COMPARED) {
+			s.state = SSS_RETURNED;
+			*sorted.Append() = psd[i];
+			continue;
+		}
+
+		/* Remove the sprite from the grid; it is compared now, so it will never have to be drawn before another sprite. */
+		uint last = cell_first[s.cell] + --cell_count[s.cell];
+		grid[s.pos] = grid[last];
+		sprites[grid[last]].pos = s.pos;
+		uint cell_row = s.cell / cols;
+		row_count[cell_row]--;
+		while (first_row < rows && row_count[first_row] == 0) first_row++;
+		if (row_count[cell_row] != 0) {
+			while (cell_count[cell_row * cols + row_first_col[cell_row]] == 0) row_first_col[cell_row]++;
+			while (cell_count[cell_row * cols + row_last_col[cell_row]] == 0) row_last_col[cell_row]--;
+		}
+
+		const ParentSpriteToDraw *ps = psd[i];
+		preceding.Clear();
+		int sum = ps->xmax + ps->ymax - sum_min;
+		uint last_row = sum < 0 ? 0 : min<uint>(rows - 1, sum >> shift);
+		for (uint row = first_row; sum >= 0 && row <= last_row; row++) {
+			if (row_count[row] == 0) continue;
+
+			/* The X-Y of the sprites that have a small enough X and Y given the smallest X+Y of the row. */
+			int row_sum = sum_min + (int)(row << shift);
+			int diff_low = max(row_sum - 2 * ps->ymax - diff_min, 0);
+			int diff_high = min(2 * ps->xmax - row_sum - diff_min, diff_max - diff_min);
+			if (diff_low > diff_high) continue;
+
+			/* Only the columns between the first and last sprite of the row. */
+			uint col_first = max<uint>(diff_low >> shift, row_first_col[row]);
+			uint col_last = min<uint>(diff_high >> shift, row_last_col[row]);
+			for (uint cell = row * cols + col_first; cell <= row * cols + col_last; cell++) {
+				const uint *first = grid.Get(cell_first[cell]);
+				const uint *end = first + cell_count[cell];
+				for (const uint *j = first; j != end; j++) {
+					if (!IsDrawnBefore(ps, psd[*j])) continue;
+					PrecedingSprite *p = preceding.Append();
+					p->order = sprites[*j].order;
+					p->index = *j;
+				}
+			}
+		}
+
+		if (preceding.Length() == 0) {
+			s.state = SSS_RETURNED;
+			*sorted.Append() = psd[i];
+			continue;
+		}
+
+		/* The old sorter moves the preceding sprites to the front one by one, so the last one ends up first. */
+		QSortT(preceding.Begin(), preceding.Length(), &PrecedingSpriteSorter);
+		s.state = SSS_COMPARED;
+		*stack.Append() = i;
+		for (const PrecedingSprite *p = preceding.Begin(); p != preceding.End(); p++) {
+			sprites[p->index].order = next_order++;
+			*stack.Append() = p->index;
+		}
+	}
+
+	assert(sorted.Length() == count);
+	MemCpyT(psd, sorted.Begin(), count);
+}
+
+/** This sprite sorter always exists. */
+bool ViewportSortParentSpritesGraphChecker()
+{
+	return true;
+}
@@ -39,6 +39,7 @@
 #include "company_base.h"
 #include "company_gui.h"
 #include "newgrf_generic.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 
@@ -148,6 +149,8 @@ CommandCost CmdBuildShipDepot(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 
 		MakeShipDepot(tile,  _current_company, depot->index, DEPOT_PART_NORTH, axis, wc1);
 		MakeShipDepot(tile2, _current_company, depot->index, DEPOT_PART_SOUTH, axis, wc2);
+		InvalidateWaterRegion(tile);
+		InvalidateWaterRegion(tile2);
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile2);
 		MakeDefaultName(depot);
@@ -303,6 +306,9 @@ static CommandCost DoBuildLock(TileIndex tile, DiagDirection dir, DoCommandFlag
 		}
 
 		MakeLock(tile, _current_company, dir, wc_lower, wc_upper, wc_middle);
+		InvalidateWaterRegion(tile);
+		InvalidateWaterRegion(tile - delta);
+		InvalidateWaterRegion(tile + delta);
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile - delta);
 		MarkTileDirtyByTile(tile + delta);
@@ -345,6 +351,7 @@ static CommandCost RemoveLock(TileIndex tile, DoCommandFlag flags)
 
 		if (GetWaterClass(tile) == WATER_CLASS_RIVER) {
 			MakeRiver(tile, Random());
+			InvalidateWaterRegion(tile);
 		} else {
 			DoClearSquare(tile);
 		}
@@ -447,6 +454,7 @@ CommandCost CmdBuildCanal(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 					}
 					break;
 			}
+			InvalidateWaterRegion(tile);
 			MarkTileDirtyByTile(tile);
 			MarkCanalsAndRiversAroundDirty(tile);
 		}
@@ -1090,6 +1098,8 @@ void DoFloodTile(TileIndex target)
 	}
 
 	if (flooded) {
+		InvalidateWaterRegion(target);
+
 		/* Mark surrounding canal tiles dirty too to avoid glitches */
 		MarkCanalsAndRiversAroundDirty(target);
 
@@ -1140,6 +1150,7 @@ static void DoDryUp(TileIndex tile)
 
 		default: NOT_REACHED();
 	}
+	InvalidateWaterRegion(tile);
 
 	cur_company.Restore();
 }